@@ -23,6 +23,8 @@
 #include "bear-error-model.h"
 #include "ns3/node-list.h"
 #include "ns3/mobility-model.h"
+#include "ns3/wifi-mac-trailer.h"
+#include "ns3/msdu-aggregator.h"
 
 #include "bear-propagation-loss-model.h"
 
@@ -94,6 +96,12 @@ void BearErrorModel::SetRxCallback(BearRxCallback_t callback)
 	m_rxCallback = callback;
 }
 
+void BearErrorModel::SetSubframeSnrCallback(BearSubframeSnrCallback_t callback)
+{
+	NS_LOG_FUNCTION_NOARGS();
+	m_subframeSnrCallback = callback;
+}
+
 bool BearErrorModel::DoCorrupt(Ptr<Packet> packet)
 {
 	NS_LOG_FUNCTION_NOARGS ();
@@ -111,6 +119,23 @@ bool BearErrorModel::DoCorrupt(Ptr<Packet> packet)
 	}
 
 	packetInfo = ParsePacket(packet);
+	rxError = CorruptFrame (packet, packetInfo);
+
+	//Tracing and callbacks
+	m_rxTrace (packet, 0, rxError, iter->second->GetCurrentRxPower(), iter->second->GetCurrentSlowFading(), iter->second->GetCurrentFastFading());
+
+	if (!m_rxCallback.IsNull ())
+	{
+		m_rxCallback (packet, 0, rxError, iter->second->GetCurrentRxPower(), iter->second->GetCurrentSlowFading(), iter->second->GetCurrentFastFading());
+	}
+
+	return rxError;
+}
+
+bool BearErrorModel::CorruptFrame (Ptr<const Packet> packet, const packetInfo_t &packetInfo)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+	bool rxError;
 
 	//Decide whether the frame is correct or not according to the frame type (data, TCP or broadcast/control)
 	if ((packetInfo.type == UDP_DATA || packetInfo.type == TCP_DATA) && (packetInfo.payloadLength > 4))		//Discard ACKs TCP
@@ -134,18 +159,71 @@ bool BearErrorModel::DoCorrupt(Ptr<Packet> packet)
 		rxError = false;
 	}
 
-	//Tracing and callbacks
-	m_rxTrace (packet, 0, rxError, iter->second->GetCurrentRxPower(), iter->second->GetCurrentSlowFading(), iter->second->GetCurrentFastFading());
+	return rxError;
+}
 
-	if (!m_rxCallback.IsNull ())
+bool BearErrorModel::CorruptAggregate(Ptr<const Packet> packet, vector<bool> &received)
+{
+	NS_LOG_FUNCTION (this << packet);
+	bool rxError = false;
+	u_int32_t i;
+	WifiMacHeader hdr;
+	WifiMacTrailer fcs;
+	MsduAggregator::DeaggregatedMsdus subframes;
+	MsduAggregator::DeaggregatedMsdusCI subframe;
+
+	Ptr<Packet> msdus = packet->Copy ();
+	msdus->RemoveHeader (hdr);
+	msdus->RemoveTrailer (fcs);
+	subframes = MsduAggregator::Deaggregate (msdus);
+
+	received.assign (subframes.size (), true);
+	if (!IsEnabled ())
 	{
-		m_rxCallback (packet, 0, rxError, iter->second->GetCurrentRxPower(), iter->second->GetCurrentSlowFading(), iter->second->GetCurrentFastFading());
+		return false;
+	}
+
+	channelSetIter_t iter = m_channelSetMap->find (ChannelMeshPropagationKey (NodeList::GetNode (m_txIndex)->GetObject<MobilityModel> (),
+			NodeList::GetNode (m_rxIndex)->GetObject<MobilityModel> ()));
+	if (iter == m_channelSetMap->end())
+	{
+		return false;
+	}
+
+	//The AR filter moves once per subframe, whatever its type; each subframe is then decided as DoCorrupt does with a frame
+	for (i = 0, subframe = subframes.begin (); subframe != subframes.end (); i++, subframe++)
+	{
+		if (i > 0 && !m_subframeSnrCallback.IsNull ())
+		{
+			m_snr = m_subframeSnrCallback (iter->second);
+		}
+		else
+		{
+			m_snr = iter->second->GetCurrentSnr();
+		}
+
+		packetInfo_t packetInfo;
+		packetInfo.wifiHdr = hdr;
+		ParseMsdu (subframe->first, packetInfo, 0);				//The FCS is shared by the whole aggregate
+		if (CorruptFrame (packet, packetInfo))
+		{
+			received[i] = false;
+			rxError = true;
+		}
+
+		//Tracing and callbacks (one per subframe)
+		m_rxTrace (packet, 0, !received[i], iter->second->GetCurrentRxPower(), iter->second->GetCurrentSlowFading(), iter->second->GetCurrentFastFading());
+
+		if (!m_rxCallback.IsNull ())
+		{
+			m_rxCallback (packet, 0, !received[i], iter->second->GetCurrentRxPower(), iter->second->GetCurrentSlowFading(), iter->second->GetCurrentFastFading());
+		}
 	}
 
 	return rxError;
 }
 
-bool BearErrorModel::CorruptDataFrame(Ptr<Packet>)
+bool BearErrorModel::CorruptDataFrame(Ptr<const Packet>)
 {
 	NS_LOG_FUNCTION_NOARGS();
 	double fer;
@@ -189,7 +267,7 @@ bool BearErrorModel::CorruptDataFrame(Ptr<Packet>)
 		return error;
 }
 
-bool BearErrorModel::CorruptAckFrame(Ptr<Packet>)
+bool BearErrorModel::CorruptAckFrame(Ptr<const Packet>)
 {
 	NS_LOG_FUNCTION_NOARGS();
 	double fer;
@@ -234,7 +312,7 @@ bool BearErrorModel::CorruptAckFrame(Ptr<Packet>)
 	return error;
 }
 
-bool BearErrorModel::CorruptBcastCtrlFrame(Ptr<Packet>)
+bool BearErrorModel::CorruptBcastCtrlFrame(Ptr<const Packet>)
 {
 	NS_LOG_FUNCTION_NOARGS();
 	double fer;
@@ -298,6 +376,29 @@ double BearErrorModel::GetBearFer(BearLogisticFunction::BearLogisticFunction *pa
 	return fer;
 }
 
+double BearErrorModel::GetDataFer (double snr)
+{
+	NS_LOG_FUNCTION (snr);
+	double fer, currentSnr = m_snr;
+
+	m_snr = snr;
+	switch (m_errorModelType)
+	{
+	case BEAR_MODEL:
+		fer = GetBearFer(&m_dataLogParams);
+		break;
+	case SHADOWING_MODEL:
+		fer = (m_snr < 9) ? 1.0 : 0.0;
+		break;
+	default:
+		fer = 0.0;
+		break;
+	}
+	m_snr = currentSnr;
+
+	return fer;
+}
+
 void BearErrorModel::DoReset()
 {
 	NS_LOG_FUNCTION_NOARGS ();
@@ -332,44 +433,56 @@ packetInfo_t BearErrorModel::ParsePacket (Ptr<Packet> packet)
 
 	if (packetInfo.wifiHdr.IsData())
 	{
-		pktCopy->RemoveHeader(packetInfo.llcHdr);
-		switch (packetInfo.llcHdr.GetType())
+		ParseMsdu (pktCopy, packetInfo, 4);										//Last four bytes are used for tagging
+	}
+	else
+	{
+		if (packetInfo.wifiHdr.IsAck())
+		{
+			packetInfo.type = IEEE_80211_ACK;
+		}
+		else	// 802.11 Control/Management frame
+		{
+			packetInfo.type = IEEE_80211_NODATA;
+		}
+		packetInfo.payloadLength = pktCopy->GetSize() - 4;
+	}
+
+	return packetInfo;
+}
+
+void BearErrorModel::ParseMsdu (Ptr<Packet> msdu, packetInfo_t &packetInfo, u_int32_t trailerSize)
+{
+	NS_LOG_FUNCTION(msdu << trailerSize);
+
+	packetInfo.type = IEEE_80211_NODATA;
+	msdu->RemoveHeader(packetInfo.llcHdr);
+	switch (packetInfo.llcHdr.GetType())
+	{
+	case 0x0806:			//ARP
+		packetInfo.type = ARP_PACKET;
+		break;
+	case 0x0800:			//IP packet
+		msdu->RemoveHeader(packetInfo.ipv4Hdr);
+		switch (packetInfo.ipv4Hdr.GetProtocol())
 		{
-		case 0x0806:			//ARP
-			packetInfo.type = ARP_PACKET;
+		case 6:				//TCP
+			msdu->RemoveHeader(packetInfo.tcpHdr);
+			packetInfo.type = TCP_DATA;
 			break;
-		case 0x0800:			//IP packet
-			pktCopy->RemoveHeader(packetInfo.ipv4Hdr);
-			switch (packetInfo.ipv4Hdr.GetProtocol())
-			{
-			case 6:				//TCP
-				pktCopy->RemoveHeader(packetInfo.tcpHdr);
-				packetInfo.type = TCP_DATA;
-				break;
-			case 17:			//UDP
-				pktCopy->RemoveHeader(packetInfo.udpHdr);
-				packetInfo.type = UDP_DATA;
-				break;
-			default:
-				NS_LOG_ERROR ("Protocol not implemented yet (IP header) --> " << packetInfo.ipv4Hdr.GetProtocol());
-				break;
-			}
+		case 17:			//UDP
+			msdu->RemoveHeader(packetInfo.udpHdr);
+			packetInfo.type = UDP_DATA;
 			break;
 		default:
-			NS_LOG_ERROR ("Protocol not implemented yet (LLC header) --> " << packetInfo.llcHdr.GetType());
+			NS_LOG_ERROR ("Protocol not implemented yet (IP header) --> " << packetInfo.ipv4Hdr.GetProtocol());
 			break;
 		}
-	}
-	else if (packetInfo.wifiHdr.IsAck())
-	{
-		packetInfo.type = IEEE_80211_ACK;
-	}
-	else	// 802.11 Control/Management frame
-	{
-		packetInfo.type = IEEE_80211_NODATA;
+		break;
+	default:
+		NS_LOG_ERROR ("Protocol not implemented yet (LLC header) --> " << packetInfo.llcHdr.GetType());
+		break;
 	}
 
-	packetInfo.payloadLength = pktCopy->GetSize() - 4;								//Last four bytes are used for tagging
-
-	return packetInfo;
+	packetInfo.payloadLength = msdu->GetSize() - trailerSize;
 }
@@ -122,7 +122,13 @@ public:
 	 * arg6: snr due to the AR model (Slow fading)
 	 * arg7: Fast Fading related SNR
 	 */
-	typedef Callback<void,Ptr<Packet>, int, bool, double, double, double> BearRxCallback_t;
+	typedef Callback<void,Ptr<const Packet>, int, bool, double, double, double> BearRxCallback_t;
+
+	/**
+	 * Move the link one frame forward (AR filter and fast fading) and return its new total SNR
+	 * arg1: link record
+	 */
+	typedef Callback<double, Ptr<BearModelEntry> > BearSubframeSnrCallback_t;
 
 	/**
 	 * Attribute handler
@@ -142,19 +148,36 @@ public:
 	 * \param packet The packet received
 	 * \returns True if the packet is corrupted
 	 */
-	bool CorruptDataFrame (Ptr<Packet> packet);
+	bool CorruptDataFrame (Ptr<const Packet> packet);
 	/**
 	 * \brief Apply a logistic function to decide whether an ack (TCP) frame is correct or not
 	 * \param packet The packet received
 	 * \returns True if the packet is corrupted
 	 */
-	bool CorruptAckFrame (Ptr<Packet> packet);
+	bool CorruptAckFrame (Ptr<const Packet> packet);
 	/**
 	 * \brief Apply a logistic function to decide whether a broadcast/control/management frame is correct or not
 	 * \param packet The packet received
 	 * \returns True if the packet is corrupted
 	 */
-	bool CorruptBcastCtrlFrame (Ptr<Packet> packet);
+	bool CorruptBcastCtrlFrame (Ptr<const Packet> packet);
+	/**
+	 * \brief Pick the logistic function according to the frame type (data, TCP ACK or broadcast/control) and decide the frame
+	 * \param packet The packet received
+	 * \param packetInfo Parsed content of the packet (see ParsePacket)
+	 * \returns True if the packet is corrupted
+	 */
+	bool CorruptFrame (Ptr<const Packet> packet, const packetInfo_t &packetInfo);
+
+	/**
+	 * \brief Decide the subframes of an aggregate (A-MSDU) in a single call. The link is looked up once; the first subframe takes the
+	 * current SNR, and the AR filter moves once per subframe afterwards (see SetSubframeSnrCallback). Each subframe is classified as
+	 * DoCorrupt does with a frame (i.e. TCP ACK MSDUs go through the ACK logistic function)
+	 * \param packet The aggregate, as received by the PHY (MAC header, subframes and FCS)
+	 * \param received Filled with the outcome of each subframe (true if received correctly)
+	 * \returns True if any subframe is corrupted (the aggregate shares the FCS)
+	 */
+	bool CorruptAggregate (Ptr<const Packet> packet, vector<bool> &received);
 
 	/**
 	 * \brief Use the logistic function to obtain the FER
@@ -163,6 +186,13 @@ public:
 	 */
 	double GetBearFer (BearLogisticFunction *params);
 
+	/**
+	 * \brief FER that a data frame would experience at the given SNR (i.e. to precompute the channel realization of a link)
+	 * \param snr Received SNR (dB)
+	 * \returns The FER value
+	 */
+	double GetDataFer (double snr);
+
 	/**
 	 * To obtain the SNR of a particular link, we need to know the identity of both source and sink nodes, in order to later look them into
 	 * the map and select the corresponding SNR value
@@ -188,6 +218,14 @@ public:
 	 */
 	packetInfo_t ParsePacket (Ptr<Packet> packet);
 
+	/**
+	 * \brief Parse the upper layers of a data frame (or of an A-MSDU subframe)
+	 * \param msdu The MSDU, starting at the LLC header (its headers are removed)
+	 * \param packetInfo Struct where the LLC/IP/transport headers, the type and the payload length are stored
+	 * \param trailerSize Bytes after the transport payload (the FCS of a frame; none for the subframes of an aggregate)
+	 */
+	void ParseMsdu (Ptr<Packet> msdu, packetInfo_t &packetInfo, u_int32_t trailerSize);
+
 	/**
 	 * Information handled by the propagation loss model; which will be used to decide a frame reception error
 	 */
@@ -196,6 +234,9 @@ public:
 	//Callback invoked when a packet is received by the error model object
 	void SetRxCallback (BearRxCallback_t callback);
 
+	//Callback invoked to move a link forward between the subframes of an aggregate (set by the BearPropagationLossModel)
+	void SetSubframeSnrCallback (BearSubframeSnrCallback_t callback);
+
 private:
 	/**
 	 * This error model will decide whether a frame is corrupt or not depending on the SNR value gathered from its
@@ -246,6 +287,7 @@ private:
 	 */
 	TracedCallback<Ptr<const Packet>, int, bool, double, double, double> m_rxTrace;
 	BearRxCallback_t m_rxCallback;
+	BearSubframeSnrCallback_t m_subframeSnrCallback;
 
 };
 
@@ -213,3 +213,53 @@ double BearModelEntry::GetCurrentSnr () const
 {
 	return m_currentSnr;
 }
+
+void BearModelEntry::Serialize (ostream &os) const
+{
+	NS_LOG_FUNCTION (this);
+	u_int32_t i;
+
+	ChannelMeshCheckpoint::Write<u_int32_t> (os, m_previousSnr.size());
+	for (i = 0; i < m_previousSnr.size(); i++)
+	{
+		ChannelMeshCheckpoint::Write<double> (os, m_previousSnr[i].snr);
+		ChannelMeshCheckpoint::Write<int64_t> (os, (Simulator::Now() - m_previousSnr[i].time).GetNanoSeconds());
+	}
+	ChannelMeshCheckpoint::Write<double> (os, m_currentRxPower);
+	ChannelMeshCheckpoint::Write<double> (os, m_currentSlowFading);
+	ChannelMeshCheckpoint::Write<double> (os, m_currentFastFading);
+	ChannelMeshCheckpoint::Write<double> (os, m_currentSnr);
+}
+
+bool BearModelEntry::Deserialize (istream &is)
+{
+	NS_LOG_FUNCTION (this);
+	u_int32_t i, samples;
+	int64_t age;
+	struct prevValues_t sample;
+
+	if (m_coherenceTimeout.IsRunning())
+		m_coherenceTimeout.Cancel();
+	m_previousSnr.clear();
+
+	if (!ChannelMeshCheckpoint::Read (is, samples))
+		return false;
+	for (i = 0; i < samples; i++)
+	{
+		if (!ChannelMeshCheckpoint::Read (is, sample.snr) || !ChannelMeshCheckpoint::Read (is, age))
+			return false;
+		sample.time = Simulator::Now() - NanoSeconds (age);
+		m_previousSnr.push_back (sample);
+	}
+	if (!ChannelMeshCheckpoint::Read (is, m_currentRxPower) || !ChannelMeshCheckpoint::Read (is, m_currentSlowFading)
+			|| !ChannelMeshCheckpoint::Read (is, m_currentFastFading) || !ChannelMeshCheckpoint::Read (is, m_currentSnr))
+		return false;
+
+	//The oldest sample will expire once its coherence time is over
+	if (m_previousSnr.size())
+	{
+		m_coherenceTimeout = Simulator::Schedule (MilliSeconds (GetNextTimeout()), &BearModelEntry::HandleCoherenceTimeout, this);
+	}
+	DisplaySnrQueue();
+	return true;
+}
@@ -127,6 +127,19 @@ public:
 	  */
 	 double GetCurrentSnr () const;
 
+	 /**
+	  * \brief Store the link state (AR filter window and last SNR contributions) into a checkpoint. The timestamps of the buffered samples
+	  * are stored as ages (relative to the current simulation time)
+	  * \param os Output stream (binary mode)
+	  */
+	 void Serialize (ostream &os) const;
+	 /**
+	  * \brief Rebuild the link state from a checkpoint, rescheduling the coherence timeout according to the age of the oldest sample
+	  * \param is Input stream (binary mode)
+	  * \returns False if the stream ended unexpectedly
+	  */
+	 bool Deserialize (istream &is);
+
 private:
 
 	 //Vector that stores the SNR and the timestamp of the overheard packets (Size set by the AR filter order)
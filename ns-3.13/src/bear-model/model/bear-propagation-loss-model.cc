@@ -21,6 +21,7 @@
 
 #include <math.h>
 #include <fstream>
+#include <sstream>
 #include <stdio.h>
 
 #include <ns3/node.h>
@@ -144,6 +145,7 @@ BearPropagationLossModel::BearPropagationLossModel() : m_order (3),
 	//Create the error model
 	m_errorModel = CreateObject <BearErrorModel> ();
 	m_errorModel->SetChannelMap (&m_channelSetMap);
+	m_errorModel->SetSubframeSnrCallback (MakeCallback (&BearPropagationLossModel::GetSubframeSnr, this));
 
 }
 
@@ -190,6 +192,7 @@ void BearPropagationLossModel::SetErrorModel(Ptr<BearErrorModel> error)
 {
 	NS_LOG_FUNCTION(this);
 	m_errorModel= error;
+	m_errorModel->SetSubframeSnrCallback (MakeCallback (&BearPropagationLossModel::GetSubframeSnr, this));
 }
 
 Ptr<BearErrorModel> BearPropagationLossModel::GetErrorModel()
@@ -321,6 +324,25 @@ double BearPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityM
 	return  rxPowerDbm + arOutput + fastFadingRandomValue;
 }
 
+double BearPropagationLossModel::DoCalcInterferenceRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+	NS_LOG_FUNCTION(Simulator::Now().GetSeconds() << txPowerDbm << a << b);
+	double rxPowerDbm;
+
+	if (m_receivedSnr.first)
+		rxPowerDbm = m_receivedSnr.second;
+	else
+		rxPowerDbm = m_propagationLoss->CalcInterferenceRxPower (txPowerDbm, a, b);
+
+	channelSetIter_t iter = m_channelSetMap.find (ChannelMeshPropagationKey (a,b));
+	if (iter != m_channelSetMap.end())
+	{
+		rxPowerDbm += iter->second->GetCurrentSlowFading ();
+	}
+
+	return rxPowerDbm;
+}
+
 double BearPropagationLossModel::GetArFilterCoefficient(int key, int vectorPosition) const
 {
 	NS_LOG_FUNCTION_NOARGS();
@@ -347,11 +369,40 @@ double BearPropagationLossModel::GetCurrentArValue (Ptr<MobilityModel> sender, P
 {
 	NS_LOG_FUNCTION_NOARGS();
 
-//	bool txFound = false;
-//	bool rxFound = false;
-//	ChannelKey key;
-	channelSetIter_t channelKeyIter;
-	Ptr<BearModelEntry> channel;
+	channelSetIter_t channelKeyIter = m_channelSetMap.find (ChannelMeshPropagationKey (sender, receiver));
+
+	if (channelKeyIter != m_channelSetMap.end())
+	{
+		return GetCurrentArValue (channelKeyIter->second);
+	}
+	NS_LOG_ERROR ("Channel not found");
+	return GetCurrentArValue (0);
+}
+
+double BearPropagationLossModel::GetSubframeSnr (Ptr<BearModelEntry> channel) const
+{
+	NS_LOG_FUNCTION_NOARGS();
+	NormalVariable fastFading (0.0, m_ffVariance);
+	double arOutput;
+	double fastFadingRandomValue = 0.0;
+
+	//The deterministic contribution does not change within an aggregate; the AR filter and the fast fading go one frame forward
+	arOutput = GetCurrentArValue (channel);
+	if (m_order)
+	{
+		fastFadingRandomValue = fastFading.GetValue();
+	}
+
+	channel->SetCurrentSlowFading (arOutput);
+	channel->SetCurrentFastFading (fastFadingRandomValue);
+	channel->SetCurrentSnr (channel->GetCurrentRxPower() + arOutput + fastFadingRandomValue);
+	return channel->GetCurrentSnr();
+}
+
+double BearPropagationLossModel::GetCurrentArValue (Ptr<BearModelEntry> channel) const
+{
+	NS_LOG_FUNCTION_NOARGS();
+
 	u_int32_t i;
 	int currentSize;
 	double currentSnr = 0.0;
@@ -359,18 +410,6 @@ double BearPropagationLossModel::GetCurrentArValue (Ptr<MobilityModel> sender, P
 	NormalVariable randomArNoise (0.0, pow(m_stdDevDb,2));
 	NormalVariable randomNoise (0.0, m_variance);
 
-	channelKeyIter = m_channelSetMap.find (ChannelMeshPropagationKey (sender, receiver));
-
-	 if (channelKeyIter != m_channelSetMap.end())
-	 {
-		 channel = channelKeyIter->second;
-	 }
-	 else
-	 {
-		 NS_LOG_ERROR ("Channel not found");
-		 channel = 0;
-	 }
-
 	 //If there is a channel defined, get the current SNR value
 	 if (channel != 0)
 	 {
@@ -455,6 +494,46 @@ void BearPropagationLossModel::SetReceivedSnr(pair<bool, double> receivedSnr)
 	m_receivedSnr = receivedSnr;
 }
 
+vector<ChannelMeshPropagationKey> BearPropagationLossModel::GetLinks () const
+{
+	vector<ChannelMeshPropagationKey> links;
+	for (channelSetIter_t iter = m_channelSetMap.begin(); iter != m_channelSetMap.end(); iter++)
+	{
+		links.push_back (iter->first);
+	}
+	return links;
+}
+
+Ptr<BearModelEntry> BearPropagationLossModel::GetLinkEntry (Ptr<MobilityModel> sender, Ptr<MobilityModel> receiver) const
+{
+	channelSetIter_t iter = m_channelSetMap.find (ChannelMeshPropagationKey (sender, receiver));
+	return (iter != m_channelSetMap.end()) ? iter->second : Ptr<BearModelEntry> ();
+}
+
+bool BearPropagationLossModel::SaveChannelState (string fileName) const
+{
+	NS_LOG_FUNCTION (fileName);
+
+	if (!ChannelMeshCheckpoint::Save (fileName, "BEAR", m_channelSetMap))
+	{
+		NS_LOG_ERROR ("Cannot create the checkpoint file " << fileName);
+		return false;
+	}
+	return true;
+}
+
+bool BearPropagationLossModel::LoadChannelState (string fileName)
+{
+	NS_LOG_FUNCTION (fileName);
+
+	if (!ChannelMeshCheckpoint::Load (fileName, "BEAR", m_channelSetMap))
+	{
+		NS_LOG_ERROR ("Cannot restore the checkpoint file " << fileName);
+		return false;
+	}
+	return true;
+}
+
 std::string BearPropagationLossModel::GetCwd () {
 	NS_LOG_FUNCTION_NOARGS();
 	char buf[FILENAME_MAX];
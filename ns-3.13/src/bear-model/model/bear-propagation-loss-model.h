@@ -141,6 +141,18 @@ public:
 	 * \returns Auto Regressive filter obtained value (dB)
 	 */
 	double GetCurrentArValue (Ptr<MobilityModel> sender, Ptr<MobilityModel> receiver) const;
+	/**
+	 * \param channel Link record
+	 * \returns Auto Regressive filter obtained value (dB)
+	 */
+	double GetCurrentArValue (Ptr<BearModelEntry> channel) const;
+	/**
+	 * \brief Move a link one frame forward (i.e. the next subframe of an aggregate): new AR filter output and fast fading sample, over the
+	 * last deterministic contribution
+	 * \param channel Link record
+	 * \returns The new total SNR of the link (dB)
+	 */
+	double GetSubframeSnr (Ptr<BearModelEntry> channel) const;
 	/**
 	 * \returns the pair which define whether the channel has a fixed FER or not
 	 */
@@ -154,6 +166,32 @@ public:
 	 */
 	void DisableFixedSnr ();
 
+	/**
+	 * \brief Store the state of every link (AR filter windows and last SNR contributions) into a binary checkpoint, so that a warmed-up
+	 * channel can be later restored (i.e. to carry out several experiments over the same channel state)
+	 * \param fileName Checkpoint file
+	 * \returns False if the file could not be written
+	 */
+	bool SaveChannelState (string fileName) const;
+
+	/**
+	 * \returns The keys (mobility models and node IDs) of all the links handled by the model
+	 */
+	vector<ChannelMeshPropagationKey> GetLinks () const;
+	/**
+	 * \param sender Mobility model of the transmitter
+	 * \param receiver Mobility model of the receiver
+	 * \returns The entry which holds the state of the link (0 if the link does not exist)
+	 */
+	Ptr<BearModelEntry> GetLinkEntry (Ptr<MobilityModel> sender, Ptr<MobilityModel> receiver) const;
+	/**
+	 * \brief Rebuild the links state from a checkpoint created by SaveChannelState. Links are matched by their node IDs; those not found in
+	 * the current scenario are ignored
+	 * \param fileName Checkpoint file
+	 * \returns False if the file could not be read or does not hold a BEAR checkpoint
+	 */
+	bool LoadChannelState (string fileName);
+
 private:
 
 	/**
@@ -164,6 +202,13 @@ private:
 	virtual double DoCalcRxPower (double txPowerDbm,
 			Ptr<MobilityModel> a,
 			Ptr<MobilityModel> b) const;
+	/**
+	 * Frames which are only heard as interference get the deterministic contribution and the last slow fading output of the link, but
+	 * neither move the AR filter forward nor draw a fast fading sample
+	 */
+	virtual double DoCalcInterferenceRxPower (double txPowerDbm,
+			Ptr<MobilityModel> a,
+			Ptr<MobilityModel> b) const;
 
 	/* AR mode parameters */
 	int m_order;               /* Order of the AR filter  */
@@ -0,0 +1,146 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/log.h"
+
+#include "channel-realization-error-model.h"
+
+using namespace std;
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("ChannelRealizationErrorModel");
+NS_OBJECT_ENSURE_REGISTERED (ChannelRealizationErrorModel);
+
+TypeId
+ChannelRealizationErrorModel::GetTypeId(void) {
+	static TypeId tid = TypeId ("ns3::ChannelRealizationErrorModel")
+	.SetParent <ErrorModel> ()
+	.AddConstructor<ChannelRealizationErrorModel> ()
+	       ;
+  return tid;
+}
+
+ChannelRealizationErrorModel::ChannelRealizationErrorModel()
+	: m_fer (0.0),
+	  m_currentValue (0.0),
+	  m_txIndex (0),
+	  m_rxIndex (0)
+{
+	NS_LOG_FUNCTION (this);
+}
+
+ChannelRealizationErrorModel::~ChannelRealizationErrorModel()
+{
+	NS_LOG_FUNCTION (this);
+}
+
+bool ChannelRealizationErrorModel::DoCorrupt(Ptr<Packet> packet)
+{
+	NS_LOG_FUNCTION(this);
+	bool corruptedPacket = false;
+	const ChannelRealizationSample *sample = 0;
+	LlcSnapHeader llcHdr;
+	Ipv4Header ipv4Hdr;
+	TcpHeader tcpHdr;
+
+	//Locate the sample in force for the link
+	if (m_realization)
+		sample = m_realization->GetSample (m_txIndex, m_rxIndex, Simulator::Now().GetNanoSeconds());
+
+	if (sample)
+	{
+		m_fer = sample->m_fer;
+		m_currentValue = sample->m_value;
+	}
+	else
+	{
+		NS_LOG_LOGIC ("Link " << m_txIndex << " -> " << m_rxIndex << " not held by the realization");
+		m_fer = 0.0;
+	}
+
+	//The MAC header is read in place; only the unicast data frames are copied to parse the upper layers
+	WifiMacHeaderView hdr (packet);
+
+	//Only unicast data frames are prone to errors (ARP, TCP ACKs, 802.11 ACKs, broadcast and control/management frames are always correct)
+	if (hdr.IsData() && !hdr.GetAddr1().IsBroadcast())
+	{
+		Ptr<Packet> pktCopy = packet->Copy();
+		pktCopy->RemoveAtStart(hdr.GetSize());
+		pktCopy->RemoveHeader(llcHdr);
+		if (llcHdr.GetType() == 0x0800)				//IP packet
+		{
+			pktCopy->RemoveHeader(ipv4Hdr);
+			switch (ipv4Hdr.GetProtocol())
+			{
+			case 6:				//TCP
+				pktCopy->RemoveHeader(tcpHdr);
+				corruptedPacket = (pktCopy->GetSize() > 4) ? Decide () : false;
+				break;
+			case 17:			//UDP
+				corruptedPacket = Decide ();
+				break;
+			default:
+				NS_LOG_ERROR ("Protocol not implemented yet (IP) --> " << ipv4Hdr.GetProtocol());
+				break;
+			}
+		}
+	}
+
+	return corruptedPacket;
+}
+
+bool ChannelRealizationErrorModel::Decide ()
+{
+	NS_LOG_FUNCTION_NOARGS ();
+
+	if (m_uniform.GetValue() < m_fer)
+	{
+		NS_LOG_LOGIC("CORRUPT! (" << this << ") (" << Simulator::Now().GetSeconds() << ") Value: " << m_currentValue);
+		return true;
+	}
+	NS_LOG_LOGIC("CORRECT! (" << this << ") (" << Simulator::Now().GetSeconds() << ") Value: " << m_currentValue);
+	return false;
+}
+
+void ChannelRealizationErrorModel::DoReset (void)
+{
+	NS_LOG_FUNCTION_NOARGS();
+}
+
+void ChannelRealizationErrorModel::SetTxIndex (u_int16_t tx)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+	m_txIndex = tx;
+}
+
+void ChannelRealizationErrorModel::SetRxIndex (u_int16_t rx)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+	m_rxIndex = rx;
+}
+
+double ChannelRealizationErrorModel::GetCurrentValue () const
+{
+	return m_currentValue;
+}
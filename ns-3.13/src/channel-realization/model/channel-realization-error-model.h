@@ -0,0 +1,107 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#ifndef CHANNEL_REALIZATION_ERROR_MODEL_H_
+#define CHANNEL_REALIZATION_ERROR_MODEL_H_
+
+#include <unistd.h>
+
+#include "ns3/object.h"
+#include "ns3/random-variable.h"
+#include "ns3/error-model.h"
+
+//Parse the headers involved on the error decision
+#include "ns3/wifi-mac-header.h"
+#include "ns3/wifi-mac-header-view.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/tcp-header.h"
+#include "ns3/udp-header.h"
+
+#include "channel-realization-file.h"
+
+using namespace std;
+namespace ns3 {
+
+class Packet;
+
+/**
+ * \ingroup errormodel
+ * \brief Error model which plays back a precomputed channel realization (see ChannelRealizationGenerator): the FER of a data frame is
+ * taken from the sample in force for the link at the reception time. The same frame classes as in the HiddenMarkovErrorModel are
+ * subject to errors (unicast UDP and TCP data segments); the rest is always received correctly
+ */
+class ChannelRealizationErrorModel: public ErrorModel {
+public:
+	/**
+	 * Attribute handler
+	 */
+	static TypeId GetTypeId (void);
+	/**
+	 * Default constructor
+	 */
+	ChannelRealizationErrorModel ();
+	/**
+	 * Default destructor
+	 */
+	virtual ~ChannelRealizationErrorModel ();
+
+	/**
+	 * Realization shared with the ChannelRealizationPropagationLossModel
+	 */
+	inline void SetRealization (Ptr<ChannelRealizationFile> realization) {m_realization = realization;}
+
+	/**
+	 * \param tx The Node ID of the transmitter entity
+	 */
+	void SetTxIndex (u_int16_t tx);
+	/**
+	 * \param rx The Node ID of the receiver entity
+	 */
+	void SetRxIndex (u_int16_t rx);
+
+	/**
+	 * \returns The model value (BEAR: SNR, HMM: state) of the last decided frame
+	 */
+	double GetCurrentValue () const;
+
+private:
+
+	virtual bool DoCorrupt (Ptr<Packet>);
+	virtual void DoReset (void);
+
+	/**
+	 * \returns Whether a data frame is corrupted, according to the current FER
+	 */
+	bool Decide ();
+
+	UniformVariable m_uniform;
+	Ptr<ChannelRealizationFile> m_realization;
+	double m_fer;
+	double m_currentValue;
+
+	u_int16_t m_txIndex;
+	u_int16_t m_rxIndex;
+};
+
+}    ////namespace ns3
+#endif /* CHANNEL_REALIZATION_ERROR_MODEL_H_ */
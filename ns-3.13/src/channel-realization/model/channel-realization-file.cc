@@ -0,0 +1,224 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ns3/log.h"
+#include "ns3/channel-mesh-propagation-handler.h"
+
+#include "channel-realization-file.h"
+
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE ("ChannelRealizationFile");
+
+namespace ns3 {
+
+//Version 2: samples hold the gain of the link instead of the absolute received power
+static const string g_realizationTag = "REALIZATION2";
+
+ChannelRealizationFile::ChannelRealizationFile ()
+	: m_nodes (0),
+	  m_mapping (0),
+	  m_length (0)
+{
+}
+
+ChannelRealizationFile::~ChannelRealizationFile ()
+{
+	Close ();
+}
+
+bool
+ChannelRealizationFile::Write (string fileName, const linkSet_t &links)
+{
+	NS_LOG_FUNCTION (fileName << links.size ());
+	ofstream realizationFile;
+	linkSet_t::const_iterator iter;
+	u_int64_t offset;
+
+	realizationFile.open ((const char *) fileName.c_str (), ios::out | ios::binary | ios::trunc);
+	if (!realizationFile)
+	{
+		NS_LOG_ERROR ("Cannot create the realization file " << fileName);
+		return false;
+	}
+
+	ChannelMeshCheckpoint::WriteHeader (realizationFile, g_realizationTag, links.size ());
+
+	//Samples start right after the link records, aligned to 8 bytes so that they can be accessed straight from the mapped file
+	offset = (u_int64_t) realizationFile.tellp () + links.size () * (2 * sizeof (u_int32_t) + 2 * sizeof (u_int64_t));
+	offset = (offset + 7) & ~((u_int64_t) 7);
+
+	for (iter = links.begin (); iter != links.end (); iter++)
+	{
+		ChannelMeshCheckpoint::Write<u_int32_t> (realizationFile, iter->first.first);
+		ChannelMeshCheckpoint::Write<u_int32_t> (realizationFile, iter->first.second);
+		ChannelMeshCheckpoint::Write<u_int64_t> (realizationFile, offset);
+		ChannelMeshCheckpoint::Write<u_int64_t> (realizationFile, iter->second.size ());
+		offset += iter->second.size () * sizeof (ChannelRealizationSample);
+	}
+
+	while (realizationFile.tellp () % 8)
+	{
+		realizationFile.put (0);
+	}
+
+	for (iter = links.begin (); iter != links.end (); iter++)
+	{
+		if (iter->second.size ())
+		{
+			realizationFile.write (reinterpret_cast<const char *> (&iter->second[0]), iter->second.size () * sizeof (ChannelRealizationSample));
+		}
+	}
+
+	realizationFile.close ();
+	return !realizationFile.fail ();
+}
+
+bool
+ChannelRealizationFile::Open (string fileName)
+{
+	NS_LOG_FUNCTION (fileName);
+	ifstream realizationFile;
+	struct stat fileStatus;
+	u_int32_t i, links, tx, rx;
+	u_int64_t offset, count;
+	vector<u_int32_t> txIds, rxIds;
+	vector<u_int64_t> offsets, counts;
+	int fd;
+
+	Close ();
+
+	//1 - Parse the header and the link records
+	realizationFile.open ((const char *) fileName.c_str (), ios::in | ios::binary);
+	if (!realizationFile || !ChannelMeshCheckpoint::ReadHeader (realizationFile, g_realizationTag, links))
+	{
+		NS_LOG_ERROR ("Cannot read the realization file " << fileName);
+		return false;
+	}
+
+	for (i = 0; i < links; i++)
+	{
+		if (!ChannelMeshCheckpoint::Read (realizationFile, tx) || !ChannelMeshCheckpoint::Read (realizationFile, rx)
+				|| !ChannelMeshCheckpoint::Read (realizationFile, offset) || !ChannelMeshCheckpoint::Read (realizationFile, count))
+		{
+			NS_LOG_ERROR ("Truncated realization file " << fileName);
+			return false;
+		}
+		txIds.push_back (tx);
+		rxIds.push_back (rx);
+		offsets.push_back (offset);
+		counts.push_back (count);
+		m_nodes = max (m_nodes, max (tx, rx) + 1);
+	}
+	realizationFile.close ();
+
+	//2 - Map the whole file; the samples are read in place
+	fd = open (fileName.c_str (), O_RDONLY);
+	if (fd < 0 || fstat (fd, &fileStatus) < 0)
+	{
+		NS_LOG_ERROR ("Cannot open the realization file " << fileName);
+		if (fd >= 0)
+			close (fd);
+		m_nodes = 0;
+		return false;
+	}
+
+	m_length = fileStatus.st_size;
+	m_mapping = mmap (0, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (m_mapping == MAP_FAILED)
+	{
+		NS_LOG_ERROR ("Cannot map the realization file " << fileName);
+		m_mapping = 0;
+		m_length = 0;
+		m_nodes = 0;
+		return false;
+	}
+
+	//3 - Build the dense link index
+	Trace empty = {0, 0, 0};
+	m_traces.assign ((size_t) m_nodes * m_nodes, empty);
+	for (i = 0; i < links; i++)
+	{
+		if (offsets[i] % 8 || offsets[i] + counts[i] * sizeof (ChannelRealizationSample) > m_length)
+		{
+			NS_LOG_ERROR ("Link " << txIds[i] << " -> " << rxIds[i] << " out of the file bounds, cannot continue");
+			Close ();
+			return false;
+		}
+		Trace &trace = m_traces[(size_t) txIds[i] * m_nodes + rxIds[i]];
+		trace.m_samples = reinterpret_cast<const ChannelRealizationSample *> (static_cast<const char *> (m_mapping) + offsets[i]);
+		trace.m_count = counts[i];
+		trace.m_cursor = 0;
+	}
+
+	NS_LOG_DEBUG ("Realization file " << fileName << " mapped: " << links << " links, " << m_length << " bytes");
+	return true;
+}
+
+bool
+ChannelRealizationFile::IsOpen () const
+{
+	return m_mapping != 0;
+}
+
+const ChannelRealizationSample *
+ChannelRealizationFile::GetSample (u_int32_t tx, u_int32_t rx, int64_t time)
+{
+	if (tx >= m_nodes || rx >= m_nodes)
+		return 0;
+
+	Trace &trace = m_traces[(size_t) tx * m_nodes + rx];
+	if (!trace.m_count)
+		return 0;
+
+	//The time should not move backwards (unless a new simulation is run over the same realization)
+	if (time < trace.m_samples[trace.m_cursor].m_time)
+		trace.m_cursor = 0;
+
+	while (trace.m_cursor + 1 < trace.m_count && trace.m_samples[trace.m_cursor + 1].m_time <= time)
+	{
+		trace.m_cursor++;
+	}
+	return &trace.m_samples[trace.m_cursor];
+}
+
+void
+ChannelRealizationFile::Close ()
+{
+	if (m_mapping)
+	{
+		munmap (m_mapping, m_length);
+	}
+	m_mapping = 0;
+	m_length = 0;
+	m_nodes = 0;
+	m_traces.clear ();
+}
+
+} // namespace ns3
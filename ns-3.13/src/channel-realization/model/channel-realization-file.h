@@ -0,0 +1,118 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#ifndef CHANNEL_REALIZATION_FILE_H_
+#define CHANNEL_REALIZATION_FILE_H_
+
+#include <map>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+/**
+ * \brief One step of the (piecewise-constant) channel process of a link: from m_time on (and until the next sample) the link will
+ * yield the given gain, model value (SNR for BEAR, current state for HMM) and FER for data frames
+ */
+struct ChannelRealizationSample
+{
+	int64_t m_time;					//Simulation time (ns)
+	double m_gainDb;				//Gain of the propagation loss model (rx power - tx power)
+	double m_value;					//BEAR: SNR (dB); HMM: current state
+	double m_fer;					//Error probability of a data frame
+};
+
+/**
+ * \ingroup propagation
+ * \brief Precomputed channel realization: the channel process of every link (as generated by ChannelRealizationGenerator) is stored in
+ * a binary file, which is memory-mapped during the playback, so that the channel cost per frame is a lookup and different protocol
+ * configurations can be compared over exactly the same channel. File layout (native byte order):
+ *  - ChannelMeshCheckpoint header, with the "REALIZATION2" tag and the number of links L
+ *  - L link records: tx ID (u32), rx ID (u32), offset of the first sample from the beginning of the file (u64), number of samples (u64)
+ *  - Zero padding up to a multiple of 8 bytes
+ *  - The samples of every link (ChannelRealizationSample, sorted by time)
+ */
+class ChannelRealizationFile : public SimpleRefCount<ChannelRealizationFile>
+{
+public:
+	typedef std::map<std::pair<u_int32_t, u_int32_t>, std::vector<ChannelRealizationSample> > linkSet_t;
+
+	ChannelRealizationFile ();
+	~ChannelRealizationFile ();
+
+	/**
+	 * \brief Dump a set of link realizations into a file
+	 * \param fileName Realization file
+	 * \param links Samples of each link, indexed by the (tx, rx) node IDs
+	 * \returns False if the file could not be written
+	 */
+	static bool Write (std::string fileName, const linkSet_t &links);
+
+	/**
+	 * \brief Map a realization file into memory
+	 * \param fileName Realization file
+	 * \returns False if the file could not be mapped or it is not a valid realization file
+	 */
+	bool Open (std::string fileName);
+
+	/**
+	 * \returns True if a realization file is currently mapped
+	 */
+	bool IsOpen () const;
+
+	/**
+	 * \brief Locate the sample in force at a given time. Each link keeps a cursor to its last sample, so that the lookup is O(1) as
+	 * long as the simulation time moves forward
+	 * \param tx Transmitter node ID
+	 * \param rx Receiver node ID
+	 * \param time Simulation time (ns)
+	 * \returns The sample, or 0 if the link is not held by the realization
+	 */
+	const ChannelRealizationSample * GetSample (u_int32_t tx, u_int32_t rx, int64_t time);
+
+private:
+	ChannelRealizationFile (const ChannelRealizationFile &);
+	ChannelRealizationFile & operator = (const ChannelRealizationFile &);
+
+	void Close ();
+
+	struct Trace
+	{
+		const ChannelRealizationSample *m_samples;
+		u_int64_t m_count;
+		u_int64_t m_cursor;
+	};
+
+	std::vector<Trace> m_traces;			//Dense (tx * m_nodes + rx) index
+	u_int32_t m_nodes;
+	void *m_mapping;
+	size_t m_length;
+};
+
+} // namespace ns3
+
+#endif /* CHANNEL_REALIZATION_FILE_H_ */
@@ -0,0 +1,141 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/bear-propagation-loss-model.h"
+#include "ns3/hidden-markov-propagation-loss-model.h"
+
+#include "channel-realization-generator.h"
+
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE ("ChannelRealizationGenerator");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ChannelRealizationGenerator);
+
+TypeId
+ChannelRealizationGenerator::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::ChannelRealizationGenerator")
+	.SetParent<Object> ()
+	.AddConstructor<ChannelRealizationGenerator> ()
+	.AddAttribute ("SamplingInterval",
+			"Time between two consecutive evaluations of the channel model",
+			TimeValue (MilliSeconds (1)),
+			MakeTimeAccessor (&ChannelRealizationGenerator::m_samplingInterval),
+			MakeTimeChecker ())
+	.AddAttribute ("Duration",
+			"Length of the generated realization",
+			TimeValue (Seconds (100)),
+			MakeTimeAccessor (&ChannelRealizationGenerator::m_duration),
+			MakeTimeChecker ())
+	.AddAttribute ("TxPower",
+			"Transmission power (dBm) used to evaluate the propagation loss model",
+			DoubleValue (16.0206),
+			MakeDoubleAccessor (&ChannelRealizationGenerator::m_txPowerDbm),
+			MakeDoubleChecker<double> ())
+	;
+	return tid;
+}
+
+ChannelRealizationGenerator::ChannelRealizationGenerator ()
+{
+	NS_LOG_FUNCTION (this);
+}
+
+ChannelRealizationGenerator::~ChannelRealizationGenerator ()
+{
+	NS_LOG_FUNCTION (this);
+}
+
+bool
+ChannelRealizationGenerator::Generate (Ptr<PropagationLossModel> model, string fileName)
+{
+	NS_LOG_FUNCTION (this << model << fileName);
+	Ptr<BearPropagationLossModel> bear = DynamicCast<BearPropagationLossModel> (model);
+	Ptr<HiddenMarkovPropagationLossModel> hmm = DynamicCast<HiddenMarkovPropagationLossModel> (model);
+
+	if (bear)
+		m_links = bear->GetLinks ();
+	else if (hmm)
+		m_links = hmm->GetLinks ();
+	else
+	{
+		NS_LOG_ERROR ("Only BEAR and HMM models can be used to generate a channel realization");
+		return false;
+	}
+
+	m_source = model;
+	m_realization.clear ();
+
+	Simulator::ScheduleNow (&ChannelRealizationGenerator::Sample, this);
+	Simulator::Stop (m_duration);
+	Simulator::Run ();
+
+	NS_LOG_DEBUG ("Realization of " << m_links.size () << " links generated (" << m_duration.GetSeconds () << " s)");
+	return ChannelRealizationFile::Write (fileName, m_realization);
+}
+
+void
+ChannelRealizationGenerator::Sample ()
+{
+	NS_LOG_FUNCTION (this << Simulator::Now ().GetSeconds ());
+	Ptr<BearPropagationLossModel> bear = DynamicCast<BearPropagationLossModel> (m_source);
+	Ptr<HiddenMarkovPropagationLossModel> hmm = DynamicCast<HiddenMarkovPropagationLossModel> (m_source);
+	vector<ChannelMeshPropagationKey>::const_iterator link;
+	ChannelRealizationSample sample;
+
+	for (link = m_links.begin (); link != m_links.end (); link++)
+	{
+		//Links are independent, each evaluation only advances the process of its own link
+		sample.m_time = Simulator::Now ().GetNanoSeconds ();
+		//Store the gain, so that the playback keeps the tx power and the losses of the rest of the chain
+		sample.m_gainDb = m_source->CalcRxPower (m_txPowerDbm, link->m_link.first, link->m_link.second) - m_txPowerDbm;
+
+		if (bear)
+		{
+			sample.m_value = bear->GetLinkEntry (link->m_link.first, link->m_link.second)->GetCurrentSnr ();
+			sample.m_fer = bear->GetErrorModel ()->GetDataFer (sample.m_value);
+		}
+		else
+		{
+			Ptr<HiddenMarkovModelEntry> entry = hmm->GetLinkEntry (link->m_link.first, link->m_link.second);
+			sample.m_value = entry->GetCurrentState ();
+			sample.m_fer = entry->GetDecisionValue (entry->GetCurrentState ());
+		}
+
+		vector<ChannelRealizationSample> &trace = m_realization[make_pair (link->m_tx, link->m_rx)];
+		if (trace.empty () || trace.back ().m_gainDb != sample.m_gainDb || trace.back ().m_value != sample.m_value
+				|| trace.back ().m_fer != sample.m_fer)
+		{
+			trace.push_back (sample);
+		}
+	}
+
+	Simulator::Schedule (m_samplingInterval, &ChannelRealizationGenerator::Sample, this);
+}
+
+} // namespace ns3
@@ -0,0 +1,87 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#ifndef CHANNEL_REALIZATION_GENERATOR_H_
+#define CHANNEL_REALIZATION_GENERATOR_H_
+
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/channel-mesh-propagation-handler.h"
+
+#include "channel-realization-file.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup propagation
+ * \brief Offline generator of channel realizations. It drives a memory-channel model (BearPropagationLossModel or
+ * HiddenMarkovPropagationLossModel, already initialized with its links) without any protocol stack: every SamplingInterval the model is
+ * evaluated over all its links and the resulting (time, gain, SNR/state, FER) process is stored into a ChannelRealizationFile,
+ * which can be later played back by ChannelRealizationPropagationLossModel. Only the changes of the process are stored, so a HMM link
+ * takes one sample per state change. Note that, for frame-based models, each sample is equivalent to the reception of a frame
+ */
+class ChannelRealizationGenerator : public Object
+{
+public:
+	/**
+	 * Attribute handler
+	 */
+	static TypeId GetTypeId (void);
+	/**
+	 * Default constructor
+	 */
+	ChannelRealizationGenerator ();
+	/**
+	 * Default destructor
+	 */
+	virtual ~ChannelRealizationGenerator ();
+
+	/**
+	 * \brief Run the simulator during the configured Duration, sampling every link of the model, and dump the realization into a file.
+	 * It must be called before the protocol stack is set up (i.e. from an standalone program), since Simulator::Run is invoked
+	 * \param model Memory-channel model (BEAR or HMM) whose links will be sampled
+	 * \param fileName Realization file
+	 * \returns False if the model is not supported or the file could not be written
+	 */
+	bool Generate (Ptr<PropagationLossModel> model, std::string fileName);
+
+private:
+	/**
+	 * Evaluate the model over every link and append the samples which differ from the previous ones
+	 */
+	void Sample ();
+
+	Time m_samplingInterval;
+	Time m_duration;
+	double m_txPowerDbm;
+
+	Ptr<PropagationLossModel> m_source;
+	std::vector<ChannelMeshPropagationKey> m_links;
+	ChannelRealizationFile::linkSet_t m_realization;
+};
+
+} // namespace ns3
+
+#endif /* CHANNEL_REALIZATION_GENERATOR_H_ */
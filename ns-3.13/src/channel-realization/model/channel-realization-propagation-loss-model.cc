@@ -0,0 +1,99 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/node.h"
+
+#include "channel-realization-propagation-loss-model.h"
+
+using namespace std;
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("ChannelRealizationPropagationLossModel");
+NS_OBJECT_ENSURE_REGISTERED (ChannelRealizationPropagationLossModel);
+
+TypeId
+ChannelRealizationPropagationLossModel::GetTypeId(void) {
+	static TypeId tid = TypeId ("ns3::ChannelRealizationPropagationLossModel")
+	.SetParent <PropagationLossModel> ()
+	.AddConstructor<ChannelRealizationPropagationLossModel> ()
+	.AddAttribute ("FileName",
+			"Realization file to play back",
+			StringValue (""),
+			MakeStringAccessor (&ChannelRealizationPropagationLossModel::SetFileName),
+			MakeStringChecker ())
+	;
+	return tid;
+}
+
+ChannelRealizationPropagationLossModel::ChannelRealizationPropagationLossModel()
+{
+	NS_LOG_FUNCTION (this);
+
+	//Create the error model and share the realization
+	m_realization = Create<ChannelRealizationFile> ();
+	m_error = CreateObject<ChannelRealizationErrorModel> ();
+	m_error->SetRealization (m_realization);
+}
+
+ChannelRealizationPropagationLossModel::~ChannelRealizationPropagationLossModel()
+{
+	NS_LOG_FUNCTION (this);
+}
+
+bool ChannelRealizationPropagationLossModel::SetRealizationFile (string fileName)
+{
+	NS_LOG_FUNCTION (fileName);
+	m_fileName = fileName;
+	if (fileName.empty())
+		return false;
+	return m_realization->Open (fileName);
+}
+
+void ChannelRealizationPropagationLossModel::SetFileName (string fileName)
+{
+	if (!SetRealizationFile (fileName) && !fileName.empty())
+	{
+		NS_LOG_ERROR ("Cannot load the realization file " << fileName << "; links will not be attenuated");
+	}
+}
+
+double ChannelRealizationPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+	NS_LOG_FUNCTION (a << b << Simulator::Now().GetSeconds());
+	const ChannelRealizationSample *sample;
+
+	sample = m_realization->GetSample (a->GetObject<Node> ()->GetId (), b->GetObject<Node> ()->GetId (),
+			Simulator::Now().GetNanoSeconds());
+
+	if (sample)
+	{
+		NS_LOG_DEBUG (Simulator::Now().GetSeconds() << ": Channel found " << a->GetObject<Node> ()->GetId () << " -> "
+				<< b->GetObject<Node> ()->GetId () << " Gain: " << sample->m_gainDb << " Value: " << sample->m_value << " FER: " << sample->m_fer);
+		return txPowerDbm + sample->m_gainDb;
+	}
+
+	NS_LOG_LOGIC ("Link not found");
+	return txPowerDbm;
+}
@@ -0,0 +1,87 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+
+#ifndef CHANNEL_REALIZATION_PROPAGATION_LOSS_MODEL_H_
+#define CHANNEL_REALIZATION_PROPAGATION_LOSS_MODEL_H_
+
+#include <string>
+
+#include "ns3/object.h"
+#include "ns3/mobility-model.h"
+#include "ns3/propagation-loss-model.h"
+
+#include "channel-realization-file.h"
+#include "channel-realization-error-model.h"
+
+using namespace std;
+namespace ns3 {
+
+/**
+ * \ingroup propagation
+ * \brief Playback of a precomputed channel realization (see ChannelRealizationGenerator). Instead of simulating the BEAR/HMM channel,
+ * the gain of each link is taken from the realization file, which is memory-mapped, hence the cost per frame is a single
+ * lookup. The gain is added to the tx power, so the tx power and the losses of the models before this one are kept. Its ChannelRealizationErrorModel (created along with this object) shares the realization to decide the frame errors
+ */
+class ChannelRealizationPropagationLossModel : public PropagationLossModel
+{
+public:
+	/**
+	 * Attribute handler
+	 */
+	static TypeId GetTypeId (void);
+	/**
+	 * Default constructor
+	 */
+	ChannelRealizationPropagationLossModel ();
+	/**
+	 * Default destructor
+	 */
+	virtual ~ChannelRealizationPropagationLossModel ();
+
+	/**
+	 * \param fileName Realization file (created by ChannelRealizationGenerator)
+	 * \returns False if the file could not be mapped
+	 */
+	bool SetRealizationFile (string fileName);
+
+	/**
+	 * \returns The error model linked to this class
+	 */
+	inline Ptr<ChannelRealizationErrorModel> GetErrorModel () {return m_error;}
+
+private:
+	/**
+	 * FileName attribute setter
+	 */
+	void SetFileName (string fileName);
+
+	virtual double DoCalcRxPower (double txPowerDbm,
+			Ptr<MobilityModel> a,
+			Ptr<MobilityModel> b) const;
+
+	string m_fileName;
+	Ptr<ChannelRealizationFile> m_realization;
+	Ptr<ChannelRealizationErrorModel> m_error;
+};
+
+}    ////namespace ns3
+#endif /* CHANNEL_REALIZATION_PROPAGATION_LOSS_MODEL_H_ */
@@ -0,0 +1,266 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include <fstream>
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/wifi-mac-header.h"
+#include "ns3/wifi-mac-trailer.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/tcp-header.h"
+#include "ns3/udp-header.h"
+#include "ns3/channel-realization-file.h"
+#include "ns3/channel-realization-propagation-loss-model.h"
+
+using namespace ns3;
+
+static ChannelRealizationSample
+MakeSample (int64_t time, double gainDb, double value, double fer)
+{
+	ChannelRealizationSample sample;
+	sample.m_time = time;
+	sample.m_gainDb = gainDb;
+	sample.m_value = value;
+	sample.m_fer = fer;
+	return sample;
+}
+
+/**
+ * A realization dumped by ChannelRealizationFile::Write is mapped back by Open: every link yields the sample in force at the
+ * requested time, also when the time is rewound, and the links which are not held by the realization yield none
+ */
+class ChannelRealizationFileTestCase : public TestCase
+{
+public:
+	ChannelRealizationFileTestCase ();
+
+private:
+	virtual void DoRun (void);
+};
+
+ChannelRealizationFileTestCase::ChannelRealizationFileTestCase ()
+	: TestCase ("Check that a channel realization is read back as it was written")
+{
+}
+
+void ChannelRealizationFileTestCase::DoRun (void)
+{
+	ChannelRealizationFile::linkSet_t links;
+	const ChannelRealizationSample *sample;
+
+	links[std::make_pair (0u, 1u)].push_back (MakeSample (0, -60.0, 1.0, 0.0));
+	links[std::make_pair (0u, 1u)].push_back (MakeSample (1000, -70.0, 2.0, 0.5));
+	links[std::make_pair (0u, 1u)].push_back (MakeSample (3000, -80.0, 3.0, 1.0));
+	links[std::make_pair (2u, 0u)].push_back (MakeSample (0, -65.0, 0.0, 0.25));
+
+	std::string fileName = CreateTempDirFilename ("channel-realization.bin");
+	NS_TEST_ASSERT_MSG_EQ (ChannelRealizationFile::Write (fileName, links), true, "Cannot write the realization");
+
+	Ptr<ChannelRealizationFile> realization = Create<ChannelRealizationFile> ();
+	NS_TEST_ASSERT_MSG_EQ (realization->Open (fileName), true, "Cannot read the realization back");
+	NS_TEST_ASSERT_MSG_EQ (realization->IsOpen (), true, "The realization should be mapped");
+
+	//Every sample is in force from its time until the next one
+	int64_t times[] = {0, 999, 1000, 2999, 3000, 100000};
+	int64_t sampleTimes[] = {0, 0, 1000, 1000, 3000, 3000};
+	double gains[] = {-60.0, -60.0, -70.0, -70.0, -80.0, -80.0};
+	double values[] = {1.0, 1.0, 2.0, 2.0, 3.0, 3.0};
+	double fers[] = {0.0, 0.0, 0.5, 0.5, 1.0, 1.0};
+	for (u_int32_t i = 0; i < 6; i++)
+	{
+		sample = realization->GetSample (0, 1, times[i]);
+		NS_TEST_ASSERT_MSG_NE (sample, 0, "Link 0 -> 1 not found at " << times[i]);
+		NS_TEST_ASSERT_MSG_EQ (sample->m_time, sampleTimes[i], "Wrong sample at " << times[i]);
+		NS_TEST_ASSERT_MSG_EQ (sample->m_gainDb, gains[i], "Wrong gain at " << times[i]);
+		NS_TEST_ASSERT_MSG_EQ (sample->m_value, values[i], "Wrong value at " << times[i]);
+		NS_TEST_ASSERT_MSG_EQ (sample->m_fer, fers[i], "Wrong FER at " << times[i]);
+	}
+
+	//A new run over the same realization starts again from the first sample
+	sample = realization->GetSample (0, 1, 500);
+	NS_TEST_ASSERT_MSG_EQ (sample->m_fer, 0.0, "The cursor should be rewound when the time moves backwards");
+
+	sample = realization->GetSample (2, 0, 5000);
+	NS_TEST_ASSERT_MSG_NE (sample, 0, "Link 2 -> 0 not found");
+	NS_TEST_ASSERT_MSG_EQ (sample->m_fer, 0.25, "Wrong FER of link 2 -> 0");
+
+	//Links which are not held by the realization
+	NS_TEST_ASSERT_MSG_EQ (realization->GetSample (1, 0, 0), 0, "Link 1 -> 0 is not in the realization");
+	NS_TEST_ASSERT_MSG_EQ (realization->GetSample (0, 7, 0), 0, "Node 7 is not in the realization");
+
+	//A truncated file is rejected
+	std::string truncatedName = CreateTempDirFilename ("channel-realization-truncated.bin");
+	std::ifstream original (fileName.c_str (), std::ios::in | std::ios::binary);
+	std::ofstream truncated (truncatedName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+	std::vector<char> buffer (40);
+	original.read (&buffer[0], buffer.size ());
+	truncated.write (&buffer[0], original.gcount ());
+	truncated.close ();
+
+	Ptr<ChannelRealizationFile> broken = Create<ChannelRealizationFile> ();
+	NS_TEST_ASSERT_MSG_EQ (broken->Open (truncatedName), false, "A truncated realization should not be mapped");
+	NS_TEST_ASSERT_MSG_EQ (broken->IsOpen (), false, "A truncated realization should not be mapped");
+}
+
+/**
+ * Playback of a realization: the propagation loss model adds the gain of the sample in force to the tx power, and the error model
+ * decides each frame with the FER of that sample (0 or 1 here, so that the decisions are deterministic). Only unicast UDP and TCP
+ * data segments are prone to errors
+ */
+class ChannelRealizationPlaybackTestCase : public TestCase
+{
+public:
+	ChannelRealizationPlaybackTestCase ();
+
+private:
+	virtual void DoRun (void);
+	void CheckFrames (bool udpCorrupted, double value, double rxPowerDbm);
+	Ptr<Packet> CreateFrame (u_int8_t protocol, u_int32_t payloadSize, bool broadcast) const;
+
+	Ptr<ChannelRealizationPropagationLossModel> m_model;
+	Ptr<MobilityModel> m_txMobility;
+	Ptr<MobilityModel> m_rxMobility;
+	u_int32_t m_nChecks;
+};
+
+ChannelRealizationPlaybackTestCase::ChannelRealizationPlaybackTestCase ()
+	: TestCase ("Check the per-frame decisions of the channel realization playback"),
+	  m_nChecks (0)
+{
+}
+
+Ptr<Packet> ChannelRealizationPlaybackTestCase::CreateFrame (u_int8_t protocol, u_int32_t payloadSize, bool broadcast) const
+{
+	Ptr<Packet> frame = Create<Packet> (payloadSize);
+	LlcSnapHeader llcHdr;
+	Ipv4Header ipv4Hdr;
+	WifiMacHeader hdr;
+	WifiMacTrailer fcs;
+
+	if (protocol == 6)
+	{
+		TcpHeader tcpHdr;
+		tcpHdr.SetFlags (TcpHeader::ACK);
+		frame->AddHeader (tcpHdr);
+	}
+	else
+	{
+		UdpHeader udpHdr;
+		frame->AddHeader (udpHdr);
+	}
+	ipv4Hdr.SetSource (Ipv4Address ("10.0.0.1"));
+	ipv4Hdr.SetDestination (Ipv4Address ("10.0.0.2"));
+	ipv4Hdr.SetProtocol (protocol);
+	ipv4Hdr.SetPayloadSize (frame->GetSize ());
+	frame->AddHeader (ipv4Hdr);
+	llcHdr.SetType (0x0800);
+	frame->AddHeader (llcHdr);
+
+	hdr.SetType (WIFI_MAC_DATA);
+	hdr.SetAddr1 (broadcast ? Mac48Address::GetBroadcast () : Mac48Address ("00:00:00:00:00:02"));
+	hdr.SetAddr2 (Mac48Address ("00:00:00:00:00:01"));
+	hdr.SetAddr3 (Mac48Address ("00:00:00:00:00:03"));
+	frame->AddHeader (hdr);
+	frame->AddTrailer (fcs);
+
+	return frame;
+}
+
+void ChannelRealizationPlaybackTestCase::CheckFrames (bool udpCorrupted, double value, double rxPowerDbm)
+{
+	Ptr<ChannelRealizationErrorModel> error = m_model->GetErrorModel ();
+	m_nChecks++;
+
+	NS_TEST_EXPECT_MSG_EQ_TOL (m_model->CalcRxPower (20.0, m_txMobility, m_rxMobility), rxPowerDbm, 1e-9,
+			"Wrong rx power at " << Simulator::Now ().GetSeconds ());
+	NS_TEST_EXPECT_MSG_EQ (error->IsCorrupt (CreateFrame (17, 100, false)), udpCorrupted,
+			"Wrong decision of a UDP datagram at " << Simulator::Now ().GetSeconds ());
+	NS_TEST_EXPECT_MSG_EQ (error->GetCurrentValue (), value, "Wrong model value at " << Simulator::Now ().GetSeconds ());
+	NS_TEST_EXPECT_MSG_EQ (error->IsCorrupt (CreateFrame (6, 500, false)), udpCorrupted,
+			"Wrong decision of a TCP segment at " << Simulator::Now ().GetSeconds ());
+	NS_TEST_EXPECT_MSG_EQ (error->IsCorrupt (CreateFrame (6, 0, false)), false,
+			"A TCP ACK should always be received (" << Simulator::Now ().GetSeconds () << ")");
+	NS_TEST_EXPECT_MSG_EQ (error->IsCorrupt (CreateFrame (17, 100, true)), false,
+			"A broadcast frame should always be received (" << Simulator::Now ().GetSeconds () << ")");
+}
+
+void ChannelRealizationPlaybackTestCase::DoRun (void)
+{
+	Ptr<Node> tx = CreateObject<Node> ();
+	Ptr<Node> rx = CreateObject<Node> ();
+	m_txMobility = CreateObject<ConstantPositionMobilityModel> ();
+	m_rxMobility = CreateObject<ConstantPositionMobilityModel> ();
+	tx->AggregateObject (m_txMobility);
+	rx->AggregateObject (m_rxMobility);
+
+	//Good channel during the first second, bad one during the second, and good again afterwards
+	ChannelRealizationFile::linkSet_t links;
+	links[std::make_pair (tx->GetId (), rx->GetId ())].push_back (MakeSample (0, -60.0, 1.0, 0.0));
+	links[std::make_pair (tx->GetId (), rx->GetId ())].push_back (MakeSample (Seconds (1.0).GetNanoSeconds (), -90.0, 2.0, 1.0));
+	links[std::make_pair (tx->GetId (), rx->GetId ())].push_back (MakeSample (Seconds (2.0).GetNanoSeconds (), -65.0, 3.0, 0.0));
+
+	std::string fileName = CreateTempDirFilename ("channel-realization-playback.bin");
+	NS_TEST_ASSERT_MSG_EQ (ChannelRealizationFile::Write (fileName, links), true, "Cannot write the realization");
+
+	m_model = CreateObject<ChannelRealizationPropagationLossModel> ();
+	NS_TEST_ASSERT_MSG_EQ (m_model->SetRealizationFile (fileName), true, "Cannot load the realization");
+	m_model->GetErrorModel ()->SetTxIndex (tx->GetId ());
+	m_model->GetErrorModel ()->SetRxIndex (rx->GetId ());
+
+	Simulator::Schedule (Seconds (0.5), &ChannelRealizationPlaybackTestCase::CheckFrames, this, false, 1.0, -40.0);
+	Simulator::Schedule (Seconds (1.0), &ChannelRealizationPlaybackTestCase::CheckFrames, this, true, 2.0, -70.0);
+	Simulator::Schedule (Seconds (1.5), &ChannelRealizationPlaybackTestCase::CheckFrames, this, true, 2.0, -70.0);
+	Simulator::Schedule (Seconds (2.5), &ChannelRealizationPlaybackTestCase::CheckFrames, this, false, 3.0, -45.0);
+	Simulator::Run ();
+
+	NS_TEST_ASSERT_MSG_EQ (m_nChecks, 4u, "Not every playback check was run");
+
+	//The reverse link is not held by the realization: it is not attenuated and its frames are always received
+	Ptr<ChannelRealizationErrorModel> reverse = m_model->GetErrorModel ();
+	reverse->SetTxIndex (rx->GetId ());
+	reverse->SetRxIndex (tx->GetId ());
+	NS_TEST_ASSERT_MSG_EQ_TOL (m_model->CalcRxPower (20.0, m_rxMobility, m_txMobility), 20.0, 1e-9, "The reverse link should not be attenuated");
+	NS_TEST_ASSERT_MSG_EQ (reverse->IsCorrupt (CreateFrame (17, 100, false)), false, "The reverse link should not corrupt any frame");
+
+	m_model = 0;
+	m_txMobility = 0;
+	m_rxMobility = 0;
+	Simulator::Destroy ();
+}
+
+class ChannelRealizationTestSuite : public TestSuite
+{
+public:
+	ChannelRealizationTestSuite ();
+};
+
+ChannelRealizationTestSuite::ChannelRealizationTestSuite ()
+	: TestSuite ("channel-realization", UNIT)
+{
+	AddTestCase (new ChannelRealizationFileTestCase);
+	AddTestCase (new ChannelRealizationPlaybackTestCase);
+}
+
+static ChannelRealizationTestSuite channelRealizationTestSuite;
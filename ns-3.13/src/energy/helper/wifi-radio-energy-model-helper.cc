@@ -22,6 +22,7 @@
 #include "basic-energy-source-helper.h"
 #include "ns3/wifi-phy.h"
 #include "ns3/wifi-net-device.h"
+#include "ns3/yans-wifi-phy.h"
 #include "ns3/config.h"
 #include "ns3/names.h"
 
@@ -79,6 +80,13 @@ WifiRadioEnergyModelHelper::DoInstall (Ptr<NetDevice> device,
   Ptr<WifiNetDevice> wifiDevice = DynamicCast<WifiNetDevice> (device);
   Ptr<WifiPhy> wifiPhy = wifiDevice->GetPhy ();
   wifiPhy->RegisterListener (model->GetPhyListener ());
+  // account the frames dropped by the error model per link and channel state
+  Ptr<YansWifiPhy> yansPhy = DynamicCast<YansWifiPhy> (wifiPhy);
+  if (yansPhy != NULL)
+    {
+      yansPhy->TraceConnectWithoutContext ("PhyRxErrorModelDrop",
+                                           MakeCallback (&WifiRadioEnergyModel::NotifyRxErrorModelDrop, model));
+    }
   return model;
 }
 
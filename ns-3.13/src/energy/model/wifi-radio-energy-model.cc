@@ -20,10 +20,12 @@
 
 #include "ns3/log.h"
 #include "ns3/double.h"
+#include "ns3/uinteger.h"
 #include "ns3/simulator.h"
 #include "ns3/trace-source-accessor.h"
 #include "energy-source.h"
 #include "wifi-radio-energy-model.h"
+#include <math.h>
 
 NS_LOG_COMPONENT_DEFINE ("WifiRadioEnergyModel");
 
@@ -67,6 +69,22 @@ WifiRadioEnergyModel::GetTypeId (void)
                    MakeDoubleAccessor (&WifiRadioEnergyModel::SetSwitchingCurrentA,
                                        &WifiRadioEnergyModel::GetSwitchingCurrentA),
                    MakeDoubleChecker<double> ())
+    .AddAttribute ("ChannelStateBins",
+                   "Number of channel state bins of the energy spent in corrupted receptions. "
+                   "Set it before the first reception is accounted.",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&WifiRadioEnergyModel::m_nChannelStateBins),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ChannelStateBinStart",
+                   "Lower edge of the first channel state bin (HMM state, BEAR SNR in dB...).",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&WifiRadioEnergyModel::m_channelStateBinStart),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("ChannelStateBinWidth",
+                   "Width of the channel state bins (1 for HMM states).",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&WifiRadioEnergyModel::m_channelStateBinWidth),
+                   MakeDoubleChecker<double> (0.0))
     .AddTraceSource ("TotalEnergyConsumption",
                      "Total energy consumption of the radio device.",
                      MakeTraceSourceAccessor (&WifiRadioEnergyModel::m_totalEnergyConsumption))
@@ -255,6 +273,64 @@ WifiRadioEnergyModel::GetPhyListener (void)
   return m_listener;
 }
 
+void
+WifiRadioEnergyModel::NotifyRxErrorModelDrop (Ptr<const Packet> packet, uint16_t txNodeId,
+                                              double channelState, Time duration)
+{
+  NS_LOG_FUNCTION (this << packet << txNodeId << channelState << duration);
+  NS_ASSERT (m_source != NULL);
+
+  // energy = current * voltage * time
+  double energy = duration.GetSeconds () * m_rxCurrentA * m_source->GetSupplyVoltage ();
+  uint32_t index = txNodeId * m_nChannelStateBins + GetChannelStateBin (channelState);
+  if (index >= m_corruptedRxEnergy.size ())
+    {
+      // first frame of a new link
+      m_corruptedRxEnergy.resize ((txNodeId + 1) * m_nChannelStateBins, 0.0);
+      m_corruptedRxCount.resize ((txNodeId + 1) * m_nChannelStateBins, 0);
+    }
+  m_corruptedRxEnergy[index] += energy;
+  m_corruptedRxCount[index]++;
+}
+
+uint32_t
+WifiRadioEnergyModel::GetNChannelStateBins (void) const
+{
+  return m_nChannelStateBins;
+}
+
+uint32_t
+WifiRadioEnergyModel::GetChannelStateBin (double channelState) const
+{
+  NS_ASSERT (m_channelStateBinWidth > 0);
+  double bin = floor ((channelState - m_channelStateBinStart) / m_channelStateBinWidth);
+  if (bin <= 0)
+    {
+      return 0;
+    }
+  if (bin >= m_nChannelStateBins - 1)
+    {
+      return m_nChannelStateBins - 1;
+    }
+  return (uint32_t) bin;
+}
+
+double
+WifiRadioEnergyModel::GetCorruptedRxEnergy (uint16_t txNodeId, uint32_t bin) const
+{
+  NS_ASSERT (bin < m_nChannelStateBins);
+  uint32_t index = txNodeId * m_nChannelStateBins + bin;
+  return (index < m_corruptedRxEnergy.size ()) ? m_corruptedRxEnergy[index] : 0.0;
+}
+
+uint32_t
+WifiRadioEnergyModel::GetCorruptedRxCount (uint16_t txNodeId, uint32_t bin) const
+{
+  NS_ASSERT (bin < m_nChannelStateBins);
+  uint32_t index = txNodeId * m_nChannelStateBins + bin;
+  return (index < m_corruptedRxCount.size ()) ? m_corruptedRxCount[index] : 0;
+}
+
 /*
  * Private functions start here.
  */
@@ -26,6 +26,8 @@
 #include "ns3/event-id.h"
 #include "ns3/traced-value.h"
 #include "ns3/wifi-phy.h"
+#include "ns3/packet.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -142,6 +144,14 @@ private:
  * supply voltage as 2.5V and currents as 17.4 mA (TX), 18.8 mA (RX), 20 uA
  * (sleep) and 426 uA (idle).
  *
+ * Corrupted receptions: the energy spent receiving the frames dropped by the
+ * error model of a YansWifiPhy (BEAR, HMM...) is also accumulated per link
+ * (transmitter node) and per channel state bin, e.g. the HMM state or the
+ * BEAR SNR at which the frame was decided. The channel state is binned into
+ * ChannelStateBins fixed width bins from ChannelStateBinStart; values out of
+ * range fall into the first or last bin. Each frame costs O(1), so that the
+ * energy cost of bursty channels can be quantified without tracing every
+ * frame.
  */
 class WifiRadioEnergyModel : public DeviceEnergyModel
 {
@@ -217,6 +227,50 @@ public:
    */
   WifiRadioEnergyModelPhyListener * GetPhyListener (void);
 
+  /**
+   * \brief Accounts the energy spent receiving a frame dropped by the error
+   * model of the PHY.
+   *
+   * \param packet the dropped frame.
+   * \param txNodeId ID of the node which sent the frame (frames without a
+   * known transmitter, such as ACK and CTS, are not reported).
+   * \param channelState channel state when the frame was decided (HMM state,
+   * BEAR SNR in dB...).
+   * \param duration the reception duration.
+   *
+   * Connected by WifiRadioEnergyModelHelper to the PhyRxErrorModelDrop trace
+   * source of YansWifiPhy.
+   */
+  void NotifyRxErrorModelDrop (Ptr<const Packet> packet, uint16_t txNodeId,
+                               double channelState, Time duration);
+
+  /**
+   * \returns Number of channel state bins.
+   */
+  uint32_t GetNChannelStateBins (void) const;
+
+  /**
+   * \param channelState Channel state (HMM state, BEAR SNR in dB...).
+   * \returns Bin the channel state is accounted in.
+   */
+  uint32_t GetChannelStateBin (double channelState) const;
+
+  /**
+   * \param txNodeId ID of the transmitter node.
+   * \param bin Channel state bin.
+   * \returns Energy (J) spent receiving the frames of the link dropped by the
+   * error model within the bin.
+   */
+  double GetCorruptedRxEnergy (uint16_t txNodeId, uint32_t bin) const;
+
+  /**
+   * \param txNodeId ID of the transmitter node.
+   * \param bin Channel state bin.
+   * \returns Number of frames of the link dropped by the error model within
+   * the bin.
+   */
+  uint32_t GetCorruptedRxCount (uint16_t txNodeId, uint32_t bin) const;
+
 
 private:
   void DoDispose (void);
@@ -258,6 +312,15 @@ private:
 
   // WifiPhy listener
   WifiRadioEnergyModelPhyListener *m_listener;
+
+  // Channel state bins of the corrupted receptions.
+  uint32_t m_nChannelStateBins;
+  double m_channelStateBinStart;
+  double m_channelStateBinWidth;
+
+  // Corrupted receptions, one row of m_nChannelStateBins per transmitter node.
+  std::vector<double> m_corruptedRxEnergy;
+  std::vector<uint32_t> m_corruptedRxCount;
 };
 
 } // namespace ns3
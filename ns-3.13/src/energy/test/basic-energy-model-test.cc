@@ -31,6 +31,8 @@
 #include "ns3/double.h"
 #include "ns3/config.h"
 #include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/packet.h"
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/nqos-wifi-mac-helper.h"
 #include <math.h>
@@ -366,6 +368,73 @@ BasicEnergyDepletionTest::DepletionTestCase (double simTimeS,
 
 // -------------------------------------------------------------------------- //
 
+/**
+ * Test case of the energy of the frames dropped by the error model, accounted
+ * by WifiRadioEnergyModel per link and channel state bin.
+ */
+class BasicEnergyCorruptedRxTest : public TestCase
+{
+public:
+  BasicEnergyCorruptedRxTest ();
+  virtual ~BasicEnergyCorruptedRxTest ();
+
+private:
+  void DoRun (void);
+};
+
+BasicEnergyCorruptedRxTest::BasicEnergyCorruptedRxTest ()
+  : TestCase ("Basic energy model corrupted reception accounting test case")
+{
+}
+
+BasicEnergyCorruptedRxTest::~BasicEnergyCorruptedRxTest ()
+{
+}
+
+void
+BasicEnergyCorruptedRxTest::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<BasicEnergySource> source = CreateObject<BasicEnergySource> ();
+  node->AggregateObject (source);
+  Ptr<WifiRadioEnergyModel> model = CreateObject<WifiRadioEnergyModel> ();
+  // SNR bins of 2 dB from 0 dB
+  model->SetAttribute ("ChannelStateBins", UintegerValue (4));
+  model->SetAttribute ("ChannelStateBinWidth", DoubleValue (2.0));
+  model->SetEnergySource (source);
+  source->AppendDeviceEnergyModel (model);
+
+  NS_TEST_ASSERT_MSG_EQ (model->GetChannelStateBin (-3.0), 0u, "Channel states below range go to the first bin");
+  NS_TEST_ASSERT_MSG_EQ (model->GetChannelStateBin (0.5), 0u, "Incorrect channel state bin");
+  NS_TEST_ASSERT_MSG_EQ (model->GetChannelStateBin (2.0), 1u, "Incorrect channel state bin");
+  NS_TEST_ASSERT_MSG_EQ (model->GetChannelStateBin (5.9), 2u, "Incorrect channel state bin");
+  NS_TEST_ASSERT_MSG_EQ (model->GetChannelStateBin (40.0), 3u, "Channel states above range go to the last bin");
+
+  Ptr<const Packet> packet = Create<Packet> (1000);
+  Time duration = MicroSeconds (1000);
+  model->NotifyRxErrorModelDrop (packet, 2, 3.0, duration);
+  model->NotifyRxErrorModelDrop (packet, 2, 2.5, duration);
+  model->NotifyRxErrorModelDrop (packet, 2, 7.0, MicroSeconds (2000));
+  model->NotifyRxErrorModelDrop (packet, 0, 1.0, duration);
+
+  double frameEnergy = duration.GetSeconds () * model->GetRxCurrentA () * source->GetSupplyVoltage ();
+  NS_TEST_ASSERT_MSG_EQ (model->GetCorruptedRxCount (2, 1), 2u, "Incorrect frame count");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetCorruptedRxEnergy (2, 1), 2 * frameEnergy, 1e-15, "Incorrect energy");
+  NS_TEST_ASSERT_MSG_EQ (model->GetCorruptedRxCount (2, 3), 1u, "Incorrect frame count");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetCorruptedRxEnergy (2, 3), 2 * frameEnergy, 1e-15, "Incorrect energy");
+  NS_TEST_ASSERT_MSG_EQ (model->GetCorruptedRxCount (2, 0), 0u, "Incorrect frame count");
+  NS_TEST_ASSERT_MSG_EQ (model->GetCorruptedRxCount (0, 0), 1u, "Incorrect frame count");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetCorruptedRxEnergy (0, 0), frameEnergy, 1e-15, "Incorrect energy");
+  // links without corrupted receptions
+  NS_TEST_ASSERT_MSG_EQ (model->GetCorruptedRxCount (1, 1), 0u, "Incorrect frame count");
+  NS_TEST_ASSERT_MSG_EQ (model->GetCorruptedRxCount (7, 1), 0u, "Incorrect frame count");
+  NS_TEST_ASSERT_MSG_EQ (model->GetCorruptedRxEnergy (7, 1), 0.0, "Incorrect energy");
+
+  Simulator::Destroy ();
+}
+
+// -------------------------------------------------------------------------- //
+
 /**
  * Unit test suite for energy model. Although the test suite involves 2 modules
  * it is still considered a unit test. Because a DeviceEnergyModel cannot live
@@ -382,6 +451,7 @@ BasicEnergyModelTestSuite::BasicEnergyModelTestSuite ()
 {
   AddTestCase (new BasicEnergyUpdateTest);
   AddTestCase (new BasicEnergyDepletionTest);
+  AddTestCase (new BasicEnergyCorruptedRxTest);
 }
 
 // create an instance of the test suite
@@ -97,8 +97,8 @@ public:
 	void PhyRxErrorTrace (std::string context, Ptr<const Packet> packet, double snr);
 
 	//BEAR Callback integration
-	void HmmRxTrace (Ptr<Packet> packet, Time timestamp, bool error, u_int16_t state);
-	void BearRxTrace (Ptr<Packet> packet, Time timestamp, bool error, double propagation, double slowFading, double fastFading);
+	void HmmRxTrace (Ptr<const Packet> packet, Time timestamp, bool error, u_int16_t state);
+	void BearRxTrace (Ptr<const Packet> packet, Time timestamp, bool error, double propagation, double slowFading, double fastFading);
 
 	//Upper Layer parser
 	packetInfo_t ParsePacket (Ptr<const Packet> packet);
@@ -430,7 +430,7 @@ packetInfo_t Experiment::ParsePacket (Ptr<const Packet> packet)
 	return packetInfo;
 }
 
-void Experiment::BearRxTrace(Ptr<Packet> packet, Time timestamp, bool error, double propagation, double slowFading, double fastFading)
+void Experiment::BearRxTrace (Ptr<const Packet> packet, Time timestamp, bool error, double propagation, double slowFading, double fastFading)
 {
 	NS_LOG_FUNCTION_NOARGS();
 	WifiMacHeader hdr;
@@ -523,7 +523,7 @@ void Experiment::BearRxTrace(Ptr<Packet> packet, Time timestamp, bool error, dou
 
 }
 
-void Experiment::HmmRxTrace(Ptr<Packet> packet, Time timestamp, bool error, u_int16_t state)
+void Experiment::HmmRxTrace (Ptr<const Packet> packet, Time timestamp, bool error, u_int16_t state)
 {
 	NS_LOG_FUNCTION_NOARGS();
 	WifiMacHeader hdr;
@@ -874,8 +874,8 @@ int main (int argc, char *argv[])
 
 			//Set the propagation delay model
 			wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
-			//Set the propagation loss model
-			wifiChannel.AddPropagationLoss ("ns3::SimplePropagationLossModel", "MaxDistance", DoubleValue(200.0));
+			//Set the propagation loss model (the PHY holds the HMM error model, hence the range errors are decided at the propagation model)
+			wifiChannel.AddPropagationLoss ("ns3::SimplePropagationLossModel", "MaxDistance", DoubleValue(200.0), "DecideFrames", BooleanValue (true));
 
 			//Set the error model
 			Ptr<HiddenMarkovErrorModel> errorModel = CreateObject<HiddenMarkovErrorModel> ();
@@ -33,6 +33,9 @@
 #include "ns3/string.h"
 #include "ns3/object-base.h"
 #include "ns3/node-list.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/wifi-mac-trailer.h"
+#include "ns3/msdu-aggregator.h"
 
 #include "hidden-markov-propagation-loss-model.h"
 #include "hidden-markov-error-model.h"
@@ -51,6 +54,9 @@ HiddenMarkovErrorModel::GetTypeId(void) {
 	static TypeId tid = TypeId ("ns3::HiddenMarkovErrorModel")
 	.SetParent <ErrorModel> ()
 	.AddConstructor<HiddenMarkovErrorModel> ()
+	.AddTraceSource ("HiddenMarkovRxTrace",
+			"Packet tracing",
+			MakeTraceSourceAccessor (&HiddenMarkovErrorModel::m_rxTrace))
 	       ;
   return tid;
 }
@@ -65,18 +71,19 @@ HiddenMarkovErrorModel::~HiddenMarkovErrorModel()
 	NS_LOG_FUNCTION (this);
 }
 
+void HiddenMarkovErrorModel::SetRxCallback (HiddenMarkovRxCallback_t callback)
+{
+	NS_LOG_FUNCTION_NOARGS();
+	m_rxCallback = callback;
+}
+
 bool HiddenMarkovErrorModel::DoCorrupt(Ptr<Packet> packet)
 {
 	NS_LOG_FUNCTION(this);
 	bool corruptedPacket = false;
-	WifiMacHeader hdr;
-	LlcSnapHeader llcHdr;
-	Ipv4Header ipv4Hdr;
-	UdpHeader udpHdr;
-	TcpHeader tcpHdr;
 
-	Ptr<Packet> pktCopy = packet->Copy();
-	pktCopy->RemoveHeader(hdr);
+	//The MAC header is read in place; only the unicast data frames are copied to parse the upper layers
+	WifiMacHeaderView hdr (packet);
 
 	//Locate the SNR within the map
 	channelSetIter_t iter = m_hmmNetworkMap->find (ChannelMeshPropagationKey (NodeList::GetNode (m_txIndex)->GetObject<MobilityModel> (),
@@ -89,60 +96,73 @@ bool HiddenMarkovErrorModel::DoCorrupt(Ptr<Packet> packet)
 	}
 
 	//Decide whether the frame is correct or not according to the frame type (data, TCP or broadcast/control)
-	//Force packet with length < 128 to be always correct
 	if (hdr.IsData() && !hdr.GetAddr1().IsBroadcast())
 	{
-		//We have split the packet decision into the following three conditions:
-		// - ARP frames --> Always correct
-		// - TCP ACK --> Always correct
-		// - Data frames --> Legacy HMM decision process
-		pktCopy->RemoveHeader(llcHdr);
-
-		switch (llcHdr.GetType())
-		{
-		case 0x0806:			//ARP
-			corruptedPacket = false;
-			break;
-		case 0x0800:			//IP packet
-			pktCopy->RemoveHeader(ipv4Hdr);
-			switch (ipv4Hdr.GetProtocol())
-			{
-			case 6:				//TCP
-				pktCopy->RemoveHeader(tcpHdr);
-
-				//Data segments --> To be corrupted
-				if (pktCopy->GetSize() > 4)
-					corruptedPacket = Decide ();
-				else
-					corruptedPacket = false;
-				break;
-			case 17:			//UDP
-				corruptedPacket =  Decide();
-				break;
-			default:
-				NS_LOG_ERROR ("Protocol not implemented yet (IP) --> " << ipv4Hdr.GetProtocol());
-				break;
-			}
-			break;
-			default:
-				NS_LOG_ERROR ("Protocol not implemented yet (LLC) --> " << llcHdr.GetType());
-				break;
-		}
+		Ptr<Packet> pktCopy = packet->Copy();
+		pktCopy->RemoveAtStart(hdr.GetSize());
+		corruptedPacket = DecideMsdu (pktCopy, 4);			//Last four bytes --> FCS
 	}
 
 	//Force 802.11 ACKs, broadcast and control/management frames to be correct
-	else if (hdr.IsAck())
+	else
 	{
 		corruptedPacket = false;
-
 	}
-	else if (hdr.IsCtl() || hdr.IsMgt() || (hdr.GetAddr1()).IsBroadcast())
+
+	//Tracing and callbacks
+	m_rxTrace (packet, 0, corruptedPacket, m_currentState, m_decisionValue);
+
+	if (!m_rxCallback.IsNull ())
 	{
-		corruptedPacket = false;
+		m_rxCallback (packet, 0, corruptedPacket, m_currentState, m_decisionValue);
 	}
-	else
+
+	return corruptedPacket;
+}
+
+bool HiddenMarkovErrorModel::DecideMsdu (Ptr<Packet> msdu, u_int32_t trailerSize)
+{
+	NS_LOG_FUNCTION (this << msdu << trailerSize);
+	bool corruptedPacket = false;
+	LlcSnapHeader llcHdr;
+	Ipv4Header ipv4Hdr;
+	TcpHeader tcpHdr;
+
+	//We have split the packet decision into the following three conditions:
+	// - ARP frames --> Always correct
+	// - TCP ACK --> Always correct
+	// - Data frames --> Legacy HMM decision process
+	msdu->RemoveHeader(llcHdr);
+
+	switch (llcHdr.GetType())
 	{
+	case 0x0806:			//ARP
 		corruptedPacket = false;
+		break;
+	case 0x0800:			//IP packet
+		msdu->RemoveHeader(ipv4Hdr);
+		switch (ipv4Hdr.GetProtocol())
+		{
+		case 6:				//TCP
+			msdu->RemoveHeader(tcpHdr);
+
+			//Data segments --> To be corrupted
+			if (msdu->GetSize() > trailerSize)
+				corruptedPacket = Decide ();
+			else
+				corruptedPacket = false;
+			break;
+		case 17:			//UDP
+			corruptedPacket =  Decide();
+			break;
+		default:
+			NS_LOG_ERROR ("Protocol not implemented yet (IP) --> " << ipv4Hdr.GetProtocol());
+			break;
+		}
+		break;
+		default:
+			NS_LOG_ERROR ("Protocol not implemented yet (LLC) --> " << llcHdr.GetType());
+			break;
 	}
 
 	return corruptedPacket;
@@ -172,6 +192,61 @@ bool HiddenMarkovErrorModel::Decide ()
 	return corruptedPacket;
 }
 
+bool HiddenMarkovErrorModel::CorruptAggregate (Ptr<const Packet> packet, vector<bool> &received)
+{
+	NS_LOG_FUNCTION (this << packet);
+	bool corruptedPacket = false;
+	u_int32_t i;
+	WifiMacHeaderView hdr (packet);
+	WifiMacTrailer fcs;
+	MsduAggregator::DeaggregatedMsdus subframes;
+	MsduAggregator::DeaggregatedMsdusCI subframe;
+
+	Ptr<Packet> msdus = packet->Copy ();
+	msdus->RemoveAtStart (hdr.GetSize ());
+	msdus->RemoveTrailer (fcs);
+	subframes = MsduAggregator::Deaggregate (msdus);
+
+	received.assign (subframes.size (), true);
+	if (!IsEnabled ())
+	{
+		return false;
+	}
+
+	channelSetIter_t iter = m_hmmNetworkMap->find (ChannelMeshPropagationKey (NodeList::GetNode (m_txIndex)->GetObject<MobilityModel> (),
+			NodeList::GetNode (m_rxIndex)->GetObject<MobilityModel> ()));
+	if (iter == m_hmmNetworkMap->end())
+	{
+		return false;
+	}
+
+	//The chain moves once per subframe, whatever its type; each subframe is then decided as DoCorrupt does with a frame
+	for (i = 0, subframe = subframes.begin (); subframe != subframes.end (); i++, subframe++)
+	{
+		if (i > 0)
+		{
+			iter->second->AdvanceFrame ();
+		}
+		m_currentState = iter->second->GetCurrentState();
+		m_decisionValue = iter->second->GetDecisionValue (m_currentState);
+		if (!hdr.GetAddr1().IsBroadcast() && DecideMsdu (subframe->first, 0))
+		{
+			received[i] = false;
+			corruptedPacket = true;
+		}
+
+		//Tracing and callbacks (one per subframe)
+		m_rxTrace (packet, 0, !received[i], m_currentState, m_decisionValue);
+
+		if (!m_rxCallback.IsNull ())
+		{
+			m_rxCallback (packet, 0, !received[i], m_currentState, m_decisionValue);
+		}
+	}
+
+	return corruptedPacket;
+}
+
 void HiddenMarkovErrorModel::DoReset (void)
 {
 	NS_LOG_FUNCTION_NOARGS();
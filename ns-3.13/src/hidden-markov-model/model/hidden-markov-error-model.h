@@ -28,9 +28,11 @@
 #include "ns3/object.h"
 #include "ns3/random-variable.h"
 #include "ns3/error-model.h"
+#include "ns3/traced-callback.h"
 
 //Parse the headers involved on the error decision
 #include "ns3/wifi-mac-header.h"
+#include "ns3/wifi-mac-header-view.h"
 #include "ns3/llc-snap-header.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/tcp-header.h"
@@ -57,6 +59,16 @@ public:
 
 	typedef std::map<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> > channelSet_t;
 	typedef std::map<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> >::const_iterator channelSetIter_t;
+
+	/**
+	 * arg1: packet received (the aggregate, for each one of its subframes)
+	 * arg2: ID of the node which has captured the frame
+	 * arg3: Boolean that represents whether a packet has been succesfully received or not
+	 * arg4: state of the chain
+	 * arg5: error probability of the state
+	 */
+	typedef Callback<void, Ptr<const Packet>, int, bool, u_int8_t, double> HiddenMarkovRxCallback_t;
+
 	/**
 	 * Attribute handler
 	 */
@@ -84,6 +96,21 @@ public:
 	 */
 	bool Decide();
 
+	/**
+	 * \brief Decide the subframes of an aggregate (A-MSDU) in a single call. The link is looked up once; the first subframe takes the
+	 * current state, and the chain moves once per subframe afterwards (frame-based and semi-Markov simulations). Each subframe is
+	 * classified as DoCorrupt does with a frame (i.e. ARP and TCP ACK MSDUs are always correct)
+	 * \param packet The aggregate, as received by the PHY (MAC header, subframes and FCS)
+	 * \param received Filled with the outcome of each subframe (true if received correctly)
+	 * \returns True if any subframe is corrupted (the aggregate shares the FCS)
+	 */
+	bool CorruptAggregate (Ptr<const Packet> packet, vector<bool> &received);
+
+	/**
+	 * \param callback Invoked for every decided frame (and for every subframe of an aggregate)
+	 */
+	void SetRxCallback (HiddenMarkovRxCallback_t callback);
+
 	/**
 	 *  After the PropagationLoss models extracts the decision value from the corresponding emission matrix, it will use this "pipe"
 	 *  to share the information with this ErrorModel
@@ -113,6 +140,14 @@ private:
 	virtual bool DoCorrupt (Ptr<Packet>);
 	virtual void DoReset (void);
 
+	/**
+	 * \brief Decide a unicast MSDU according to its type: ARP and TCP ACK are always correct; the rest of the data go through Decide
+	 * \param msdu The MSDU, starting at the LLC header (its headers are removed)
+	 * \param trailerSize Bytes after the transport payload (the FCS of a frame; none for the subframes of an aggregate)
+	 * \returns True if the MSDU is corrupted
+	 */
+	bool DecideMsdu (Ptr<Packet> msdu, u_int32_t trailerSize);
+
 	//Variable member needed to decide whether a frame is correct or not
 	RandomVariable m_ranvar;						//Random value used to decide whether a frame is correct or not
 	double m_decisionValue;							//Value extracted from the propagation loss model, which contains the information belonging to the transition and decision matrices
@@ -125,6 +160,10 @@ private:
 	u_int16_t m_txIndex;
 	u_int16_t m_rxIndex;
 
+	//Tracing and callbacks
+	TracedCallback<Ptr<const Packet>, int, bool, u_int8_t, double> m_rxTrace;
+	HiddenMarkovRxCallback_t m_rxCallback;
+
 protected:
 	/**
 	 * \return The current path (in string format)
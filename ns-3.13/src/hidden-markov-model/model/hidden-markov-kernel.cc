@@ -0,0 +1,175 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include "ns3/log.h"
+
+#include "hidden-markov-kernel.h"
+
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE ("HiddenMarkovKernel");
+
+namespace ns3 {
+
+HiddenMarkovKernel::~HiddenMarkovKernel ()
+{
+}
+
+Ptr<HiddenMarkovKernel>
+HiddenMarkovKernel::Create (const coefSet_t &transitionMatrix, const coefSet_t &emissionMatrix,
+		const vector<double> &meanSojournTime)
+{
+	NS_LOG_FUNCTION (transitionMatrix.size ());
+	Ptr<HiddenMarkovKernel> kernel;
+
+	//Shipped models (see configs/HMM_*states) --> Compile-time specialization
+	switch (transitionMatrix.size ())
+	{
+	case 3:
+		kernel = ns3::Create<HiddenMarkovFixedKernel<3> > (transitionMatrix, emissionMatrix, meanSojournTime);
+		break;
+	case 4:
+		kernel = ns3::Create<HiddenMarkovFixedKernel<4> > (transitionMatrix, emissionMatrix, meanSojournTime);
+		break;
+	case 8:
+		kernel = ns3::Create<HiddenMarkovFixedKernel<8> > (transitionMatrix, emissionMatrix, meanSojournTime);
+		break;
+	case 16:
+		kernel = ns3::Create<HiddenMarkovFixedKernel<16> > (transitionMatrix, emissionMatrix, meanSojournTime);
+		break;
+	default:
+		NS_LOG_DEBUG ("No specialized kernel for " << transitionMatrix.size () << " states, using the generic one");
+		kernel = ns3::Create<HiddenMarkovGenericKernel> (transitionMatrix, emissionMatrix, meanSojournTime);
+		break;
+	}
+	return kernel;
+}
+
+double
+HiddenMarkovKernel::DrawSojournTime (u_int8_t state)
+{
+	//ExponentialVariable (mean).GetValue () == mean * ExponentialVariable (1.0).GetValue ()
+	return GetMeanSojournTime (state) * m_exponential.GetValue ();
+}
+
+//////////////////////////HiddenMarkovGenericKernel
+
+HiddenMarkovGenericKernel::HiddenMarkovGenericKernel (const coefSet_t &transitionMatrix, const coefSet_t &emissionMatrix,
+		const vector<double> &meanSojournTime)
+	: m_states (transitionMatrix.size ()),
+	  m_transition (transitionMatrix.size () * transitionMatrix.size (), 0.0),
+	  m_decision (transitionMatrix.size (), 0.0),
+	  m_meanSojournTime (transitionMatrix.size (), 0.0)
+{
+	u_int8_t i, j;
+	coefSet_t::const_iterator row;
+
+	for (i = 0; i < m_states; i++)
+	{
+		row = transitionMatrix.find (i);
+		for (j = 0; row != transitionMatrix.end () && j < m_states && j < row->second.size (); j++)
+		{
+			m_transition[i * m_states + j] = row->second[j];
+		}
+		row = emissionMatrix.find (i);
+		if (row != emissionMatrix.end () && row->second.size ())
+			m_decision[i] = row->second[0];
+		if (i < meanSojournTime.size ())
+			m_meanSojournTime[i] = meanSojournTime[i];
+	}
+}
+
+u_int8_t
+HiddenMarkovGenericKernel::GetStates () const
+{
+	return m_states;
+}
+
+u_int8_t
+HiddenMarkovGenericKernel::NextState (u_int8_t currentState, bool mustChange)
+{
+	u_int8_t i, nextState = currentState;
+	double rowProbability = 0.0, accumulated = 0.0, randomSample;
+	const double *row = &m_transition[currentState * m_states];
+
+	if (mustChange)
+		return JumpState (currentState);
+
+	for (i = 0; i < m_states; i++)
+	{
+		rowProbability += row[i];
+	}
+	if (rowProbability <= 0.0)
+		return currentState;
+
+	randomSample = m_uniform.GetValue () * rowProbability;
+	for (i = 0; i < m_states; i++)
+	{
+		if (row[i] <= 0.0)
+			continue;
+		nextState = i;
+		accumulated += row[i];
+		if (randomSample < accumulated)
+			break;
+	}
+	return nextState;
+}
+
+u_int8_t
+HiddenMarkovGenericKernel::JumpState (u_int8_t currentState)
+{
+	u_int8_t i, nextState = currentState;
+	double exitProbability = 0.0, accumulated = 0.0, randomSample;
+	const double *row = &m_transition[currentState * m_states];
+
+	for (i = 0; i < m_states; i++)
+	{
+		exitProbability += (i != currentState) ? row[i] : 0.0;
+	}
+	if (exitProbability <= 0.0)
+		return currentState;
+
+	randomSample = m_uniform.GetValue () * exitProbability;
+	for (i = 0; i < m_states; i++)
+	{
+		if (i == currentState || row[i] <= 0.0)
+			continue;
+		nextState = i;
+		accumulated += row[i];
+		if (randomSample < accumulated)
+			break;
+	}
+	return nextState;
+}
+
+double
+HiddenMarkovGenericKernel::GetDecisionValue (u_int8_t state) const
+{
+	return m_decision[state];
+}
+
+double
+HiddenMarkovGenericKernel::GetMeanSojournTime (u_int8_t state) const
+{
+	return m_meanSojournTime[state];
+}
+
+} // namespace ns3
@@ -0,0 +1,257 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#ifndef HIDDEN_MARKOV_KERNEL_H_
+#define HIDDEN_MARKOV_KERNEL_H_
+
+#include <vector>
+#include <map>
+#include <sys/types.h>
+
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/random-variable.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup errormodel
+ * \brief Per-frame engine of a HiddenMarkovModelEntry. The transition and emission matrices are read into std::map containers (handy
+ * to load and print them), but the per-frame operations (state change and decision lookup) are carried out by this object, which holds
+ * the matrices in contiguous arrays. The shipped models use 3, 4, 8 or 16 states, so these sizes are handled by an specialization whose
+ * dimensions are fixed at compile time (HiddenMarkovFixedKernel); any other size falls back to HiddenMarkovGenericKernel
+ */
+class HiddenMarkovKernel : public SimpleRefCount<HiddenMarkovKernel>
+{
+public:
+	typedef std::map<int, std::vector<double> > coefSet_t;
+
+	virtual ~HiddenMarkovKernel ();
+
+	/**
+	 * \brief Instance the most suitable kernel for the number of states held by the transition matrix
+	 * \param transitionMatrix Transition probabilities among the states (NxN)
+	 * \param emissionMatrix Output observables (NxM); only the first column (error probability) is used
+	 * \param meanSojournTime Mean time (in microseconds) spent at each state before a state change (Nx1)
+	 * \returns The kernel which will handle the chain
+	 */
+	static Ptr<HiddenMarkovKernel> Create (const coefSet_t &transitionMatrix, const coefSet_t &emissionMatrix,
+			const std::vector<double> &meanSojournTime);
+
+	/**
+	 * \returns The number of states of the chain
+	 */
+	virtual u_int8_t GetStates () const = 0;
+
+	/**
+	 * Sample the next state of the chain by inverse transform sampling of the row of the current state, i.e. P(j | i) = a_ij (the row is
+	 * renormalized, since the trained matrices are rounded), so the chain actually simulated is the one whose stationary distribution is
+	 * calculated by HiddenMarkovModelEntry
+	 * \param currentState The current state within the chain
+	 * \param mustChange If true (time-based simulations) the current state is excluded from the candidates, as JumpState does
+	 * \returns The next state
+	 */
+	virtual u_int8_t NextState (u_int8_t currentState, bool mustChange) = 0;
+
+	/**
+	 * Sample the destination of a jump of the embedded chain (semi-Markov simulations): the current state is excluded and the rest of
+	 * the row is renormalized, i.e. P(j | i) = a_ij / (1 - a_ii)
+	 * \param currentState The current state within the chain
+	 * \returns The next state (the current one if it is an absorbing state)
+	 */
+	virtual u_int8_t JumpState (u_int8_t currentState) = 0;
+
+	/**
+	 * \param state State within the chain
+	 * \returns The error probability (first column of the emission matrix) of the given state
+	 */
+	virtual double GetDecisionValue (u_int8_t state) const = 0;
+
+	/**
+	 * \param state State within the chain
+	 * \returns A random sojourn time (in microseconds) at the given state, exponentially distributed
+	 */
+	double DrawSojournTime (u_int8_t state);
+
+protected:
+	/**
+	 * \param state State within the chain
+	 * \returns The mean sojourn time (in microseconds) at the given state
+	 */
+	virtual double GetMeanSojournTime (u_int8_t state) const = 0;
+
+	//Random variables are created once, instead of once per frame
+	UniformVariable m_uniform;
+	ExponentialVariable m_exponential;
+};
+
+/**
+ * \brief Kernel specialized for a chain of N states. Matrices are stored in fixed-size arrays, hence the loops have constant trip counts
+ * and can be fully unrolled by the compiler
+ */
+template <u_int8_t N>
+class HiddenMarkovFixedKernel : public HiddenMarkovKernel
+{
+public:
+	HiddenMarkovFixedKernel (const coefSet_t &transitionMatrix, const coefSet_t &emissionMatrix,
+			const std::vector<double> &meanSojournTime);
+
+	virtual u_int8_t GetStates () const;
+	virtual u_int8_t NextState (u_int8_t currentState, bool mustChange);
+	virtual u_int8_t JumpState (u_int8_t currentState);
+	virtual double GetDecisionValue (u_int8_t state) const;
+
+protected:
+	virtual double GetMeanSojournTime (u_int8_t state) const;
+
+private:
+	double m_transition[N][N];
+	double m_decision[N];
+	double m_meanSojournTime[N];
+};
+
+/**
+ * \brief Kernel for any other number of states. Matrices are flattened into a single (row-major) vector
+ */
+class HiddenMarkovGenericKernel : public HiddenMarkovKernel
+{
+public:
+	HiddenMarkovGenericKernel (const coefSet_t &transitionMatrix, const coefSet_t &emissionMatrix,
+			const std::vector<double> &meanSojournTime);
+
+	virtual u_int8_t GetStates () const;
+	virtual u_int8_t NextState (u_int8_t currentState, bool mustChange);
+	virtual u_int8_t JumpState (u_int8_t currentState);
+	virtual double GetDecisionValue (u_int8_t state) const;
+
+protected:
+	virtual double GetMeanSojournTime (u_int8_t state) const;
+
+private:
+	u_int8_t m_states;
+	std::vector<double> m_transition;
+	std::vector<double> m_decision;
+	std::vector<double> m_meanSojournTime;
+};
+
+template <u_int8_t N>
+HiddenMarkovFixedKernel<N>::HiddenMarkovFixedKernel (const coefSet_t &transitionMatrix, const coefSet_t &emissionMatrix,
+		const std::vector<double> &meanSojournTime)
+{
+	u_int8_t i, j;
+	coefSet_t::const_iterator row;
+
+	for (i = 0; i < N; i++)
+	{
+		row = transitionMatrix.find (i);
+		for (j = 0; j < N; j++)
+		{
+			m_transition[i][j] = (row != transitionMatrix.end () && j < row->second.size ()) ? row->second[j] : 0.0;
+		}
+		row = emissionMatrix.find (i);
+		m_decision[i] = (row != emissionMatrix.end () && row->second.size ()) ? row->second[0] : 0.0;
+		m_meanSojournTime[i] = (i < meanSojournTime.size ()) ? meanSojournTime[i] : 0.0;
+	}
+}
+
+template <u_int8_t N>
+u_int8_t
+HiddenMarkovFixedKernel<N>::GetStates () const
+{
+	return N;
+}
+
+template <u_int8_t N>
+u_int8_t
+HiddenMarkovFixedKernel<N>::NextState (u_int8_t currentState, bool mustChange)
+{
+	u_int8_t i, nextState = currentState;
+	double rowProbability = 0.0, accumulated = 0.0, randomSample;
+	const double *row = m_transition[currentState];
+
+	if (mustChange)
+		return JumpState (currentState);
+
+	for (i = 0; i < N; i++)
+	{
+		rowProbability += row[i];
+	}
+	if (rowProbability <= 0.0)
+		return currentState;
+
+	randomSample = m_uniform.GetValue () * rowProbability;
+	for (i = 0; i < N; i++)
+	{
+		if (row[i] <= 0.0)
+			continue;
+		nextState = i;
+		accumulated += row[i];
+		if (randomSample < accumulated)
+			break;
+	}
+	return nextState;
+}
+
+template <u_int8_t N>
+u_int8_t
+HiddenMarkovFixedKernel<N>::JumpState (u_int8_t currentState)
+{
+	u_int8_t i, nextState = currentState;
+	double exitProbability = 0.0, accumulated = 0.0, randomSample;
+	const double *row = m_transition[currentState];
+
+	for (i = 0; i < N; i++)
+	{
+		exitProbability += (i != currentState) ? row[i] : 0.0;
+	}
+	if (exitProbability <= 0.0)
+		return currentState;
+
+	randomSample = m_uniform.GetValue () * exitProbability;
+	for (i = 0; i < N; i++)
+	{
+		if (i == currentState || row[i] <= 0.0)
+			continue;
+		nextState = i;
+		accumulated += row[i];
+		if (randomSample < accumulated)
+			break;
+	}
+	return nextState;
+}
+
+template <u_int8_t N>
+double
+HiddenMarkovFixedKernel<N>::GetDecisionValue (u_int8_t state) const
+{
+	return m_decision[state];
+}
+
+template <u_int8_t N>
+double
+HiddenMarkovFixedKernel<N>::GetMeanSojournTime (u_int8_t state) const
+{
+	return m_meanSojournTime[state];
+}
+
+} // namespace ns3
+
+#endif /* HIDDEN_MARKOV_KERNEL_H_ */
@@ -19,6 +19,10 @@
  *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
  */
 
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
 #include "hidden-markov-model-entry.h"
 
 using namespace ns3;
@@ -27,6 +31,50 @@ using namespace std;
 NS_LOG_COMPONENT_DEFINE("HiddenMarkovModelEntry");
 NS_OBJECT_ENSURE_REGISTERED (HiddenMarkovModelEntry);
 
+//Stationary distributions already calculated, indexed by the parameter set (transition file, emission file and simulation mode). Every link
+//loaded from the same files will share the same equilibrium, so there is no need to solve it N x (N - 1) times
+static map<string, vector<double> > g_stationaryDistributionCache;
+
+//Sojourn distributions already read, indexed by the file name, so that the file is parsed once and not once per link. These copies are never
+//sampled: each link gets its own copy, which creates its own random stream on its first draw
+struct SojournDistributionSet
+{
+	vector<IntEmpiricalVariable> m_distribution;
+	vector<double> m_mean;
+	vector<u_int32_t> m_max;
+};
+static map<string, SojournDistributionSet> g_sojournDistributionCache;
+
+//Mean number of frames of a sojourn, as drawn by ChangeState from an IntEmpiricalVariable: the first point is returned as it is (with probability
+//F_1); otherwise, the value is linearly interpolated between two points of the CDF and rounded up. Sojourns shorter than one frame last one
+static double GetSampledSojournMean (const vector<pair<double, double> > &points)
+{
+	double mean, weight, overlap, n;
+	u_int32_t k;
+
+	mean = points[0].second * max (floor (points[0].first), 1.0);
+	for (k = 1; k < points.size(); k++)
+	{
+		double v1 = points[k - 1].first;
+		double v2 = points[k].first;
+		weight = points[k].second - points[k - 1].second;
+		if (weight <= 0)
+			continue;
+		if (v2 <= v1)
+		{
+			mean += weight * max (ceil (v1), 1.0);
+			continue;
+		}
+		//Uniform value in [v1, v2) --> ceil() = n with probability |(n - 1, n] ^ [v1, v2)| / (v2 - v1)
+		for (n = floor (v1) + 1; n - 1 < v2; n++)
+		{
+			overlap = min (n, v2) - max (n - 1, v1);
+			mean += weight * overlap / (v2 - v1) * max (n, 1.0);
+		}
+	}
+	return mean;
+}
+
 HiddenMarkovModelEntry::HiddenMarkovModelEntry ()
 {
 	NS_LOG_FUNCTION (this);
@@ -35,6 +83,8 @@ HiddenMarkovModelEntry::HiddenMarkovModelEntry ()
 	m_transmissionAttempts = 4;
 	m_currentState = 0;
 	m_eventStarted = false;
+	m_pendingSojourn = 0;
+	m_stationaryInitialState = true;
 	m_coherenceTime = Seconds (10.0);
 }
 
@@ -145,6 +195,13 @@ bool HiddenMarkovModelEntry::GetCoefficients (string transitionMatrixFileName, s
 		m_emissionMatrix.clear();
 	if (m_meanDurationVector.size())
 		m_meanDurationVector.clear();
+	if (m_averageInterFrameTime.size())
+		m_averageInterFrameTime.clear();
+	if (m_stationaryDistribution.size())
+		m_stationaryDistribution.clear();
+
+	m_transitionMatrixFileName = transitionMatrixFileName;
+	m_emissionMatrixFileName = emissionMatrixFileName;
 
 	coefSetIter_t iter_;
 
@@ -240,10 +297,101 @@ bool HiddenMarkovModelEntry::GetCoefficients (string transitionMatrixFileName, s
 	transitionMatrixFile.close();
 	emissionMatrixFile.close();
 
+	//Build the per-frame kernel (mean sojourn time per state = mean duration in frames * average inter-frame time)
+	vector<double> meanSojournTime;
+	for (i = 0; i < (int) m_meanDurationVector.size() && i < (int) m_averageInterFrameTime.size(); i++)
+	{
+		meanSojournTime.push_back (m_meanDurationVector[i] * m_averageInterFrameTime[i]);
+	}
+	m_kernel = HiddenMarkovKernel::Create (m_transitionMatrix, m_emissionMatrix, meanSojournTime);
+
 	return true;
 }
 
 
+bool HiddenMarkovModelEntry::GetSojournDistributions (string sojournFileName)
+{
+	NS_LOG_FUNCTION (sojournFileName);
+
+	string sojournPath;
+	fstream sojournFile;
+	u_int32_t states, points, i, k;
+	double duration, cdf;
+	map<string, SojournDistributionSet>::const_iterator cached;
+
+	m_sojournDistribution.clear();
+	m_meanSojourn.clear();
+	m_maxSojourn.clear();
+	m_stationaryDistribution.clear();
+	m_pendingSojourn = 0;
+	m_sojournFileName = sojournFileName;
+
+	cached = g_sojournDistributionCache.find (sojournFileName);
+	if (cached == g_sojournDistributionCache.end())
+	{
+		SojournDistributionSet sojournSet;
+
+		sojournPath = GetCwd() + "/src/hidden-markov-model/configs/" + sojournFileName;
+		sojournFile.open((const char *) sojournPath.c_str(), ios::in);
+		NS_ASSERT_MSG (sojournFile, "File " << sojournPath << " not found");
+
+		sojournFile >> states;
+		for (i = 0; i < states && sojournFile; i++)
+		{
+			IntEmpiricalVariable sojourn;
+			vector<pair<double, double> > cdfPoints;
+
+			sojournFile >> points;
+			for (k = 0; k < points && sojournFile; k++)
+			{
+				sojournFile >> duration >> cdf;
+				sojourn.CDF (duration, cdf);
+				cdfPoints.push_back (make_pair (duration, cdf));
+			}
+			NS_ASSERT_MSG (points && fabs (cdfPoints.back().second - 1.0) < 1e-6, "State " << i << ": the sojourn CDF must end at 1.0");
+
+			sojournSet.m_distribution.push_back (sojourn);
+			sojournSet.m_mean.push_back (GetSampledSojournMean (cdfPoints));
+			sojournSet.m_max.push_back ((u_int32_t) max (ceil (cdfPoints.back().first), 1.0));
+		}
+		sojournFile.close();
+
+		if (sojournSet.m_distribution.size() != states)
+			return false;
+		cached = g_sojournDistributionCache.insert (make_pair (sojournFileName, sojournSet)).first;
+	}
+
+	NS_ASSERT_MSG (cached->second.m_distribution.size() == m_transitionMatrix.size(), "The sojourn file " << sojournFileName << " describes "
+			<< cached->second.m_distribution.size() << " states, whereas the transition matrix holds " << m_transitionMatrix.size());
+
+	m_sojournDistribution = cached->second.m_distribution;
+	m_meanSojourn = cached->second.m_mean;
+	m_maxSojourn = cached->second.m_max;
+	return true;
+}
+
+u_int32_t HiddenMarkovModelEntry::DrawSojourn ()
+{
+	u_int32_t sojourn = (u_int32_t) m_sojournDistribution[m_currentState].GetInteger();
+	return (sojourn == 0) ? 1 : sojourn;
+}
+
+u_int32_t HiddenMarkovModelEntry::DrawResidualSojourn ()
+{
+	UniformVariable ranvar (0.0, 1.0);
+	u_int32_t sojourn;
+
+	//P(R = r) = P(D >= r) / E[D]: a sojourn is drawn proportionally to its length (rejection against the longest one), and the link is placed
+	//uniformly within it
+	do
+	{
+		sojourn = DrawSojourn ();
+	}
+	while (ranvar.GetValue () * m_maxSojourn[m_currentState] >= sojourn);
+
+	return ranvar.GetInteger (1, sojourn);
+}
+
 double HiddenMarkovModelEntry::CalcAverageTransmissionTime (u_int8_t retx)
 {
 //	NS_LOG_FUNCTION(this);
@@ -269,45 +417,52 @@ double HiddenMarkovModelEntry::CalcAverageTransmissionTime (u_int8_t retx)
 void HiddenMarkovModelEntry::ChangeState ()
 {
 	NS_LOG_FUNCTION( this << "State" << (int) m_currentState << "Time" << Simulator::Now().GetSeconds());
-	u_int8_t i, maxState = 0;
-	double transitionProbability, max, randomSample;
-	max = -1;
-	UniformVariable ranvar (0.0, 1.0);
-
+	u_int8_t nextState;
 
-	for (i = 0; (int) i < (m_transitionMatrix [m_currentState]).size(); i++)
+	//Semi-Markov: the sojourn is drawn once, when the state is entered; the following frames only consume it
+	if (m_mode == HMM_SEMI_MARKOV_SIMULATION)
 	{
-		randomSample = ranvar.GetValue();
-		transitionProbability = (m_transitionMatrix [m_currentState])[i]	* randomSample;
-		//Different possibilities, depending on the type of simulation chosen:
-		//EU_TIME: One call to this method brings about necessarily a state change (called after every average state stay duration)
-		//Otherwise: As called at each frame reception, it may hold the same state
-		if (m_mode == HMM_TIME_BASED_SIMULATION)  		//&& (transitionProbability > max) && (i != m_currentState))   //Time-based --> MUST change state
+		if (m_pendingSojourn == 0)
 		{
-			if ((transitionProbability > max) && (i != m_currentState))
+			//The first frame at this link keeps the initial state; otherwise, the sojourn has expired --> jump
+			NS_ASSERT_MSG (m_currentState < m_sojournDistribution.size(), "Sojourn distributions not loaded, cannot continue");
+			if (m_eventStarted)
 			{
-				max = transitionProbability;
-				maxState = i;
+				nextState = m_kernel->JumpState (m_currentState);
+				NS_LOG_DEBUG( "State change: (" << (int) m_currentState << ") --> (" << (int) nextState << ") (" << this << ")" );
+				m_currentState = nextState;
+				m_pendingSojourn = DrawSojourn ();
 			}
-		}
-		else
-		{
-//			NS_LOG_UNCOND ("State " << (int) i << " Value " << (m_transitionMatrix[m_currentState])[i] * randomSample);
-
-			if (transitionProbability > max)
+			else
 			{
-				max = transitionProbability;
-				maxState = i;
+				//A link started in equilibrium is found in the middle of a sojourn: only its residual part is left
+				m_pendingSojourn = m_stationaryInitialState ? DrawResidualSojourn () : DrawSojourn ();
 			}
+			m_eventStarted = true;
+			NS_LOG_DEBUG ("Sojourn at state " << (int) m_currentState << " = " << m_pendingSojourn << " frames");
 		}
+		m_pendingSojourn--;
+		return;
 	}
 
+	//Different possibilities, depending on the type of simulation chosen:
+	//EU_TIME: One call to this method brings about necessarily a state change (called after every average state stay duration)
+	//Otherwise: As called at each frame reception, it may hold the same state
+	nextState = m_kernel->NextState (m_currentState, m_mode == HMM_TIME_BASED_SIMULATION);
 
 	//Did actually make a state change??
-	if (m_currentState != maxState)
+	if (m_currentState != nextState)
 	{
-		NS_LOG_DEBUG( "State change: (" << (int) m_currentState << ") --> (" << (int) maxState << ") (" << this << ")" );
-		m_currentState = maxState;
+		NS_LOG_DEBUG( "State change: (" << (int) m_currentState << ") --> (" << (int) nextState << ") (" << this << ")" );
+		m_currentState = nextState;
+	}
+}
+
+void HiddenMarkovModelEntry::AdvanceFrame ()
+{
+	if (m_mode == HMM_FRAME_BASED_SIMULATION || m_mode == HMM_SEMI_MARKOV_SIMULATION)
+	{
+		ChangeState ();
 	}
 }
 
@@ -315,16 +470,11 @@ void HiddenMarkovModelEntry::InitializeTimer ()
 {
 	NS_LOG_FUNCTION(this);
 	double nextTimeout;
-	double nextTimeoutMeanValue;
 
-	//Set the next timeout
-//	nextTimeoutMeanValue = m_meanDurationVector[m_currentState] * m_fixedTransmissionTime;
-	nextTimeoutMeanValue = m_meanDurationVector[m_currentState] * m_averageInterFrameTime[m_currentState];
-	ExponentialVariable expVar(nextTimeoutMeanValue);
-	nextTimeout = expVar.GetValue();
+	//Set the next timeout (exponentially distributed, mean = mean duration (frames) * average inter-frame time)
+	nextTimeout = m_kernel->DrawSojournTime (m_currentState);
 
-	NS_LOG_INFO("(" << Simulator::Now().GetSeconds() << ") - Next timeout " << nextTimeoutMeanValue   \
-				<< " --> " << nextTimeout << " (" << m_currentState << ")");
+	NS_LOG_INFO("(" << Simulator::Now().GetSeconds() << ") - Next timeout --> " << nextTimeout << " (" << (int) m_currentState << ")");
 	m_changeStateTimeout =  Simulator::Schedule(MicroSeconds(nextTimeout), &HiddenMarkovModelEntry::TimerHandler, this);
 }
 
@@ -332,18 +482,12 @@ void HiddenMarkovModelEntry::TimerHandler ()
 {
 	NS_LOG_FUNCTION(this << Simulator::Now().GetSeconds());
 	double nextTimeout;
-	double nextTimeoutMeanValue;
-
-	//Once the timeout is reached, check if the states changes
-	//Set the next timeout
-//	nextTimeoutMeanValue = m_meanDurationVector[m_currentState] * m_fixedTransmissionTime;
-	nextTimeoutMeanValue = m_meanDurationVector[m_currentState] * m_averageInterFrameTime[m_currentState];
-	ExponentialVariable expVar(nextTimeoutMeanValue);
-	nextTimeout = expVar.GetValue();
 
+	//Once the timeout is reached, jump to another state and set the next timeout from the sojourn of the new state (not the one just left)
 	ChangeState();
-	NS_LOG_INFO("(" << Simulator::Now().GetSeconds() << ") - Next timeout " << nextTimeoutMeanValue   \
-			<< " --> " << nextTimeout << " (" << (int) m_currentState << ")");
+	nextTimeout = m_kernel->DrawSojournTime (m_currentState);
+
+	NS_LOG_INFO("(" << Simulator::Now().GetSeconds() << ") - Next timeout --> " << nextTimeout << " (" << (int) m_currentState << ")");
 	m_changeStateTimeout = Simulator::Schedule(MicroSeconds(nextTimeout),&HiddenMarkovModelEntry::TimerHandler, this);
 }
 
@@ -357,8 +501,11 @@ void HiddenMarkovModelEntry::CoherenceTimeoutHandler ()
 		m_changeStateTimeout.Cancel ();
 		m_eventStarted = false;
 
-		//Randomly choose the new current state
-		m_currentState = ranvar.GetInteger(0, m_transitionMatrix.size() - 1);
+		//Randomly choose the new current state (the link is supposed to have lost its memory after the coherence time)
+		if (m_stationaryInitialState)
+			m_currentState = DrawStationaryState ();
+		else
+			m_currentState = ranvar.GetInteger(0, m_transitionMatrix.size() - 1);
 	}
 
 	if (m_coherenceTimeout.IsRunning ())
@@ -418,10 +565,209 @@ u_int8_t HiddenMarkovModelEntry::GetCurrentState ()
 
 double HiddenMarkovModelEntry::GetDecisionValue (u_int8_t currentState)
 {
-	return m_emissionMatrix.at(currentState).at(0);
+	return m_kernel->GetDecisionValue (currentState);
+}
+
+void HiddenMarkovModelEntry::CalcStationaryDistribution ()
+{
+	NS_LOG_FUNCTION (m_transitionMatrixFileName << m_emissionMatrixFileName << m_mode);
+	u_int32_t i, j, iteration;
+	u_int32_t states = m_transitionMatrix.size();
+	double sum, delta;
+	char modeTag[8];
+
+	//Look for a previous calculation of the same parameter set
+	sprintf (modeTag, "|%d", (int) m_mode);
+	string key = m_transitionMatrixFileName + "|" + m_emissionMatrixFileName + modeTag;
+	if (m_mode == HMM_SEMI_MARKOV_SIMULATION)
+		key += "|" + m_sojournFileName;
+
+	map<string, vector<double> >::const_iterator cached = g_stationaryDistributionCache.find (key);
+	if (cached != g_stationaryDistributionCache.end() && cached->second.size() == states)
+	{
+		m_stationaryDistribution = cached->second;
+		return;
+	}
+
+	NS_ASSERT_MSG (states, "Transition matrix not loaded, cannot calculate the stationary distribution");
+
+	vector<double> pi (states, 1.0 / states);
+	vector<double> next (states, 0.0);
+
+	//The kernel samples each row renormalized (the trained matrices are rounded), so the chain is solved the same way
+	coefSet_t embeddedChain = m_transitionMatrix;
+	for (i = 0; i < states; i++)
+	{
+		sum = 0.0;
+		for (j = 0; j < states; j++)
+		{
+			sum += embeddedChain[i][j];
+		}
+		for (j = 0; sum > 0.0 && j < states; j++)
+		{
+			embeddedChain[i][j] /= sum;
+		}
+	}
+
+	//Semi-Markov simulations: the chain only describes the jumps, hence the diagonal is removed (P(j | i) = a_ij / (1 - a_ii))
+	bool semiMarkov = (m_mode == HMM_SEMI_MARKOV_SIMULATION && m_meanSojourn.size() == states);
+	if (semiMarkov)
+	{
+		for (i = 0; i < states; i++)
+		{
+			sum = 1.0 - embeddedChain[i][i];
+			for (j = 0; j < states; j++)
+			{
+				embeddedChain[i][j] = (i == j) ? (sum > 0.0 ? 0.0 : 1.0) : (sum > 0.0 ? embeddedChain[i][j] / sum : 0.0);
+			}
+		}
+	}
+
+	//Power iteration over the lazy chain (I + A) / 2
+	for (iteration = 0; iteration < 100000; iteration++)
+	{
+		for (j = 0; j < states; j++)
+		{
+			next[j] = 0.5 * pi[j];
+		}
+		for (i = 0; i < states; i++)
+		{
+			for (j = 0; j < states; j++)
+			{
+				next[j] += 0.5 * pi[i] * embeddedChain[i][j];
+			}
+		}
+
+		//The rows of the trained matrices are rounded, hence normalize after each step
+		sum = 0.0;
+		for (j = 0; j < states; j++)
+		{
+			sum += next[j];
+		}
+		delta = 0.0;
+		for (j = 0; j < states; j++)
+		{
+			next[j] /= sum;
+			delta += fabs (next[j] - pi[j]);
+		}
+		pi.swap (next);
+
+		if (delta < 1e-12)
+			break;
+	}
+
+	NS_LOG_DEBUG ("Stationary distribution reached after " << iteration << " iterations");
+
+	//Semi-Markov simulations: pi holds the fraction of jumps into each state; the fraction of frames is weighted by the mean sojourns
+	if (semiMarkov)
+	{
+		sum = 0.0;
+		for (j = 0; j < states; j++)
+		{
+			pi[j] *= m_meanSojourn[j];
+			sum += pi[j];
+		}
+		for (j = 0; j < states; j++)
+		{
+			pi[j] /= sum;
+		}
+	}
+
+	//Time-based simulations: every timeout jumps to another state (P(j | i) = a_ij / (1 - a_ii)) after an exponential sojourn whose mean is
+	//1 / (1 - a_ii) average inter-frame times, so the fraction of time at each state is the fraction of frames of the chain above (pi)
+	//weighted by the average inter-frame time of the state
+	if (m_mode == HMM_TIME_BASED_SIMULATION && m_averageInterFrameTime.size() == states)
+	{
+		sum = 0.0;
+		for (j = 0; j < states; j++)
+		{
+			pi[j] *= m_averageInterFrameTime[j];
+			sum += pi[j];
+		}
+		for (j = 0; j < states; j++)
+		{
+			pi[j] /= sum;
+		}
+	}
+
+	m_stationaryDistribution = pi;
+	g_stationaryDistributionCache[key] = pi;
+}
+
+double HiddenMarkovModelEntry::GetStationaryProbability (u_int8_t state)
+{
+	if (m_stationaryDistribution.size() != m_transitionMatrix.size())
+		CalcStationaryDistribution ();
+
+	NS_ASSERT (state < m_stationaryDistribution.size());
+	return m_stationaryDistribution[state];
 }
 
+u_int8_t HiddenMarkovModelEntry::DrawStationaryState ()
+{
+	NS_LOG_FUNCTION (this);
+	u_int8_t state;
+	double accumulated = 0.0;
+	UniformVariable ranvar (0.0, 1.0);
+
+	if (m_stationaryDistribution.size() != m_transitionMatrix.size())
+		CalcStationaryDistribution ();
+
+	double randomSample = ranvar.GetValue();
+
+	//Inverse transform sampling over the cumulative distribution (the last state absorbs the rounding errors)
+	for (state = 0; state < m_stationaryDistribution.size() - 1; state++)
+	{
+		accumulated += m_stationaryDistribution[state];
+		if (randomSample < accumulated)
+			break;
+	}
+
+	NS_LOG_DEBUG ("Initial state drawn from the stationary distribution: " << (int) state);
+	return state;
+}
 
+void HiddenMarkovModelEntry::Serialize (ostream &os) const
+{
+	NS_LOG_FUNCTION (this);
+
+	//Time left of the running timers (-1 if not running)
+	int64_t changeStateLeft = m_changeStateTimeout.IsRunning() ? Simulator::GetDelayLeft (m_changeStateTimeout).GetNanoSeconds() : -1;
+	int64_t coherenceLeft = m_coherenceTimeout.IsRunning() ? Simulator::GetDelayLeft (m_coherenceTimeout).GetNanoSeconds() : -1;
+
+	ChannelMeshCheckpoint::Write<u_int8_t> (os, m_currentState);
+	ChannelMeshCheckpoint::Write<u_int8_t> (os, m_eventStarted);
+	ChannelMeshCheckpoint::Write<u_int32_t> (os, m_pendingSojourn);
+	ChannelMeshCheckpoint::Write<int64_t> (os, changeStateLeft);
+	ChannelMeshCheckpoint::Write<int64_t> (os, coherenceLeft);
+}
+
+bool HiddenMarkovModelEntry::Deserialize (istream &is)
+{
+	NS_LOG_FUNCTION (this);
+	u_int8_t eventStarted;
+	int64_t changeStateLeft, coherenceLeft;
+
+	if (!ChannelMeshCheckpoint::Read (is, m_currentState) || !ChannelMeshCheckpoint::Read (is, eventStarted)
+			|| !ChannelMeshCheckpoint::Read (is, m_pendingSojourn) || !ChannelMeshCheckpoint::Read (is, changeStateLeft)
+			|| !ChannelMeshCheckpoint::Read (is, coherenceLeft))
+		return false;
+
+	NS_ASSERT_MSG (m_currentState < m_transitionMatrix.size(), "Checkpoint state " << (int) m_currentState << " out of range, cannot continue");
+	m_eventStarted = eventStarted;
+
+	if (m_changeStateTimeout.IsRunning())
+		m_changeStateTimeout.Cancel();
+	if (m_coherenceTimeout.IsRunning())
+		m_coherenceTimeout.Cancel();
+
+	if (changeStateLeft >= 0)
+		m_changeStateTimeout = Simulator::Schedule (NanoSeconds (changeStateLeft), &HiddenMarkovModelEntry::TimerHandler, this);
+	if (coherenceLeft >= 0)
+		m_coherenceTimeout = Simulator::Schedule (NanoSeconds (coherenceLeft), &HiddenMarkovModelEntry::CoherenceTimeoutHandler, this);
+
+	return true;
+}
 
 std::string HiddenMarkovModelEntry::GetCwd()
 {
@@ -30,6 +30,7 @@
 
 #include "ns3/core-module.h"
 #include "ns3/channel-mesh-propagation-handler.h"
+#include "hidden-markov-kernel.h"
 
 using namespace ns3;
 using namespace std;
@@ -37,13 +38,17 @@ using namespace std;
 ///Enumerate which defines the type of simulation:
 // Time-based: We need to tailor the mean sojourn time at each state within the chain (see documentation)
 // Frame-based: After each reception a change state function is triggered
+// Semi-Markov: Frame-based, but the number of frames spent at each state is drawn from an arbitrary (empirical) distribution when the state
+//              is entered, instead of being the geometric one inherent to a_ii. Thus, a burst of k frames costs one draw; a link started
+//              in equilibrium (stationary initial state) only gets the residual sojourn of its first state
 
 //class HiddenMarkovErrorModel;
 
 enum HiddenMarkovSimulationMode
 {
 	HMM_TIME_BASED_SIMULATION,
-	HMM_FRAME_BASED_SIMULATION
+	HMM_FRAME_BASED_SIMULATION,
+	HMM_SEMI_MARKOV_SIMULATION
 };
 
 class HiddenMarkovModelEntry: public Object
@@ -90,6 +95,16 @@ public:
 	 */
 	bool GetCoefficients (string transitionMatrixFileName, string emissionMatrixFileName);
 
+	/**
+	 * Read the sojourn distributions (semi-Markov simulations). The first line holds the number of states; then, each line describes the
+	 * empirical CDF of the number of frames spent at a state: "K d_1 F_1 d_2 F_2 ... d_K F_K", being d_k increasing burst lengths and F_k the
+	 * probability of a sojourn lower or equal than d_k (F_K = 1). Must be invoked after GetCoefficients, since the number of states must match.
+	 * The file is parsed only once; the links loaded from it get their own copy of the distributions
+	 * \param sojournFileName File name (relative to the configs folder)
+	 * \returns False if an error happened during the file extraction, true otherwise
+	 */
+	bool GetSojournDistributions (string sojournFileName);
+
 	/**
 	 * \brief Method that calculates the average transmission time as a function of the number of retransmission carried out by the source node
 	 * We have followed the expression:
@@ -107,6 +122,12 @@ public:
 	 */
 	void ChangeState ();
 
+	/**
+	 * Move the chain as a new frame (i.e. each subframe of an aggregate) had been received at this link. Only frame-based and
+	 * semi-Markov simulations; in time-based ones the state depends only on the timers
+	 */
+	void AdvanceFrame ();
+
 	/**
 	 * Print matrices (only for debugging issues). Namely, the transition and decision matrices,
 	 * the average state duration and the average inter-frame space duration per state.
@@ -146,8 +167,53 @@ public:
 	 */
 	double GetDecisionValue (u_int8_t currentState);
 
+	/**
+	 * \brief Calculate the stationary distribution of the chain sampled by the kernel (see HiddenMarkovKernel::NextState) by means of the
+	 * power iteration method (pi = pi * A). We iterate over the lazy chain (I + A) / 2, which shares the same stationary vector but converges
+	 * even if the original chain is periodic. In time-based simulations each state is weighted by its average inter-frame time, so that the
+	 * result holds the fraction of time spent at each state.
+	 * The result is shared among all the links which use the same parameter set (transition/emission files and simulation mode)
+	 */
+	void CalcStationaryDistribution ();
+
+	/**
+	 * \param state State within the chain
+	 * \returns The probability of finding the link at the given state once the chain has reached the equilibrium
+	 */
+	double GetStationaryProbability (u_int8_t state);
+
+	/**
+	 * \brief Draw a state from the stationary distribution, so the link starts (or restarts) in statistical equilibrium and no warm-up period is needed
+	 * \returns The chosen state
+	 */
+	u_int8_t DrawStationaryState ();
+
+	/**
+	 * \brief Store the link state (current state, pending sojourn and the time left of the running timers) into a checkpoint
+	 * \param os Output stream (binary mode)
+	 */
+	void Serialize (ostream &os) const;
+
+	/**
+	 * \brief Rebuild the link state from a checkpoint, rescheduling the timers (time-based simulations) with their remaining time
+	 * \param is Input stream (binary mode)
+	 * \returns False if the stream ended unexpectedly
+	 */
+	bool Deserialize (istream &is);
+
 
 private:
+	/**
+	 * \returns Number of frames of a whole sojourn at the current state (semi-Markov simulations)
+	 */
+	u_int32_t DrawSojourn ();
+
+	/**
+	 * \returns Number of frames left of the sojourn at the current state, the current frame included, when the chain is found at an
+	 * arbitrary frame of its equilibrium: P(R = r) = P(D >= r) / E[D] (semi-Markov simulations)
+	 */
+	u_int32_t DrawResidualSojourn ();
+
 	bool m_eventStarted;							//Flag enabled upon the first packet reception at a particular link
 	u_int8_t m_currentState;						//State within the Markov chain at time t
 
@@ -156,6 +222,19 @@ private:
 
 	vector <double> m_meanDurationVector;   		//Mean duration (in frames) within each state (Nx1)
 	vector <double> m_averageInterFrameTime;        //Each state will show a different average inter-frame space, inherent to its intrinsic Erroneous Frame Burst
+	vector <IntEmpiricalVariable> m_sojournDistribution;	//Number of frames spent at each state (only semi-Markov simulations) (Nx1)
+	vector <double> m_meanSojourn;					//Mean of the distributions above (in frames) (Nx1)
+	vector <u_int32_t> m_maxSojourn;				//Longest sojourn of the distributions above (in frames) (Nx1)
+	u_int32_t m_pendingSojourn;						//Frames left before leaving the current state (only semi-Markov simulations)
+	vector <double> m_stationaryDistribution;		//Probability of finding the chain at each state once it has reached the equilibrium (Nx1)
+
+	//Per-frame engine (state changes and decision values), built from the matrices above once they have been loaded
+	Ptr<HiddenMarkovKernel> m_kernel;
+
+	string m_transitionMatrixFileName;				//Files which hold the current parameter set (used as key to share the stationary distribution)
+	string m_emissionMatrixFileName;
+	string m_sojournFileName;
+	bool m_stationaryInitialState;					//If true, draw the initial state from the stationary distribution; otherwise, choose it uniformly
 
 	//Legacy IEEE 802.11b default parameters
 	double m_fixedTransmissionTime;					//Deterministic time for a frame transmission (supposed 1472 bytes) --> 1617 microseconds (IMPORTANT: It is still missing the random contention window period)
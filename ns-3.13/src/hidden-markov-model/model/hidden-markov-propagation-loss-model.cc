@@ -21,6 +21,7 @@
 
 #include <math.h>
 #include <fstream>
+#include <sstream>
 
 #include "ns3/core-module.h"
 #include "ns3/node.h"
@@ -70,7 +71,18 @@ HiddenMarkovPropagationLossModel::GetTypeId(void) {
 	       EnumValue (HMM_TIME_BASED_SIMULATION),
 	       MakeEnumAccessor (&HiddenMarkovPropagationLossModel::m_mode),
 	       MakeEnumChecker (HMM_TIME_BASED_SIMULATION, "HMM_TIME_BASED_SIMULATION",
-	                        HMM_FRAME_BASED_SIMULATION, "HMM_FRAME_BASED_SIMULATION"))
+	                        HMM_FRAME_BASED_SIMULATION, "HMM_FRAME_BASED_SIMULATION",
+	                        HMM_SEMI_MARKOV_SIMULATION, "HMM_SEMI_MARKOV_SIMULATION"))
+	.AddAttribute ("SojournFile",
+			"File which holds the per-state sojourn distributions (only semi-Markov simulations)",
+			StringValue (""),
+			MakeStringAccessor (&HiddenMarkovPropagationLossModel::m_sojournFile),
+			MakeStringChecker ())
+	.AddAttribute ("StationaryInitialState",
+			"Draw the initial state of each link from the stationary distribution of its chain (otherwise, choose it uniformly)",
+			BooleanValue (true),
+			MakeBooleanAccessor (&HiddenMarkovPropagationLossModel::m_stationaryInitialState),
+			MakeBooleanChecker ())
 //	.AddAttribute("DynamicTimeBasedAnalysis",
 //			"Use (or not) of the inter frame space model for each state",
 //			BooleanValue (true),
@@ -89,7 +101,6 @@ void HiddenMarkovPropagationLossModel::InitFromFile (string transitionMatrixFile
 	NS_LOG_FUNCTION (transitionMatrixFileName << emissionMatrixFileName);
 
 	u_int16_t i,j;
-	UniformVariable ranvar (0.0, (double) transitionMatrixFileName.size() - 1 );
 
 	// Instance the links from NodeList call --> There will be considered as the same link between nodes, although there might be from different interfaces
 	for (i = 0; i < (int) NodeList().GetNNodes(); i++) {
@@ -102,9 +113,8 @@ void HiddenMarkovPropagationLossModel::InitFromFile (string transitionMatrixFile
 				entry->GetCoefficients (transitionMatrixFileName, emissionMatrixFileName);
 				entry->m_mode = m_mode;
 
-				//Randomly choose the initial state
-				UniformVariable ranvar (0.0, (double) entry->m_transitionMatrix.size() - 1 );
-				entry->m_currentState = ranvar.GetInteger(0, entry->m_transitionMatrix.size() - 1 );
+				//Choose the initial state
+				SetInitialState (entry);
 
 
 				//Insert the element into the map
@@ -148,9 +158,8 @@ void HiddenMarkovPropagationLossModel::InitFromFer (std::map<int, vector <u_int8
 					break;
 				}
 
-				//Randomly choose the initial state
-				UniformVariable ranvar (0.0, (double) entry->m_transitionMatrix.size() - 1 );
-				entry->m_currentState = ranvar.GetInteger(0, entry->m_transitionMatrix.size() - 1 );
+				//Choose the initial state
+				SetInitialState (entry);
 
 				//Insert the element into the map
 				m_hmmNetworkMap.insert (pair<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> > (key, entry));
@@ -177,9 +186,8 @@ void HiddenMarkovPropagationLossModel::InitFromDistance ()
 				entry->MapDistanceValue (tx->GetDistanceFrom(rx));
 				entry->m_mode = m_mode;
 
-				//Randomly choose the initial state
-				UniformVariable ranvar (0.0, (double) entry->m_transitionMatrix.size() - 1 );
-				entry->m_currentState = ranvar.GetInteger(0, entry->m_transitionMatrix.size() - 1 );
+				//Choose the initial state
+				SetInitialState (entry);
 
 				//Insert the element into the map
 				m_hmmNetworkMap.insert (pair<ChannelMeshPropagationKey, Ptr <HiddenMarkovModelEntry> > (key, entry));
@@ -188,6 +196,70 @@ void HiddenMarkovPropagationLossModel::InitFromDistance ()
 	}
 }
 
+void HiddenMarkovPropagationLossModel::SetInitialState (Ptr<HiddenMarkovModelEntry> entry)
+{
+	NS_LOG_FUNCTION (entry);
+
+	//Semi-Markov simulations: load the sojourn distributions (they must be available before looking for the stationary distribution)
+	if (m_mode == HMM_SEMI_MARKOV_SIMULATION)
+	{
+		NS_ASSERT_MSG (m_sojournFile.size(), "Semi-Markov simulation without sojourn file, cannot continue");
+		entry->GetSojournDistributions (m_sojournFile);
+	}
+
+	entry->m_stationaryInitialState = m_stationaryInitialState;
+
+	if (m_stationaryInitialState)		//Start the link in statistical equilibrium
+	{
+		entry->m_currentState = entry->DrawStationaryState ();
+	}
+	else								//Legacy behavior --> Randomly choose the initial state
+	{
+		UniformVariable ranvar (0.0, (double) entry->m_transitionMatrix.size() - 1 );
+		entry->m_currentState = ranvar.GetInteger(0, entry->m_transitionMatrix.size() - 1 );
+	}
+}
+
+vector<ChannelMeshPropagationKey> HiddenMarkovPropagationLossModel::GetLinks () const
+{
+	vector<ChannelMeshPropagationKey> links;
+	for (channelSetIter_t iter = m_hmmNetworkMap.begin(); iter != m_hmmNetworkMap.end(); iter++)
+	{
+		links.push_back (iter->first);
+	}
+	return links;
+}
+
+Ptr<HiddenMarkovModelEntry> HiddenMarkovPropagationLossModel::GetLinkEntry (Ptr<MobilityModel> sender, Ptr<MobilityModel> receiver) const
+{
+	channelSetIter_t iter = m_hmmNetworkMap.find (ChannelMeshPropagationKey (sender, receiver));
+	return (iter != m_hmmNetworkMap.end()) ? iter->second : Ptr<HiddenMarkovModelEntry> ();
+}
+
+bool HiddenMarkovPropagationLossModel::SaveChannelState (string fileName) const
+{
+	NS_LOG_FUNCTION (fileName);
+
+	if (!ChannelMeshCheckpoint::Save (fileName, "HMM", m_hmmNetworkMap))
+	{
+		NS_LOG_ERROR ("Cannot create the checkpoint file " << fileName);
+		return false;
+	}
+	return true;
+}
+
+bool HiddenMarkovPropagationLossModel::LoadChannelState (string fileName)
+{
+	NS_LOG_FUNCTION (fileName);
+
+	if (!ChannelMeshCheckpoint::Load (fileName, "HMM", m_hmmNetworkMap))
+	{
+		NS_LOG_ERROR ("Cannot restore the checkpoint file " << fileName);
+		return false;
+	}
+	return true;
+}
+
 double HiddenMarkovPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
 {
 	NS_LOG_FUNCTION (a << b << Simulator::Now().GetSeconds());
@@ -225,8 +297,8 @@ double HiddenMarkovPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<M
 //		m_error->SetDecisionValue ((iter->second->m_emissionMatrix[iter->second->m_currentState])[0]);
 //		m_error->SetCurrentState (iter->second->m_currentState);
 
-		//If the simulation is time-based, the chain is prone to change its current state after the reception of each frame
-		if (m_mode == HMM_FRAME_BASED_SIMULATION)
+		//If the simulation is frame-based (or semi-Markov), the chain is prone to change its current state after the reception of each frame
+		if (m_mode == HMM_FRAME_BASED_SIMULATION || m_mode == HMM_SEMI_MARKOV_SIMULATION)
 		{
 			iter->second->ChangeState ();
 		}
@@ -238,3 +310,9 @@ double HiddenMarkovPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<M
 
 	return txPowerDbm;
 }
+
+double HiddenMarkovPropagationLossModel::DoCalcInterferenceRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+	NS_LOG_FUNCTION (a << b << Simulator::Now().GetSeconds());
+	return txPowerDbm;
+}
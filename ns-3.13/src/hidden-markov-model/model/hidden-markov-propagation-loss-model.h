@@ -79,6 +79,33 @@ public:
 	 */
 	void InitFromDistance ();
 
+	/**
+	 * \brief Store the state of every link (current state, pending sojourn and timers) into a binary checkpoint, so that a warmed-up channel
+	 * can be later restored (i.e. to carry out several experiments over the same channel state)
+	 * \param fileName Checkpoint file
+	 * \returns False if the file could not be written
+	 */
+	bool SaveChannelState (string fileName) const;
+
+	/**
+	 * \returns The keys (mobility models and node IDs) of all the links handled by the model
+	 */
+	vector<ChannelMeshPropagationKey> GetLinks () const;
+	/**
+	 * \param sender Mobility model of the transmitter
+	 * \param receiver Mobility model of the receiver
+	 * \returns The entry which holds the state of the link (0 if the link does not exist)
+	 */
+	Ptr<HiddenMarkovModelEntry> GetLinkEntry (Ptr<MobilityModel> sender, Ptr<MobilityModel> receiver) const;
+
+	/**
+	 * \brief Rebuild the links state from a checkpoint created by SaveChannelState. The links must have been already created (Init* methods)
+	 * with the same parameter sets; they are matched by their node IDs and those not found in the current scenario are ignored
+	 * \param fileName Checkpoint file
+	 * \returns False if the file could not be read or does not hold a HMM checkpoint
+	 */
+	bool LoadChannelState (string fileName);
+
 	/**
 	 * Function inherited from the base class Propagation loss model. It is called at YansWifiPhy::StartReceive.
 	 * It is worth highlighting that this model does not aim at the characterization of the propagation loss, it is only a link between a propagation
@@ -93,6 +120,21 @@ public:
 			Ptr<MobilityModel> b) const;
 
 private:
+	/**
+	 * Frames which are only heard as interference do not start the timers of the link nor move its chain forward
+	 * \returns The transmission power
+	 */
+	virtual double DoCalcInterferenceRxPower (double txPowerDbm,
+			Ptr<MobilityModel> a,
+			Ptr<MobilityModel> b) const;
+
+	/**
+	 * Set the initial state of a recently created link, either from the stationary distribution of its chain or uniformly. In semi-Markov
+	 * simulations, the sojourn distributions are loaded here as well
+	 * \param entry The link to initialize (its coefficients must have been already loaded)
+	 */
+	void SetInitialState (Ptr<HiddenMarkovModelEntry> entry);
+
 	//New mesh-compatible HMM model parameters
 	typedef std::map<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> > channelSet_t;
 	typedef std::map<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> >::const_iterator channelSetIter_t;
@@ -104,6 +146,12 @@ private:
 	//Type of simulation
 	HiddenMarkovSimulationMode m_mode;
 
+	//Per-state sojourn distributions (only semi-Markov simulations)
+	string m_sojournFile;
+
+	//Start the links in statistical equilibrium (stationary distribution) instead of in a uniformly chosen state
+	bool m_stationaryInitialState;
+
 	//Important: Due to the architecture defined by default, the propagation and the error models are completely independent and invoked. However,
 	//we need to set a tightly linked dependency between the two models, since the results provided by the propagation loss model will be the input
 	//parameter of the error model
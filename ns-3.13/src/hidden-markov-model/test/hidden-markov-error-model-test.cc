@@ -0,0 +1,362 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *		   Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/enum.h"
+#include "ns3/double.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/msdu-standard-aggregator.h"
+#include "ns3/wifi-mac-header.h"
+#include "ns3/wifi-mac-trailer.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/tcp-header.h"
+#include "ns3/udp-header.h"
+#include "ns3/hidden-markov-propagation-loss-model.h"
+
+using namespace ns3;
+
+/**
+ * Every subframe of an A-MSDU is decided as a frame of its own type: on a link whose chain corrupts every frame, the UDP
+ * subframe is lost, while the TCP ACK and the ARP ones are always received
+ */
+class HiddenMarkovAggregateTestCase : public TestCase
+{
+public:
+	HiddenMarkovAggregateTestCase ();
+
+private:
+	virtual void DoRun (void);
+	void Received (Ptr<const Packet> packet, int node, bool error, u_int8_t state, double errorProbability);
+	Ptr<Packet> CreateMsdu (u_int16_t llcType, u_int8_t protocol, u_int32_t payloadSize) const;
+	Ptr<Packet> CreateAggregate (std::list<Ptr<Packet> > msdus) const;
+
+	u_int32_t m_nDecisions;
+	u_int32_t m_nErrors;
+};
+
+HiddenMarkovAggregateTestCase::HiddenMarkovAggregateTestCase ()
+	: TestCase ("Check that the subframes of an A-MSDU are classified as single frames by the HMM error model"),
+	  m_nDecisions (0),
+	  m_nErrors (0)
+{
+}
+
+void HiddenMarkovAggregateTestCase::Received (Ptr<const Packet> packet, int node, bool error, u_int8_t state, double errorProbability)
+{
+	m_nDecisions++;
+	if (error)
+	{
+		m_nErrors++;
+	}
+}
+
+Ptr<Packet> HiddenMarkovAggregateTestCase::CreateMsdu (u_int16_t llcType, u_int8_t protocol, u_int32_t payloadSize) const
+{
+	Ptr<Packet> msdu = Create<Packet> (payloadSize);
+	LlcSnapHeader llcHdr;
+
+	if (llcType == 0x0800)
+	{
+		if (protocol == 6)
+		{
+			TcpHeader tcpHdr;
+			tcpHdr.SetFlags (TcpHeader::ACK);
+			msdu->AddHeader (tcpHdr);
+		}
+		else
+		{
+			UdpHeader udpHdr;
+			msdu->AddHeader (udpHdr);
+		}
+		Ipv4Header ipv4Hdr;
+		ipv4Hdr.SetSource (Ipv4Address ("10.0.0.1"));
+		ipv4Hdr.SetDestination (Ipv4Address ("10.0.0.2"));
+		ipv4Hdr.SetProtocol (protocol);
+		ipv4Hdr.SetPayloadSize (msdu->GetSize ());
+		msdu->AddHeader (ipv4Hdr);
+	}
+	llcHdr.SetType (llcType);
+	msdu->AddHeader (llcHdr);
+
+	return msdu;
+}
+
+Ptr<Packet> HiddenMarkovAggregateTestCase::CreateAggregate (std::list<Ptr<Packet> > msdus) const
+{
+	Ptr<MsduAggregator> aggregator = CreateObject<MsduStandardAggregator> ();
+	Ptr<Packet> aggregate = Create<Packet> ();
+	Mac48Address src ("00:00:00:00:00:01");
+	Mac48Address dest ("00:00:00:00:00:02");
+	WifiMacHeader hdr;
+	WifiMacTrailer fcs;
+
+	for (std::list<Ptr<Packet> >::const_iterator i = msdus.begin (); i != msdus.end (); i++)
+	{
+		aggregator->Aggregate (*i, aggregate, src, dest);
+	}
+
+	hdr.SetType (WIFI_MAC_QOSDATA);
+	hdr.SetQosAmsdu ();
+	hdr.SetAddr1 (dest);
+	hdr.SetAddr2 (src);
+	hdr.SetAddr3 (Mac48Address ("00:00:00:00:00:03"));
+	aggregate->AddHeader (hdr);
+	aggregate->AddTrailer (fcs);
+
+	return aggregate;
+}
+
+void HiddenMarkovAggregateTestCase::DoRun (void)
+{
+	Ptr<Node> tx = CreateObject<Node> ();
+	Ptr<Node> rx = CreateObject<Node> ();
+	tx->AggregateObject (CreateObject<ConstantPositionMobilityModel> ());
+	rx->AggregateObject (CreateObject<ConstantPositionMobilityModel> ());
+
+	//Every link corrupts all the frames (option 1 of the channel configuration files)
+	std::map<int, vector<u_int8_t> > ferMap;
+	for (u_int32_t i = 0; i < NodeList::GetNNodes (); i++)
+	{
+		ferMap[i] = vector<u_int8_t> (NodeList::GetNNodes (), 1);
+	}
+
+	Ptr<HiddenMarkovPropagationLossModel> hmm = CreateObject<HiddenMarkovPropagationLossModel> ();
+	hmm->SetAttribute ("Mode", EnumValue (HMM_FRAME_BASED_SIMULATION));
+	hmm->InitFromFer (ferMap);
+
+	Ptr<HiddenMarkovErrorModel> error = hmm->GetErrorModel ();
+	error->SetTxIndex (tx->GetId ());
+	error->SetRxIndex (rx->GetId ());
+	error->SetRxCallback (MakeCallback (&HiddenMarkovAggregateTestCase::Received, this));
+
+	std::list<Ptr<Packet> > msdus;
+	vector<bool> received;
+	bool corrupted;
+
+	//UDP datagram, TCP ACK and ARP request
+	msdus.push_back (CreateMsdu (0x0800, 17, 100));
+	msdus.push_back (CreateMsdu (0x0800, 6, 0));
+	msdus.push_back (CreateMsdu (0x0806, 0, 28));
+	corrupted = error->CorruptAggregate (CreateAggregate (msdus), received);
+
+	NS_TEST_ASSERT_MSG_EQ (corrupted, true, "The UDP subframe should have corrupted the aggregate");
+	NS_TEST_ASSERT_MSG_EQ (received.size (), 3u, "Wrong number of subframes");
+	NS_TEST_ASSERT_MSG_EQ (received[0], false, "The UDP subframe goes through the HMM decision");
+	NS_TEST_ASSERT_MSG_EQ (received[1], true, "The TCP ACK subframe should always be received");
+	NS_TEST_ASSERT_MSG_EQ (received[2], true, "The ARP subframe should always be received");
+	NS_TEST_ASSERT_MSG_EQ (m_nDecisions, 3u, "The callback should be invoked once per subframe");
+	NS_TEST_ASSERT_MSG_EQ (m_nErrors, 1u, "Only the UDP subframe should be reported as corrupted");
+
+	//No data subframe --> The aggregate is received
+	msdus.clear ();
+	msdus.push_back (CreateMsdu (0x0800, 6, 0));
+	msdus.push_back (CreateMsdu (0x0806, 0, 28));
+	corrupted = error->CorruptAggregate (CreateAggregate (msdus), received);
+
+	NS_TEST_ASSERT_MSG_EQ (corrupted, false, "An aggregate of TCP ACKs and ARP should not be corrupted");
+	NS_TEST_ASSERT_MSG_EQ (received.size (), 2u, "Wrong number of subframes");
+	NS_TEST_ASSERT_MSG_EQ (received[0] && received[1], true, "Both subframes should be received");
+	NS_TEST_ASSERT_MSG_EQ (m_nDecisions, 5u, "The callback should be invoked once per subframe");
+
+	Simulator::Destroy ();
+}
+
+/**
+ * The state of the links stored by SaveChannelState is restored by LoadChannelState into a model built for the same scenario
+ */
+class HiddenMarkovChannelStateTestCase : public TestCase
+{
+public:
+	HiddenMarkovChannelStateTestCase ();
+
+private:
+	virtual void DoRun (void);
+	Ptr<HiddenMarkovPropagationLossModel> CreateModel (void) const;
+};
+
+HiddenMarkovChannelStateTestCase::HiddenMarkovChannelStateTestCase ()
+	: TestCase ("Check that the HMM channel state is restored from a checkpoint")
+{
+}
+
+Ptr<HiddenMarkovPropagationLossModel> HiddenMarkovChannelStateTestCase::CreateModel (void) const
+{
+	//Every link follows the chain of the configurable FER (option 5 of the channel configuration files)
+	std::map<int, vector<u_int8_t> > ferMap;
+	for (u_int32_t i = 0; i < NodeList::GetNNodes (); i++)
+	{
+		ferMap[i] = vector<u_int8_t> (NodeList::GetNNodes (), 5);
+	}
+
+	Ptr<HiddenMarkovPropagationLossModel> hmm = CreateObject<HiddenMarkovPropagationLossModel> ();
+	hmm->SetAttribute ("Mode", EnumValue (HMM_FRAME_BASED_SIMULATION));
+	hmm->SetAttribute ("FER", DoubleValue (0.5));
+	hmm->InitFromFer (ferMap);
+	return hmm;
+}
+
+void HiddenMarkovChannelStateTestCase::DoRun (void)
+{
+	u_int32_t i, j;
+	for (i = 0; i < 3; i++)
+	{
+		CreateObject<Node> ()->AggregateObject (CreateObject<ConstantPositionMobilityModel> ());
+	}
+
+	Ptr<HiddenMarkovPropagationLossModel> saved = CreateModel ();
+	Ptr<HiddenMarkovPropagationLossModel> restored = CreateModel ();
+	vector<ChannelMeshPropagationKey> links = saved->GetLinks ();
+	NS_TEST_ASSERT_MSG_EQ (links.size (), NodeList::GetNNodes () * (NodeList::GetNNodes () - 1), "Wrong number of links");
+
+	//Move the chains of the saved model until they differ from the ones of the other model (the checkpoint must then be noticed)
+	bool differ = false;
+	for (j = 0; j < 1000 && !differ; j++)
+	{
+		for (i = 0; i < links.size (); i++)
+		{
+			saved->GetLinkEntry (links[i].m_link.first, links[i].m_link.second)->AdvanceFrame ();
+			differ = differ || saved->GetLinkEntry (links[i].m_link.first, links[i].m_link.second)->GetCurrentState ()
+					!= restored->GetLinkEntry (links[i].m_link.first, links[i].m_link.second)->GetCurrentState ();
+		}
+	}
+	NS_TEST_ASSERT_MSG_EQ (differ, true, "The chains never left their initial state");
+
+	std::string fileName = CreateTempDirFilename ("hidden-markov-channel-state.bin");
+	NS_TEST_ASSERT_MSG_EQ (saved->SaveChannelState (fileName), true, "Cannot save the channel state");
+	NS_TEST_ASSERT_MSG_EQ (restored->LoadChannelState (fileName), true, "Cannot load the channel state");
+
+	for (i = 0; i < links.size (); i++)
+	{
+		NS_TEST_ASSERT_MSG_EQ ((u_int32_t) restored->GetLinkEntry (links[i].m_link.first, links[i].m_link.second)->GetCurrentState (),
+				(u_int32_t) saved->GetLinkEntry (links[i].m_link.first, links[i].m_link.second)->GetCurrentState (),
+				"State of link " << links[i].m_tx << " -> " << links[i].m_rx << " not restored");
+	}
+
+	//A checkpoint of a different model is rejected
+	NS_TEST_ASSERT_MSG_EQ (ChannelMeshCheckpoint::Load (fileName, "BEAR", std::map<ChannelMeshPropagationKey, Ptr<HiddenMarkovModelEntry> > ()),
+			false, "A HMM checkpoint should not be loaded as a BEAR one");
+
+	Simulator::Destroy ();
+}
+
+/**
+ * The links are started from (and the chains kept at) the stationary distribution calculated by the entry: the empirical occupancy of
+ * each state, either in frames (frame-based simulations) or in time (time-based ones), must match it
+ */
+class HiddenMarkovStationaryTestCase : public TestCase
+{
+public:
+	HiddenMarkovStationaryTestCase (HiddenMarkovSimulationMode mode);
+
+private:
+	virtual void DoRun (void);
+	void Sample (Ptr<HiddenMarkovModelEntry> entry, Time interval);
+
+	HiddenMarkovSimulationMode m_mode;
+	vector<u_int32_t> m_occupancy;
+};
+
+HiddenMarkovStationaryTestCase::HiddenMarkovStationaryTestCase (HiddenMarkovSimulationMode mode)
+	: TestCase (mode == HMM_TIME_BASED_SIMULATION ? "Check the time-based HMM occupancy against the stationary distribution"
+			: "Check the frame-based HMM occupancy against the stationary distribution"),
+	  m_mode (mode)
+{
+}
+
+void HiddenMarkovStationaryTestCase::Sample (Ptr<HiddenMarkovModelEntry> entry, Time interval)
+{
+	m_occupancy[entry->GetCurrentState ()]++;
+	Simulator::Schedule (interval, &HiddenMarkovStationaryTestCase::Sample, this, entry, interval);
+}
+
+void HiddenMarkovStationaryTestCase::DoRun (void)
+{
+	u_int32_t i, samples = 0;
+	const u_int8_t states = 4;
+	std::map<int, vector<u_int8_t> > ferMap;
+
+	for (i = 0; i < 2; i++)
+	{
+		CreateObject<Node> ()->AggregateObject (CreateObject<ConstantPositionMobilityModel> ());
+		ferMap[i] = vector<u_int8_t> (2, 5);
+	}
+
+	//FER 0.5 --> 4-state chain whose states are rarely left (a_ii ~ 0.95 - 0.99), the worst case for the former argmax sampling
+	Ptr<HiddenMarkovPropagationLossModel> hmm = CreateObject<HiddenMarkovPropagationLossModel> ();
+	hmm->SetAttribute ("Mode", EnumValue (m_mode));
+	hmm->SetAttribute ("FER", DoubleValue (0.5));
+	hmm->InitFromFer (ferMap);
+
+	vector<ChannelMeshPropagationKey> links = hmm->GetLinks ();
+	Ptr<HiddenMarkovModelEntry> entry = hmm->GetLinkEntry (links[0].m_link.first, links[0].m_link.second);
+	m_occupancy.assign (states, 0);
+
+	if (m_mode == HMM_TIME_BASED_SIMULATION)
+	{
+		//Fraction of time spent at each state, sampled every 10 ms (the mean sojourns last tens of frames of ~2 ms)
+		entry->InitializeTimer ();
+		Simulator::Schedule (MilliSeconds (10), &HiddenMarkovStationaryTestCase::Sample, this, entry, MilliSeconds (10));
+		Simulator::Stop (Seconds (10000));
+		Simulator::Run ();
+	}
+	else
+	{
+		//Fraction of frames received at each state
+		for (i = 0; i < 1000000; i++)
+		{
+			entry->AdvanceFrame ();
+			m_occupancy[entry->GetCurrentState ()]++;
+		}
+	}
+
+	for (i = 0; i < states; i++)
+	{
+		samples += m_occupancy[i];
+	}
+	for (i = 0; i < states; i++)
+	{
+		NS_TEST_ASSERT_MSG_EQ_TOL ((double) m_occupancy[i] / samples, entry->GetStationaryProbability (i), 0.03,
+				"Occupancy of state " << i << " does not match the stationary distribution");
+	}
+
+	Simulator::Destroy ();
+}
+
+class HiddenMarkovErrorModelTestSuite : public TestSuite
+{
+public:
+	HiddenMarkovErrorModelTestSuite ();
+};
+
+HiddenMarkovErrorModelTestSuite::HiddenMarkovErrorModelTestSuite ()
+	: TestSuite ("hidden-markov-error-model", UNIT)
+{
+	AddTestCase (new HiddenMarkovAggregateTestCase);
+	AddTestCase (new HiddenMarkovChannelStateTestCase);
+	AddTestCase (new HiddenMarkovStationaryTestCase (HMM_FRAME_BASED_SIMULATION));
+	AddTestCase (new HiddenMarkovStationaryTestCase (HMM_TIME_BASED_SIMULATION));
+}
+
+static HiddenMarkovErrorModelTestSuite hiddenMarkovErrorModelTestSuite;
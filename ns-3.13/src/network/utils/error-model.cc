@@ -23,6 +23,11 @@
 #include <stdio.h>
 
 #include <math.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <algorithm>
 
 #include "error-model.h"
 
@@ -33,6 +38,7 @@
 #include "ns3/boolean.h"
 #include "ns3/enum.h"
 #include "ns3/double.h"
+#include "ns3/uinteger.h"
 
 NS_LOG_COMPONENT_DEFINE ("ErrorModel");
 
@@ -373,6 +379,12 @@ ReceiveListErrorModel::DoReset (void)
 
 NS_OBJECT_ENSURE_REGISTERED (MatrixErrorModel);
 
+static bool
+CompareBreakpoints (const std::pair<Time, double> &a, const std::pair<Time, double> &b)
+{
+  return a.first < b.first;
+}
+
 TypeId
 MatrixErrorModel::GetTypeId(void) {
 	static TypeId tid = TypeId ("ns3::MatrixErrorModel")
@@ -383,12 +395,24 @@ MatrixErrorModel::GetTypeId(void) {
 			DoubleValue(0.0),
 			MakeDoubleAccessor(&MatrixErrorModel::m_default),
 			MakeDoubleChecker<double> (0.0, 1.0))
+	    .AddAttribute("ErrorProneFrames",
+			"Bitmask of the frame classes (see MatrixErrorModel::FrameClass) which can be corrupted",
+			UintegerValue(FRAME_DATA),
+			MakeUintegerAccessor(&MatrixErrorModel::m_errorProneFrames),
+			MakeUintegerChecker<u_int32_t> ())
 
 	;
   return tid;
 }
 
 MatrixErrorModel::MatrixErrorModel ()
+	: m_default (0.0),
+	  m_receiver (0),
+	  m_transmitter (0),
+	  m_frameClass (FRAME_CONTROL),
+	  m_errorProneFrames (FRAME_DATA),
+	  m_nodes (0),
+	  m_uniform (0.0, 1.0)
 {
 	NS_LOG_FUNCTION (this);
 }
@@ -403,37 +427,207 @@ MatrixErrorModel::SetFer (u_int16_t tx, u_int16_t rx, double fer)
 {
   NS_LOG_INFO ("MatrixPropagationLossErrorModel::SetFer | " << (int) tx  << " -> " << rx << " : FER = " << fer );
 
-  LinkPair p = std::make_pair (tx,rx);
-  std::map<LinkPair, double>::iterator i = m_ferMatrix.find (p);
+  if (tx >= m_nodes || rx >= m_nodes)
+      Resize (std::max (tx, rx) + 1);
+
+  m_ferMatrix[tx * m_nodes + rx] = fer;
+}
+
+void
+MatrixErrorModel::Resize (u_int16_t nodes)
+{
+  NS_LOG_FUNCTION (nodes);
+  u_int16_t i, j;
+  std::vector<double> ferMatrix ((size_t) nodes * nodes, -1.0);
 
-  if (i == m_ferMatrix.end ())
-      m_ferMatrix.insert (std::make_pair (p, fer));
+  for (i = 0; i < std::min (nodes, m_nodes); i++)
+    {
+      for (j = 0; j < std::min (nodes, m_nodes); j++)
+        {
+          ferMatrix[i * nodes + j] = m_ferMatrix[i * m_nodes + j];
+        }
+    }
+
+  m_ferMatrix.swap (ferMatrix);
+  m_nodes = nodes;
+  UpdateNextBreakpoints ();
+}
+
+void
+MatrixErrorModel::SetFerMatrix (u_int16_t nodes, const std::vector<double> &fer)
+{
+  NS_LOG_FUNCTION (nodes);
+  NS_ASSERT_MSG (fer.size () == (size_t) nodes * nodes, "FER matrix size (" << fer.size () << ") does not match " << nodes << " nodes");
+
+  m_ferMatrix = fer;
+  m_nodes = nodes;
+  UpdateNextBreakpoints ();
+}
+
+double
+MatrixErrorModel::GetFer (u_int16_t tx, u_int16_t rx) const
+{
+  double fer = -1.0;
+
+  if (tx < m_nodes && rx < m_nodes)
+    {
+      fer = (m_scheduledFer[tx * m_nodes + rx] < 0.0) ? m_ferMatrix[tx * m_nodes + rx] : m_scheduledFer[tx * m_nodes + rx];
+    }
+  return (fer < 0.0) ? m_default : fer;
+}
+
+void
+MatrixErrorModel::SetFerSchedule (u_int16_t tx, u_int16_t rx, const std::vector<std::pair<Time, double> > &schedule)
+{
+  NS_LOG_FUNCTION (tx << rx << schedule.size ());
+  FerSchedule ferSchedule;
+
+  for (size_t i = 0; i < schedule.size (); i++)
+    {
+      NS_ASSERT_MSG (!i || schedule[i - 1].first <= schedule[i].first, "FER schedule " << tx << " -> " << rx << " is not sorted by time");
+      ferSchedule.m_breakpoints.push_back (std::make_pair (schedule[i].first.GetNanoSeconds (), schedule[i].second));
+    }
+  ferSchedule.m_next = 0;
+  m_ferSchedules[std::make_pair (tx, rx)] = ferSchedule;
+
+  if (tx >= m_nodes || rx >= m_nodes)
+    Resize (std::max (tx, rx) + 1);
   else
-      i->second = fer;
+    UpdateNextBreakpoints ();
+}
+
+bool
+MatrixErrorModel::LoadFerSchedule (std::string fileName)
+{
+  NS_LOG_FUNCTION (fileName);
+  std::ifstream scheduleFile (fileName.c_str ());
+  std::map<LinkPair, std::vector<std::pair<Time, double> > > schedules;
+  std::map<LinkPair, std::vector<std::pair<Time, double> > >::iterator iter;
+  std::string line, token;
+  u_int32_t lineNumber = 0;
+
+  if (!scheduleFile)
+    {
+      NS_LOG_ERROR ("Cannot open the FER schedule file " << fileName);
+      return false;
+    }
+
+  while (std::getline (scheduleFile, line))
+    {
+      std::istringstream lineStream (line.substr (0, line.find ('#')));
+      u_int16_t tx, rx;
+      double time, fer;
+      lineNumber++;
+
+      if (!(lineStream >> token))
+        continue;			//Empty or comment line
+      tx = atoi (token.c_str ());
+      if (!(lineStream >> rx >> token))
+        {
+          NS_LOG_ERROR ("Malformed line " << lineNumber << " in " << fileName);
+          return false;
+        }
+
+      std::vector<std::pair<Time, double> > &schedule = schedules[std::make_pair (tx, rx)];
+      if (token == "TRACE")		//Trace-indexed: one FER per period
+        {
+          u_int32_t k = 0;
+          if (!(lineStream >> time))
+            {
+              NS_LOG_ERROR ("Malformed trace at line " << lineNumber << " in " << fileName);
+              return false;
+            }
+          while (lineStream >> fer)
+            {
+              schedule.push_back (std::make_pair (Seconds (k++ * time), fer));
+            }
+        }
+      else						//Single breakpoint
+        {
+          time = atof (token.c_str ());
+          if (!(lineStream >> fer))
+            {
+              NS_LOG_ERROR ("Malformed breakpoint at line " << lineNumber << " in " << fileName);
+              return false;
+            }
+          schedule.push_back (std::make_pair (Seconds (time), fer));
+        }
+    }
+
+  for (iter = schedules.begin (); iter != schedules.end (); iter++)
+    {
+      std::stable_sort (iter->second.begin (), iter->second.end (), CompareBreakpoints);
+      SetFerSchedule (iter->first.first, iter->first.second, iter->second);
+    }
+  return true;
 }
 
+void
+MatrixErrorModel::AdvanceFerSchedule (u_int16_t tx, u_int16_t rx, int64_t now)
+{
+  std::map<LinkPair, FerSchedule>::iterator iter = m_ferSchedules.find (std::make_pair (tx, rx));
+  size_t index = tx * m_nodes + rx;
 
+  if (iter == m_ferSchedules.end ())
+    {
+      m_nextBreakpoint[index] = std::numeric_limits<int64_t>::max ();
+      return;
+    }
+
+  FerSchedule &schedule = iter->second;
+  while (schedule.m_next < schedule.m_breakpoints.size () && schedule.m_breakpoints[schedule.m_next].first <= now)
+    {
+      m_scheduledFer[index] = schedule.m_breakpoints[schedule.m_next].second;
+      schedule.m_next++;
+      NS_LOG_DEBUG (Simulator::Now ().GetSeconds () << " " << tx << " -> " << rx << " : FER = " << m_scheduledFer[index]);
+    }
+  m_nextBreakpoint[index] = (schedule.m_next < schedule.m_breakpoints.size ()) ?
+      schedule.m_breakpoints[schedule.m_next].first : std::numeric_limits<int64_t>::max ();
+}
+
+void
+MatrixErrorModel::UpdateNextBreakpoints ()
+{
+  std::map<LinkPair, FerSchedule>::const_iterator iter;
+
+  m_scheduledFer.assign (m_ferMatrix.size (), -1.0);
+  m_nextBreakpoint.assign (m_ferMatrix.size (), std::numeric_limits<int64_t>::max ());
+  for (iter = m_ferSchedules.begin (); iter != m_ferSchedules.end (); iter++)
+    {
+      const FerSchedule &schedule = iter->second;
+      if (iter->first.first >= m_nodes || iter->first.second >= m_nodes)
+        continue;
+
+      size_t index = iter->first.first * m_nodes + iter->first.second;
+      if (schedule.m_next > 0)
+        {
+          m_scheduledFer[index] = schedule.m_breakpoints[schedule.m_next - 1].second;
+        }
+      if (schedule.m_next < schedule.m_breakpoints.size ())
+        {
+          m_nextBreakpoint[index] = schedule.m_breakpoints[schedule.m_next].first;
+        }
+    }
+}
 
 bool MatrixErrorModel::DoCorrupt (Ptr<Packet> p)
 {
 	NS_LOG_FUNCTION_NOARGS ();
 
 	double fer;
-	UniformVariable random (0.0, 1.0);
 
-	//Check if the frame had been defined as correct (i.e. ARP, 802.11 ACK...)
-	if (m_isCorrect || p->GetSize() < 1000)    //Temporal solution --> Only data packets (filtered by their length, which is supposed to be longer than the rest of the possible packets) will be error prone
+	//Only the frame classes selected by the ErrorProneFrames attribute (by default, data frames) can be corrupted
+	if (!(m_frameClass & m_errorProneFrames))
 		return false;
 
-	//Look up the FER value into the matrix
-	std::map<LinkPair, double>::const_iterator i = m_ferMatrix.find (std::make_pair (m_transmitter, m_receiver));
-	if (i != m_ferMatrix.end ())
-		fer = i->second;
-	else
-		fer = m_default;
+	//Apply the due breakpoints of the link FER schedule (if any), then look up the FER value into the matrix
+	if (m_transmitter < m_nodes && m_receiver < m_nodes
+			&& Simulator::Now ().GetNanoSeconds () >= m_nextBreakpoint[m_transmitter * m_nodes + m_receiver])
+		AdvanceFerSchedule (m_transmitter, m_receiver, Simulator::Now ().GetNanoSeconds ());
+	fer = GetFer (m_transmitter, m_receiver);
 
 	//Compare to a random value
-	if (random.GetValue() > fer)
+	if (m_uniform.GetValue() > fer)
 	{
 		NS_LOG_INFO (Simulator::Now().GetSeconds() <<  " " << m_transmitter << " -> " << m_receiver << " : CORRECT " << "(" << fer << ")" );
 		return false;
@@ -449,9 +643,12 @@ bool MatrixErrorModel::DoCorrupt (Ptr<Packet> p)
 void MatrixErrorModel::DoReset ()
 {
 	NS_LOG_FUNCTION_NOARGS();
+	std::map<LinkPair, FerSchedule>::iterator iter;
 
-	if (m_ferMatrix.size())
-		m_ferMatrix.clear();
+	//The configuration (static FER and schedules) is kept: every schedule is rewound, so the links go back to their static FER
+	for (iter = m_ferSchedules.begin (); iter != m_ferSchedules.end (); iter++)
+		iter->second.m_next = 0;
+	UpdateNextBreakpoints ();
 }
 
 
@@ -27,6 +27,7 @@
 
 ////David/Ramón
 #include <map>
+#include <vector>
 #include "ns3/node.h"
 #include "ns3/simulator.h"
 ////End David/Ramón
@@ -306,14 +307,66 @@ public:
 	virtual ~MatrixErrorModel ();
 
 	/**
-	 * \brief Set FER ([0,1]) between a pair of ns-3 objects (typically, nodes).
+	 * Classes of frames, as identified by the PHY layer before asking for a decision. Only the classes held by the ErrorProneFrames
+	 * attribute (bitmask) are prone to be corrupted; the rest are always received correctly
+	 */
+	enum FrameClass {
+		FRAME_DATA = 0x01,			//UDP datagrams and TCP data segments
+		FRAME_TCP_ACK = 0x02,		//TCP segments without payload (acknowledgements)
+		FRAME_ARP = 0x04,			//ARP messages
+		FRAME_MAC_ACK = 0x08,		//IEEE 802.11 ACK
+		FRAME_CONTROL = 0x10		//Broadcast, control and management frames
+	};
+
+	/**
+	 * \brief Set FER ([0,1]) between a pair of ns-3 objects (typically, nodes). The FER matrix grows if any of the node IDs does not fit
 	 *
-	 * \param a ma          Source mobility model
-	 * \param b mb          Destination mobility model
-	 * \param fer        a -> b FER, values from 0 to 1
+	 * \param tx        Source node ID
+	 * \param rx        Destination node ID
+	 * \param fer        tx -> rx FER, values from 0 to 1
 	 */
 	void SetFer (u_int16_t tx, u_int16_t rx, double fer);
 
+	/**
+	 * \brief Size the FER matrix for a number of nodes (the already configured links are kept). Links not set will use the default FER
+	 * \param nodes Number of nodes (node IDs from 0 to nodes - 1)
+	 */
+	void Resize (u_int16_t nodes);
+
+	/**
+	 * \brief Bulk-load the FER of every link (i.e. from the channel configuration matrix)
+	 * \param nodes Number of nodes
+	 * \param fer Row-major (tx * nodes + rx) FER values; negative values stand for the default FER
+	 */
+	void SetFerMatrix (u_int16_t nodes, const std::vector<double> &fer);
+
+	/**
+	 * \param tx Source node ID
+	 * \param rx Destination node ID
+	 * \returns The FER of the link: the scheduled one if any breakpoint is due, else the static one (the default one if the link
+	 * has not been set)
+	 */
+	double GetFer (u_int16_t tx, u_int16_t rx) const;
+
+	/**
+	 * \brief Set a piecewise-constant FER schedule for a link: from each breakpoint on, the link takes the given FER, which takes
+	 * precedence over the static FER (SetFer, SetFerMatrix). Before the first breakpoint the static FER applies. The schedule is
+	 * advanced lazily, when a frame of the link is decided, and rewound by Reset
+	 * \param tx Source node ID
+	 * \param rx Destination node ID
+	 * \param schedule (time, FER) breakpoints, sorted by time
+	 */
+	void SetFerSchedule (u_int16_t tx, u_int16_t rx, const std::vector<std::pair<Time, double> > &schedule);
+
+	/**
+	 * \brief Load the FER schedules from a file. Each line holds either a breakpoint or a whole trace of a link ('#' starts a comment):
+	 *  - "tx rx time fer": from time (seconds) on, the link tx -> rx takes the given FER
+	 *  - "tx rx TRACE period fer_0 fer_1 ... fer_n": the link takes fer_k from k * period (seconds) on
+	 * \param fileName Schedule file
+	 * \returns False if the file could not be read or holds a malformed line
+	 */
+	bool LoadFerSchedule (std::string fileName);
+
 	/**
 	 * Set default loss (in dB, positive) to be used, infinity if not set
 	 * \param fer Default FER value (by default, FER = 0.0)
@@ -340,28 +393,51 @@ public:
 	 */
 	inline u_int16_t GetTransmitter () {return m_transmitter;}
 	/**
-	 * Force a frame to be correct (or corrupt prone)
-	 * \parameter
+	 * Class of the frame on which the next decision is taken
+	 * \param frameClass Frame class, as identified by the PHY
 	 */
-	inline void SetCorrect (bool flag) {m_isCorrect = flag;}
-
-
+	inline void SetFrameClass (FrameClass frameClass) {m_frameClass = frameClass;}
 
 private:
 	//Inherited pure virtual methods
 	virtual bool DoCorrupt (Ptr<Packet> p);
 	virtual void DoReset ();
 
+	/**
+	 * Apply the breakpoints of the link schedule which are already due
+	 * \param tx Source node ID
+	 * \param rx Destination node ID
+	 * \param now Current simulation time (ns)
+	 */
+	void AdvanceFerSchedule (u_int16_t tx, u_int16_t rx, int64_t now);
+	/**
+	 * Rebuild the (dense) scheduled FER and next breakpoint indexes from the schedule cursors (i.e. after the FER matrix is resized
+	 * or replaced)
+	 */
+	void UpdateNextBreakpoints ();
+
 private:
 	/// default loss
 	double m_default;
 	u_int16_t m_receiver; 			//Node ID of the receiver entity
 	u_int16_t m_transmitter;		//Node ID of the transmitter entity
-	bool m_isCorrect;				//Flag that forces a received frame to be correct
-
-	typedef std::pair< u_int16_t, u_int16_t > LinkPair;  //Key element: TX/RX duple. Data: Corresponding FER value of the link
-	/// Fixed FER between pair of nodes
-	std::map<LinkPair, double> m_ferMatrix;
+	FrameClass m_frameClass;		//Class of the frame under decision
+	u_int32_t m_errorProneFrames;	//Bitmask of the frame classes which can be corrupted
+
+	/// Fixed FER between pair of nodes, indexed by tx * m_nodes + rx (negative --> default FER)
+	u_int16_t m_nodes;
+	std::vector<double> m_ferMatrix;
+	UniformVariable m_uniform;
+
+	/// FER schedules: breakpoints (ns, FER) and position of the next one to be applied
+	typedef std::pair<u_int16_t, u_int16_t> LinkPair;
+	struct FerSchedule {
+		std::vector<std::pair<int64_t, double> > m_breakpoints;
+		size_t m_next;
+	};
+	std::map<LinkPair, FerSchedule> m_ferSchedules;
+	std::vector<double> m_scheduledFer;			//Dense (as m_ferMatrix) FER of the last applied breakpoint (negative --> static FER)
+	std::vector<int64_t> m_nextBreakpoint;		//Dense (as m_ferMatrix) time of the next breakpoint of each link (ns)
 
 };
 
@@ -23,11 +23,19 @@
 
 #include "ns3/node.h"
 #include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include "ns3/random-variable.h"
+#include "ns3/log.h"
 #include "channel-mesh-propagation-handler.h"
 
 using namespace std;
 using namespace ns3;
 
+NS_LOG_COMPONENT_DEFINE ("ChannelMeshPropagationHandler");
+
+//Checkpoint file identification
+static const char g_checkpointMagic[8] = {'N', 'S', '3', 'C', 'H', 'C', 'K', '1'};
+
 
 ChannelMeshPropagationKey::ChannelMeshPropagationKey (Ptr<MobilityModel> tx, Ptr<MobilityModel> rx)
 {
@@ -42,3 +50,51 @@ ChannelMeshPropagationKey::ChannelMeshPropagationKey (Ptr<MobilityModel> tx, Ptr
 	m_rx = rxId;
 }
 
+void ChannelMeshCheckpoint::WriteHeader (ostream &os, const string &model, u_int32_t links)
+{
+	NS_LOG_FUNCTION (model << links);
+
+	os.write (g_checkpointMagic, sizeof (g_checkpointMagic));
+	Write<u_int32_t> (os, model.size());
+	os.write (model.data(), model.size());
+	Write<u_int32_t> (os, SeedManager::GetSeed ());
+	Write<u_int32_t> (os, SeedManager::GetRun ());
+	Write<int64_t> (os, Simulator::Now ().GetNanoSeconds ());
+	Write<u_int32_t> (os, links);
+}
+
+bool ChannelMeshCheckpoint::ReadHeader (istream &is, const string &model, u_int32_t &links)
+{
+	NS_LOG_FUNCTION (model);
+	char magic[sizeof (g_checkpointMagic)];
+	u_int32_t length, seed, run;
+	int64_t time;
+
+	is.read (magic, sizeof (magic));
+	if (!is.good () || string (magic, sizeof (magic)) != string (g_checkpointMagic, sizeof (g_checkpointMagic)))
+	{
+		NS_LOG_ERROR ("Not a channel checkpoint");
+		return false;
+	}
+
+	if (!Read (is, length))
+		return false;
+	string storedModel (length, ' ');
+	is.read (&storedModel[0], length);
+	if (!is.good () || storedModel != model)
+	{
+		NS_LOG_ERROR ("Checkpoint taken from " << storedModel << ", cannot restore " << model);
+		return false;
+	}
+
+	if (!Read (is, seed) || !Read (is, run) || !Read (is, time) || !Read (is, links))
+		return false;
+
+	NS_LOG_INFO ("Restoring " << links << " links (" << model << ") taken at " << time / 1e9 << " s (seed " << seed << ", run " << run << ")");
+	if (seed != SeedManager::GetSeed () || run != SeedManager::GetRun ())
+	{
+		NS_LOG_WARN ("Checkpoint taken with seed " << seed << " and run " << run << "; current ones are " << SeedManager::GetSeed ()
+				<< " and " << SeedManager::GetRun ());
+	}
+	return true;
+}
@@ -22,6 +22,12 @@
 #ifndef CHANNEL_MESH_PROPAGATION_HANDLER_H_
 #define CHANNEL_MESH_PROPAGATION_HANDLER_H_
 
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+
 #include "ns3/object.h"
 #include "ns3/propagation-loss-model.h"
 #include "ns3/mobility-model.h"
@@ -70,6 +76,116 @@ public:
 };
 
 
+/**
+ * \brief Auxiliar class used to store (and restore) the per-link state of the memory-channel models (i.e. BEAR, HMM) into a compact
+ * binary checkpoint. Every checkpoint starts with a header which identifies the model, the random seed/run and the simulation time at which
+ * it was taken; the links are then stored as (tx ID, rx ID, payload length, payload) records, so a link which does not exist in the
+ * restored scenario can be skipped
+ */
+class ChannelMeshCheckpoint
+{
+public:
+	/**
+	 * \param os Output stream (opened in binary mode)
+	 * \param model Tag of the model which writes the checkpoint
+	 * \param links Number of link records which will follow the header
+	 */
+	static void WriteHeader (std::ostream &os, const std::string &model, u_int32_t links);
+	/**
+	 * \param is Input stream (opened in binary mode)
+	 * \param model Tag of the model which reads the checkpoint (it must match the stored one)
+	 * \param links Number of link records which follow the header
+	 * \returns False if the stream does not hold a valid checkpoint of the given model
+	 */
+	static bool ReadHeader (std::istream &is, const std::string &model, u_int32_t &links);
+
+	template <typename T>
+	static void Write (std::ostream &os, const T &value)
+	{
+		os.write (reinterpret_cast<const char *> (&value), sizeof (T));
+	}
+
+	template <typename T>
+	static bool Read (std::istream &is, T &value)
+	{
+		is.read (reinterpret_cast<char *> (&value), sizeof (T));
+		return is.good ();
+	}
+
+	/**
+	 * \brief Store the state of every link of a model into a checkpoint file
+	 * \param fileName Checkpoint file
+	 * \param model Tag of the model which writes the checkpoint
+	 * \param links Per-link entries of the model (Entry must provide void Serialize (std::ostream &) const)
+	 * \returns False if the file could not be written
+	 */
+	template <typename Entry>
+	static bool Save (const std::string &fileName, const std::string &model, const std::map<ChannelMeshPropagationKey, Ptr<Entry> > &links)
+	{
+		std::ofstream checkpointFile (fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!checkpointFile)
+			return false;
+
+		WriteHeader (checkpointFile, model, links.size());
+		for (typename std::map<ChannelMeshPropagationKey, Ptr<Entry> >::const_iterator iter = links.begin(); iter != links.end(); iter++)
+		{
+			std::ostringstream payload;
+			iter->second->Serialize (payload);
+
+			Write<u_int32_t> (checkpointFile, iter->first.m_tx);
+			Write<u_int32_t> (checkpointFile, iter->first.m_rx);
+			Write<u_int32_t> (checkpointFile, payload.str().size());
+			checkpointFile.write (payload.str().data(), payload.str().size());
+		}
+
+		return checkpointFile.good ();
+	}
+
+	/**
+	 * \brief Rebuild the state of the links of a model from a checkpoint created by Save. Links are matched by their node IDs; those not
+	 * found in the current scenario are skipped
+	 * \param fileName Checkpoint file
+	 * \param model Tag of the model which reads the checkpoint (it must match the stored one)
+	 * \param links Per-link entries of the model (Entry must provide bool Deserialize (std::istream &))
+	 * \returns False if the file could not be read, does not hold a checkpoint of the given model or holds a corrupted record
+	 */
+	template <typename Entry>
+	static bool Load (const std::string &fileName, const std::string &model, const std::map<ChannelMeshPropagationKey, Ptr<Entry> > &links)
+	{
+		std::ifstream checkpointFile (fileName.c_str(), std::ios::in | std::ios::binary);
+		u_int32_t i, nLinks, tx, rx, length;
+		std::map<std::pair<u_int32_t, u_int32_t>, Ptr<Entry> > linksById;
+		typename std::map<std::pair<u_int32_t, u_int32_t>, Ptr<Entry> >::iterator link;
+
+		if (!checkpointFile || !ReadHeader (checkpointFile, model, nLinks))
+			return false;
+
+		for (typename std::map<ChannelMeshPropagationKey, Ptr<Entry> >::const_iterator iter = links.begin(); iter != links.end(); iter++)
+		{
+			linksById[std::make_pair (iter->first.m_tx, iter->first.m_rx)] = iter->second;
+		}
+
+		for (i = 0; i < nLinks; i++)
+		{
+			if (!Read (checkpointFile, tx) || !Read (checkpointFile, rx) || !Read (checkpointFile, length))
+				return false;
+
+			std::string payload (length, ' ');
+			checkpointFile.read (&payload[0], length);
+
+			link = linksById.find (std::make_pair (tx, rx));
+			if (link == linksById.end())
+				continue;
+
+			std::istringstream payloadStream (payload);
+			if (!link->second->Deserialize (payloadStream))
+				return false;
+		}
+
+		return true;
+	}
+};
+
 class ChannelMeshPropagationEntry: public Object
 {
 public:
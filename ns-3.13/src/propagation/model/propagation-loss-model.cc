@@ -26,7 +26,10 @@
 #include "ns3/mobility-model.h"
 #include "ns3/boolean.h"
 #include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/node.h"
 #include <math.h>
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE ("PropagationLossModel");
 
@@ -34,6 +37,9 @@ namespace ns3 {
 
 // ------------------------------------------------------------------------- //
 
+// Stamp of the last parameters change of any loss model (see PropagationLossModel::NotifyParametersChanged)
+static uint32_t g_lastParametersStamp = 0;
+
 NS_OBJECT_ENSURE_REGISTERED (PropagationLossModel);
 
 TypeId 
@@ -41,12 +47,21 @@ PropagationLossModel::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::PropagationLossModel")
     .SetParent<Object> ()
+    .AddAttribute ("CacheDeterministicLoss",
+                   "Cache, for each pair of static nodes, the reception power given by the leading deterministic models "
+                   "of the chain. Their parameters must be changed through their setters once the simulation has started.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PropagationLossModel::m_cacheDeterministicLoss),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
 
 PropagationLossModel::PropagationLossModel ()
-  : m_next (0)
+  : m_next (0),
+    m_cacheDeterministicLoss (false),
+    m_parametersStamp (0),
+    m_lossCacheStamp (0)
 {
 }
 
@@ -58,6 +73,31 @@ void
 PropagationLossModel::SetNext (Ptr<PropagationLossModel> next)
 {
   m_next = next;
+  NotifyParametersChanged ();
+}
+
+void
+PropagationLossModel::NotifyParametersChanged (void)
+{
+  m_parametersStamp = ++g_lastParametersStamp;
+}
+
+void
+PropagationLossModel::DoDispose (void)
+{
+  for (std::map<uint32_t, TrackedMobility>::iterator i = m_trackedMobility.begin (); i != m_trackedMobility.end (); i++)
+    {
+      i->second.mobility->TraceDisconnectWithoutContext ("CourseChange", MakeCallback (&PropagationLossModel::CourseChanged, this));
+    }
+  m_trackedMobility.clear ();
+  m_lossCache.clear ();
+  Object::DoDispose ();
+}
+
+bool
+PropagationLossModel::IsDeterministic (void) const
+{
+  return false;
 }
 
 double
@@ -65,6 +105,25 @@ PropagationLossModel::CalcRxPower (double txPowerDbm,
                                    Ptr<MobilityModel> a,
                                    Ptr<MobilityModel> b) const
 {
+  if (m_cacheDeterministicLoss && IsDeterministic ())
+    {
+      // Leading deterministic models (cached) and the stochastic rest of the chain. Any change of
+      // the former gives a newer stamp than the one the cache was filled with
+      Ptr<PropagationLossModel> end = m_next;
+      uint32_t chainStamp = m_parametersStamp;
+      while (end != 0 && end->IsDeterministic ())
+        {
+          chainStamp = std::max (chainStamp, end->m_parametersStamp);
+          end = end->m_next;
+        }
+      double rxPowerDbm = CalcDeterministicRxPower (txPowerDbm, a, b, end, chainStamp);
+      if (end != 0)
+        {
+          rxPowerDbm = end->CalcRxPower (rxPowerDbm, a, b);
+        }
+      return rxPowerDbm;
+    }
+
   double self = DoCalcRxPower (txPowerDbm, a, b);
 
   if (m_next != 0)
@@ -74,6 +133,122 @@ PropagationLossModel::CalcRxPower (double txPowerDbm,
   return self;
 }
 
+double
+PropagationLossModel::CalcInterferenceRxPower (double txPowerDbm,
+                                               Ptr<MobilityModel> a,
+                                               Ptr<MobilityModel> b) const
+{
+  if (m_cacheDeterministicLoss && IsDeterministic ())
+    {
+      Ptr<PropagationLossModel> end = m_next;
+      uint32_t chainStamp = m_parametersStamp;
+      while (end != 0 && end->IsDeterministic ())
+        {
+          chainStamp = std::max (chainStamp, end->m_parametersStamp);
+          end = end->m_next;
+        }
+      double rxPowerDbm = CalcDeterministicRxPower (txPowerDbm, a, b, end, chainStamp);
+      if (end != 0)
+        {
+          rxPowerDbm = end->CalcInterferenceRxPower (rxPowerDbm, a, b);
+        }
+      return rxPowerDbm;
+    }
+
+  double self = DoCalcInterferenceRxPower (txPowerDbm, a, b);
+
+  if (m_next != 0)
+    {
+      self = m_next->CalcInterferenceRxPower (self, a, b);
+    }
+  return self;
+}
+
+double
+PropagationLossModel::DoCalcInterferenceRxPower (double txPowerDbm,
+                                                 Ptr<MobilityModel> a,
+                                                 Ptr<MobilityModel> b) const
+{
+  return DoCalcRxPower (txPowerDbm, a, b);
+}
+
+double
+PropagationLossModel::CalcDeterministicRxPower (double txPowerDbm,
+                                                Ptr<MobilityModel> a,
+                                                Ptr<MobilityModel> b,
+                                                Ptr<PropagationLossModel> end,
+                                                uint32_t chainStamp) const
+{
+  if (chainStamp != m_lossCacheStamp)
+    {
+      m_lossCache.clear ();
+      m_lossCacheStamp = chainStamp;
+    }
+
+  // Links are identified by the IDs of their nodes. Moving nodes do not report a CourseChange while
+  // they follow their course, hence only static nodes are cached
+  Ptr<Node> nodeA = a->GetObject<Node> ();
+  Ptr<Node> nodeB = b->GetObject<Node> ();
+  Vector va = a->GetVelocity ();
+  Vector vb = b->GetVelocity ();
+  bool isStatic = nodeA != 0 && nodeB != 0
+    && va.x == 0 && va.y == 0 && va.z == 0 && vb.x == 0 && vb.y == 0 && vb.z == 0;
+
+  LinkKey link;
+  if (isStatic)
+    {
+      link = LinkKey (nodeA->GetId (), nodeB->GetId ());
+      std::map<uint32_t, TrackedMobility>::const_iterator tx = m_trackedMobility.find (link.first);
+      std::map<uint32_t, TrackedMobility>::const_iterator rx = m_trackedMobility.find (link.second);
+      if (tx != m_trackedMobility.end () && rx != m_trackedMobility.end ())
+        {
+          std::map<LinkKey, CachedLoss>::const_iterator cached = m_lossCache.find (link);
+          if (cached != m_lossCache.end ()
+              && cached->second.txPowerDbm == txPowerDbm
+              && cached->second.txVersion == tx->second.version
+              && cached->second.rxVersion == rx->second.version)
+            {
+              return cached->second.rxPowerDbm;
+            }
+        }
+    }
+
+  double rxPowerDbm = txPowerDbm;
+  for (const PropagationLossModel *model = this; model != PeekPointer (end); model = PeekPointer (model->m_next))
+    {
+      rxPowerDbm = model->DoCalcRxPower (rxPowerDbm, a, b);
+    }
+
+  if (isStatic)
+    {
+      PropagationLossModel *self = const_cast<PropagationLossModel *> (this);
+      TrackedMobility tracked;
+      tracked.version = 0;
+      tracked.mobility = a;
+      if (m_trackedMobility.insert (std::make_pair (link.first, tracked)).second)
+        {
+          a->TraceConnectWithoutContext ("CourseChange", MakeCallback (&PropagationLossModel::CourseChanged, self));
+        }
+      tracked.mobility = b;
+      if (m_trackedMobility.insert (std::make_pair (link.second, tracked)).second)
+        {
+          b->TraceConnectWithoutContext ("CourseChange", MakeCallback (&PropagationLossModel::CourseChanged, self));
+        }
+      CachedLoss &entry = m_lossCache[link];
+      entry.txPowerDbm = txPowerDbm;
+      entry.rxPowerDbm = rxPowerDbm;
+      entry.txVersion = m_trackedMobility[link.first].version;
+      entry.rxVersion = m_trackedMobility[link.second].version;
+    }
+  return rxPowerDbm;
+}
+
+void
+PropagationLossModel::CourseChanged (Ptr<const MobilityModel> mobility)
+{
+  m_trackedMobility[mobility->GetObject<Node> ()->GetId ()].version++;
+}
+
 // ------------------------------------------------------------------------- //
 
 NS_OBJECT_ENSURE_REGISTERED (RandomPropagationLossModel);
@@ -148,6 +323,7 @@ void
 FriisPropagationLossModel::SetSystemLoss (double systemLoss)
 {
   m_systemLoss = systemLoss;
+  NotifyParametersChanged ();
 }
 double
 FriisPropagationLossModel::GetSystemLoss (void) const
@@ -158,6 +334,7 @@ void
 FriisPropagationLossModel::SetMinDistance (double minDistance)
 {
   m_minDistance = minDistance;
+  NotifyParametersChanged ();
 }
 double
 FriisPropagationLossModel::GetMinDistance (void) const
@@ -168,11 +345,13 @@ void
 FriisPropagationLossModel::SetLambda (double frequency, double speed)
 {
   m_lambda = speed / frequency;
+  NotifyParametersChanged ();
 }
 void
 FriisPropagationLossModel::SetLambda (double lambda)
 {
   m_lambda = lambda;
+  NotifyParametersChanged ();
 }
 double
 FriisPropagationLossModel::GetLambda (void) const
@@ -194,6 +373,12 @@ FriisPropagationLossModel::DbmFromW (double w) const
   return dbm;
 }
 
+bool
+FriisPropagationLossModel::IsDeterministic (void) const
+{
+  return true;
+}
+
 double 
 FriisPropagationLossModel::DoCalcRxPower (double txPowerDbm,
                                           Ptr<MobilityModel> a,
@@ -284,6 +469,7 @@ void
 TwoRayGroundPropagationLossModel::SetSystemLoss (double systemLoss)
 {
   m_systemLoss = systemLoss;
+  NotifyParametersChanged ();
 }
 double
 TwoRayGroundPropagationLossModel::GetSystemLoss (void) const
@@ -294,6 +480,7 @@ void
 TwoRayGroundPropagationLossModel::SetMinDistance (double minDistance)
 {
   m_minDistance = minDistance;
+  NotifyParametersChanged ();
 }
 double
 TwoRayGroundPropagationLossModel::GetMinDistance (void) const
@@ -304,16 +491,19 @@ void
 TwoRayGroundPropagationLossModel::SetHeightAboveZ (double heightAboveZ)
 {
   m_heightAboveZ = heightAboveZ;
+  NotifyParametersChanged ();
 }
 void 
 TwoRayGroundPropagationLossModel::SetLambda (double frequency, double speed)
 {
   m_lambda = speed / frequency;
+  NotifyParametersChanged ();
 }
 void 
 TwoRayGroundPropagationLossModel::SetLambda (double lambda)
 {
   m_lambda = lambda;
+  NotifyParametersChanged ();
 }
 double 
 TwoRayGroundPropagationLossModel::GetLambda (void) const
@@ -335,6 +525,12 @@ TwoRayGroundPropagationLossModel::DbmFromW (double w) const
   return dbm;
 }
 
+bool
+TwoRayGroundPropagationLossModel::IsDeterministic (void) const
+{
+  return true;
+}
+
 double 
 TwoRayGroundPropagationLossModel::DoCalcRxPower (double txPowerDbm,
                                                  Ptr<MobilityModel> a,
@@ -423,17 +619,20 @@ LogDistancePropagationLossModel::GetTypeId (void)
     .AddAttribute ("Exponent",
                    "The exponent of the Path Loss propagation model",
                    DoubleValue (3.0),
-                   MakeDoubleAccessor (&LogDistancePropagationLossModel::m_exponent),
+                   MakeDoubleAccessor (&LogDistancePropagationLossModel::SetPathLossExponent,
+                                       &LogDistancePropagationLossModel::GetPathLossExponent),
                    MakeDoubleChecker<double> ())
     .AddAttribute ("ReferenceDistance",
                    "The distance at which the reference loss is calculated (m)",
                    DoubleValue (1.0),
-                   MakeDoubleAccessor (&LogDistancePropagationLossModel::m_referenceDistance),
+                   MakeDoubleAccessor (&LogDistancePropagationLossModel::SetReferenceDistance,
+                                       &LogDistancePropagationLossModel::GetReferenceDistance),
                    MakeDoubleChecker<double> ())
     .AddAttribute ("ReferenceLoss",
                    "The reference loss at reference distance (dB). (Default is Friis at 1m with 5.15 GHz)",
                    DoubleValue (46.6777),
-                   MakeDoubleAccessor (&LogDistancePropagationLossModel::m_referenceLoss),
+                   MakeDoubleAccessor (&LogDistancePropagationLossModel::SetReferenceLoss,
+                                       &LogDistancePropagationLossModel::GetReferenceLoss),
                    MakeDoubleChecker<double> ())
   ;
   return tid;
@@ -448,12 +647,36 @@ void
 LogDistancePropagationLossModel::SetPathLossExponent (double n)
 {
   m_exponent = n;
+  NotifyParametersChanged ();
 }
 void
 LogDistancePropagationLossModel::SetReference (double referenceDistance, double referenceLoss)
 {
   m_referenceDistance = referenceDistance;
   m_referenceLoss = referenceLoss;
+  NotifyParametersChanged ();
+}
+void
+LogDistancePropagationLossModel::SetReferenceDistance (double referenceDistance)
+{
+  m_referenceDistance = referenceDistance;
+  NotifyParametersChanged ();
+}
+double
+LogDistancePropagationLossModel::GetReferenceDistance (void) const
+{
+  return m_referenceDistance;
+}
+void
+LogDistancePropagationLossModel::SetReferenceLoss (double referenceLoss)
+{
+  m_referenceLoss = referenceLoss;
+  NotifyParametersChanged ();
+}
+double
+LogDistancePropagationLossModel::GetReferenceLoss (void) const
+{
+  return m_referenceLoss;
 }
 double
 LogDistancePropagationLossModel::GetPathLossExponent (void) const
@@ -461,6 +684,12 @@ LogDistancePropagationLossModel::GetPathLossExponent (void) const
   return m_exponent;
 }
 
+bool
+LogDistancePropagationLossModel::IsDeterministic (void) const
+{
+  return true;
+}
+
 double
 LogDistancePropagationLossModel::DoCalcRxPower (double txPowerDbm,
                                                 Ptr<MobilityModel> a,
@@ -550,6 +779,12 @@ ThreeLogDistancePropagationLossModel::ThreeLogDistancePropagationLossModel ()
 {
 }
 
+bool
+ThreeLogDistancePropagationLossModel::IsDeterministic (void) const
+{
+  return true;
+}
+
 double 
 ThreeLogDistancePropagationLossModel::DoCalcRxPower (double txPowerDbm,
                                                      Ptr<MobilityModel> a,
@@ -699,7 +934,8 @@ FixedRssLossModel::GetTypeId (void)
     .AddConstructor<FixedRssLossModel> ()
     .AddAttribute ("Rss", "The fixed receiver Rss.",
                    DoubleValue (-150.0),
-                   MakeDoubleAccessor (&FixedRssLossModel::m_rss),
+                   MakeDoubleAccessor (&FixedRssLossModel::SetRss,
+                                       &FixedRssLossModel::GetRss),
                    MakeDoubleChecker<double> ())
   ;
   return tid;
@@ -717,6 +953,19 @@ void
 FixedRssLossModel::SetRss (double rss)
 {
   m_rss = rss;
+  NotifyParametersChanged ();
+}
+
+double
+FixedRssLossModel::GetRss (void) const
+{
+  return m_rss;
+}
+
+bool
+FixedRssLossModel::IsDeterministic (void) const
+{
+  return true;
 }
 
 double
@@ -818,12 +1067,14 @@ RangePropagationLossModel::GetTypeId (void)
     .AddAttribute ("FirstRangeDistance",
                    "XXX",
                    DoubleValue (20),
-                   MakeDoubleAccessor (&RangePropagationLossModel::m_firstRangeDistance),
+                   MakeDoubleAccessor (&RangePropagationLossModel::SetFirstRangeDistance,
+                                       &RangePropagationLossModel::GetFirstRangeDistance),
                    MakeDoubleChecker<double> ())
     .AddAttribute ("SecondRangeDistance",
                    "XXX",
                    DoubleValue (40),
-                   MakeDoubleAccessor (&RangePropagationLossModel::m_secondRangeDistance),
+                   MakeDoubleAccessor (&RangePropagationLossModel::SetSecondRangeDistance,
+                                       &RangePropagationLossModel::GetSecondRangeDistance),
                    MakeDoubleChecker<double> ())
     ////End David/Ramón
   ;
@@ -840,6 +1091,38 @@ RangePropagationLossModel::~RangePropagationLossModel ()
 	NS_LOG_FUNCTION_NOARGS();
 }
 
+void
+RangePropagationLossModel::SetFirstRangeDistance (double distance)
+{
+  m_firstRangeDistance = distance;
+  NotifyParametersChanged ();
+}
+
+double
+RangePropagationLossModel::GetFirstRangeDistance (void) const
+{
+  return m_firstRangeDistance;
+}
+
+void
+RangePropagationLossModel::SetSecondRangeDistance (double distance)
+{
+  m_secondRangeDistance = distance;
+  NotifyParametersChanged ();
+}
+
+double
+RangePropagationLossModel::GetSecondRangeDistance (void) const
+{
+  return m_secondRangeDistance;
+}
+
+bool
+RangePropagationLossModel::IsDeterministic (void) const
+{
+  return true;
+}
+
 double
 RangePropagationLossModel::DoCalcRxPower (double txPowerDbm,
                                           Ptr<MobilityModel> a,
@@ -879,20 +1162,26 @@ SimplePropagationLossModel::GetTypeId(void) {
 	.AddAttribute("MaxDistance",
 			"The distance from which all packets will be errored (FER = 1)",
 			DoubleValue(15.0),
-			MakeDoubleAccessor(&SimplePropagationLossModel::m_maxDistance),
+			MakeDoubleAccessor(&SimplePropagationLossModel::SetMaxDistance, &SimplePropagationLossModel::GetMaxDistance),
 			MakeDoubleChecker<double> ())
 
 	.AddAttribute("Alpha", "Determines the distance (in meters) from which the transmission is set over an error-prone channel",
 			DoubleValue(0.5),
-			MakeDoubleAccessor(&SimplePropagationLossModel::m_alpha),
+			MakeDoubleAccessor(&SimplePropagationLossModel::SetAlpha, &SimplePropagationLossModel::GetAlpha),
 			MakeDoubleChecker<double> ())
 
 	.AddAttribute("Beta", "Exponential parameter (1 for a linear behavior)",
 			DoubleValue(1.0),
-			MakeDoubleAccessor(&SimplePropagationLossModel::m_beta),
+			MakeDoubleAccessor(&SimplePropagationLossModel::SetBeta, &SimplePropagationLossModel::GetBeta),
 			MakeDoubleChecker<double> ())
 
-	.AddAttribute ("RanVar", "Random variable which determine a packet to be successfully received or not.",
+	.AddAttribute ("DecideFrames", "If true (legacy behavior), every frame is decided by the propagation model, and the errored ones are "
+			"received at -10000 dBm; otherwise, the decision is taken by the error model (see GetErrorModel) which must be set at the PHY layer",
+			BooleanValue (false),
+			MakeBooleanAccessor (&SimplePropagationLossModel::m_decideFrames),
+			MakeBooleanChecker ())
+
+	.AddAttribute ("RanVar", "Random variable which determine a packet to be successfully received or not (only if DecideFrames is enabled).",
 			RandomVariableValue (UniformVariable (0.0, 1.0)),
 			MakeRandomVariableAccessor (&SimplePropagationLossModel::m_ranvar),
 			MakeRandomVariableChecker ())
@@ -902,8 +1191,20 @@ SimplePropagationLossModel::GetTypeId(void) {
 }
 
 SimplePropagationLossModel::SimplePropagationLossModel ()
+	: m_maxDistance (15.0),
+	  m_alpha (0.5),
+	  m_beta (1.0),
+	  m_decideFrames (false),
+	  m_nodes (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
+  m_ferDenominator = 1 - pow (m_alpha, m_beta);
+
+  //Every frame class is error prone (a frame beyond the range is lost, whatever its type)
+  m_error = CreateObject<MatrixErrorModel> ();
+  m_error->SetDefaultFer (0.0);
+  m_error->SetAttribute ("ErrorProneFrames", UintegerValue (MatrixErrorModel::FRAME_DATA | MatrixErrorModel::FRAME_TCP_ACK |
+		  MatrixErrorModel::FRAME_ARP | MatrixErrorModel::FRAME_MAC_ACK | MatrixErrorModel::FRAME_CONTROL));
 }
 
 SimplePropagationLossModel::~SimplePropagationLossModel ()
@@ -921,6 +1222,8 @@ void SimplePropagationLossModel::SetAlpha(float alpha)
 {
 	NS_LOG_FUNCTION_NOARGS ();
 	m_alpha = alpha;
+	m_ferDenominator = 1 - pow (m_alpha, m_beta);
+	m_linkFer.assign (m_linkFer.size (), -1);
 }
 
 float SimplePropagationLossModel::GetBeta() const
@@ -933,6 +1236,8 @@ void SimplePropagationLossModel::SetBeta(float beta)
 {
 	NS_LOG_FUNCTION_NOARGS ();
 	m_beta = beta;
+	m_ferDenominator = 1 - pow (m_alpha, m_beta);
+	m_linkFer.assign (m_linkFer.size (), -1);
 }
 
 float SimplePropagationLossModel::GetMaxDistance(void) const
@@ -945,13 +1250,11 @@ void SimplePropagationLossModel::SetMaxDistance(float maxDistance)
 {
 	NS_LOG_FUNCTION_NOARGS ();
 	m_maxDistance = maxDistance;
+	m_linkFer.assign (m_linkFer.size (), -1);
 }
 
-double SimplePropagationLossModel::DoCalcRxPower(double txPowerDbm, Ptr<MobilityModel> a,
-		Ptr<MobilityModel> b) const
+double SimplePropagationLossModel::GetFer (double distance) const
 {
-	NS_LOG_FUNCTION(this);
-	double distance = a->GetDistanceFrom (b);
 	double fer;
 
 	NS_ASSERT (distance >= 0);
@@ -961,7 +1264,7 @@ double SimplePropagationLossModel::DoCalcRxPower(double txPowerDbm, Ptr<Mobility
 	}
 	else if (distance < m_maxDistance)
 	{
-		fer = 1 - ((1 - pow((distance / m_maxDistance), m_beta))/ (1 - pow(m_alpha, m_beta)));
+		fer = 1 - ((1 - pow((distance / m_maxDistance), m_beta)) / m_ferDenominator);
 	}
 	else
 	{
@@ -970,8 +1273,63 @@ double SimplePropagationLossModel::DoCalcRxPower(double txPowerDbm, Ptr<Mobility
 
 	NS_ASSERT(fer<=1);
 	NS_LOG_DEBUG ("FER =" << fer << " Distance = " << distance << " Max_distance = " << m_maxDistance << " Alpha = " << m_alpha << " Beta = " << m_beta);
+	return fer;
+}
+
+double SimplePropagationLossModel::DoCalcRxPower(double txPowerDbm, Ptr<MobilityModel> a,
+		Ptr<MobilityModel> b) const
+{
+	NS_LOG_FUNCTION(this);
+	Ptr<Node> txNode = a->GetObject<Node> ();
+	Ptr<Node> rxNode = b->GetObject<Node> ();
+	double fer;
 
-	if(m_ranvar.GetValue() <= fer)
+	if (txNode == 0 || rxNode == 0)
+	{
+		NS_LOG_LOGIC ("Mobility model not aggregated to a node, FER cannot be cached (nor decided by the error model)");
+		fer = GetFer (a->GetDistanceFrom (b));
+	}
+	else
+	{
+		u_int32_t tx = txNode->GetId ();
+		u_int32_t rx = rxNode->GetId ();
+
+		//Grow the cache if needed (the links already calculated are kept)
+		if (tx >= m_nodes || rx >= m_nodes)
+		{
+			u_int32_t nodes = std::max (tx, rx) + 1;
+			std::vector<double> linkFer (nodes * nodes, -1);
+			for (u_int32_t i = 0; i < m_nodes; i++)
+			{
+				for (u_int32_t j = 0; j < m_nodes; j++)
+				{
+					linkFer[i * nodes + j] = m_linkFer[i * m_nodes + j];
+				}
+			}
+			m_linkFer.swap (linkFer);
+			m_nodes = nodes;
+		}
+
+		//Calculate the FER only if the link is not up to date (first frame or any of the nodes has moved)
+		if (m_linkFer[tx * m_nodes + rx] < 0)
+		{
+			SimplePropagationLossModel *self = const_cast<SimplePropagationLossModel *> (this);
+			if (m_trackedNodes.insert (std::make_pair (tx, a)).second)
+				a->TraceConnectWithoutContext ("CourseChange", MakeCallback (&SimplePropagationLossModel::CourseChanged, self));
+			if (m_trackedNodes.insert (std::make_pair (rx, b)).second)
+				b->TraceConnectWithoutContext ("CourseChange", MakeCallback (&SimplePropagationLossModel::CourseChanged, self));
+
+			m_linkFer[tx * m_nodes + rx] = GetFer (a->GetDistanceFrom (b));
+			m_error->SetFer (tx, rx, m_linkFer[tx * m_nodes + rx]);
+		}
+		fer = m_linkFer[tx * m_nodes + rx];
+	}
+
+	//The error model set at the PHY layer decides the frame
+	if (!m_decideFrames)
+		return txPowerDbm;
+
+	if (m_ranvar.GetValue() <= fer)
 	{
 		NS_LOG_DEBUG("Frame error");
 		return -10000;
@@ -983,5 +1341,46 @@ double SimplePropagationLossModel::DoCalcRxPower(double txPowerDbm, Ptr<Mobility
 	}
 }
 
+double SimplePropagationLossModel::DoCalcInterferenceRxPower(double txPowerDbm, Ptr<MobilityModel> a,
+		Ptr<MobilityModel> b) const
+{
+	NS_LOG_FUNCTION(this);
+	return txPowerDbm;
+}
+
+void SimplePropagationLossModel::DoDispose (void)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+	std::map<u_int32_t, Ptr<MobilityModel> >::iterator it;
+
+	for (it = m_trackedNodes.begin (); it != m_trackedNodes.end (); it++)
+	{
+		it->second->TraceDisconnectWithoutContext ("CourseChange", MakeCallback (&SimplePropagationLossModel::CourseChanged, this));
+	}
+	m_trackedNodes.clear ();
+	m_linkFer.clear ();
+	m_nodes = 0;
+	m_error = 0;
+	PropagationLossModel::DoDispose ();
+}
+
+void SimplePropagationLossModel::CourseChanged (Ptr<const MobilityModel> model)
+{
+	NS_LOG_FUNCTION (model);
+	Ptr<Node> node = model->GetObject<Node> ();
+	u_int32_t i, id;
+
+	if (node == 0 || node->GetId () >= m_nodes)
+		return;
+
+	//Every link with this node at any of the ends is out of date
+	id = node->GetId ();
+	for (i = 0; i < m_nodes; i++)
+	{
+		m_linkFer[id * m_nodes + i] = -1;
+		m_linkFer[i * m_nodes + id] = -1;
+	}
+}
+
 
 } // namespace ns3
@@ -27,7 +27,9 @@
 
 #include "ns3/object.h"
 #include "ns3/random-variable.h"
+#include "ns3/error-model.h"
 #include <map>
+#include <vector>
 
 namespace ns3 {
 
@@ -45,6 +47,13 @@ class MobilityModel;
  *
  * Calculate the receive power (dbm) from a transmit power (dbm)
  * and a mobility model for the source and destination positions.
+ *
+ * When the CacheDeterministicLoss attribute is enabled, the result of the
+ * leading deterministic models of a chain (see IsDeterministic) is cached
+ * for each pair of static nodes, and it is calculated again only after one
+ * of them reports a CourseChange, or after a parameter of those models is
+ * changed (see NotifyParametersChanged). The remaining (stochastic) models
+ * of the chain are applied on every call.
  */
 class PropagationLossModel : public Object
 {
@@ -73,14 +82,85 @@ public:
   double CalcRxPower (double txPowerDbm,
                       Ptr<MobilityModel> a,
                       Ptr<MobilityModel> b) const;
+
+  /**
+   * \param txPowerDbm current transmission power (in dBm)
+   * \param a the mobility model of the source
+   * \param b the mobility model of the destination
+   * \returns the reception power of a signal which is only heard as interference (i.e. from
+   *          an adjacent channel). It is calculated along the chain as CalcRxPower does, but
+   *          the models which keep a per-link channel process do not move it forward.
+   */
+  double CalcInterferenceRxPower (double txPowerDbm,
+                                  Ptr<MobilityModel> a,
+                                  Ptr<MobilityModel> b) const;
+
+  /**
+   * \returns true if the reception power calculated by this model only depends
+   *          on the transmission power and on the positions of the nodes, so
+   *          that it can be cached. False by default.
+   */
+  virtual bool IsDeterministic (void) const;
+protected:
+  virtual void DoDispose (void);
+  /**
+   * Invalidate the cached losses of the chains this model belongs to. To be
+   * called by the deterministic models whenever one of their parameters changes.
+   */
+  void NotifyParametersChanged (void);
 private:
   PropagationLossModel (const PropagationLossModel &o);
   PropagationLossModel &operator = (const PropagationLossModel &o);
   virtual double DoCalcRxPower (double txPowerDbm,
                                 Ptr<MobilityModel> a,
                                 Ptr<MobilityModel> b) const = 0;
+  /**
+   * To be overridden by the models whose DoCalcRxPower moves a per-link channel process
+   * forward (i.e. one step per received frame). By default, DoCalcRxPower.
+   */
+  virtual double DoCalcInterferenceRxPower (double txPowerDbm,
+                                            Ptr<MobilityModel> a,
+                                            Ptr<MobilityModel> b) const;
+
+  /**
+   * Apply the models from this one up to (not including) the given one, looking
+   * the result up in the cache first.
+   */
+  double CalcDeterministicRxPower (double txPowerDbm,
+                                   Ptr<MobilityModel> a,
+                                   Ptr<MobilityModel> b,
+                                   Ptr<PropagationLossModel> end,
+                                   uint32_t chainStamp) const;
+  /**
+   * CourseChange trace sink: the cached links of the node are no longer valid
+   */
+  void CourseChanged (Ptr<const MobilityModel> mobility);
+
+  struct CachedLoss
+  {
+    double txPowerDbm;
+    double rxPowerDbm;
+    uint32_t txVersion;
+    uint32_t rxVersion;
+  };
+  struct TrackedMobility
+  {
+    Ptr<MobilityModel> mobility;
+    // Number of course changes
+    uint32_t version;
+  };
+  // Node IDs of the transmitter and the receiver
+  typedef std::pair<uint32_t, uint32_t> LinkKey;
 
   Ptr<PropagationLossModel> m_next;
+  bool m_cacheDeterministicLoss;
+  // Stamp of the last change of the parameters of this model (or of its next model)
+  uint32_t m_parametersStamp;
+  mutable std::map<LinkKey, CachedLoss> m_lossCache;
+  // Latest parameters stamp of the deterministic models the cached losses were calculated with
+  mutable uint32_t m_lossCacheStamp;
+  // Mobility models whose CourseChange is connected, indexed by node ID
+  mutable std::map<uint32_t, TrackedMobility> m_trackedMobility;
 };
 
 /**
@@ -189,6 +269,8 @@ public:
    */
   double GetSystemLoss (void) const;
 
+  virtual bool IsDeterministic (void) const;
+
 private:
   FriisPropagationLossModel (const FriisPropagationLossModel &o);
   FriisPropagationLossModel & operator = (const FriisPropagationLossModel &o);
@@ -279,6 +361,8 @@ public:
    */
   void SetHeightAboveZ (double heightAboveZ);
 
+  virtual bool IsDeterministic (void) const;
+
 private:
   TwoRayGroundPropagationLossModel (const TwoRayGroundPropagationLossModel &o);
   TwoRayGroundPropagationLossModel & operator = (const TwoRayGroundPropagationLossModel &o);
@@ -332,6 +416,24 @@ public:
   double GetPathLossExponent (void) const;
 
   void SetReference (double referenceDistance, double referenceLoss);
+  /**
+   * \param referenceDistance the distance at which the reference loss is calculated (m)
+   */
+  void SetReferenceDistance (double referenceDistance);
+  /**
+   * \returns the distance at which the reference loss is calculated (m)
+   */
+  double GetReferenceDistance (void) const;
+  /**
+   * \param referenceLoss the loss at the reference distance (dB)
+   */
+  void SetReferenceLoss (double referenceLoss);
+  /**
+   * \returns the loss at the reference distance (dB)
+   */
+  double GetReferenceLoss (void) const;
+
+  virtual bool IsDeterministic (void) const;
 
 private:
   LogDistancePropagationLossModel (const LogDistancePropagationLossModel &o);
@@ -394,6 +496,8 @@ public:
 
   // Parameters are all accessible via attributes.
 
+  virtual bool IsDeterministic (void) const;
+
 private:
   ThreeLogDistancePropagationLossModel (const ThreeLogDistancePropagationLossModel& o);
   ThreeLogDistancePropagationLossModel& operator= (const ThreeLogDistancePropagationLossModel& o);
@@ -487,6 +591,12 @@ public:
    * Set the received signal strength (RSS) in dBm.
    */
   void SetRss (double rss);
+  /**
+   * \returns the received signal strength (RSS) in dBm
+   */
+  double GetRss (void) const;
+
+  virtual bool IsDeterministic (void) const;
 
 private:
   FixedRssLossModel (const FixedRssLossModel &o);
@@ -557,6 +667,19 @@ public:
   ////David/Ramón
   virtual ~RangePropagationLossModel ();
 
+  /**
+   * \param distance Receivers up to this distance (m) get the transmission power
+   */
+  void SetFirstRangeDistance (double distance);
+  double GetFirstRangeDistance (void) const;
+  /**
+   * \param distance Receivers up to this distance (m) get a 130 dB loss; beyond it, -1000 dBm
+   */
+  void SetSecondRangeDistance (double distance);
+  double GetSecondRangeDistance (void) const;
+
+  virtual bool IsDeterministic (void) const;
+
 private:
   RangePropagationLossModel (const RangePropagationLossModel& o);
   RangePropagationLossModel& operator= (const RangePropagationLossModel& o);
@@ -592,8 +715,11 @@ private:
  *			   |
  *			   \		  	   0,					  if 	 d_max < x
  *
- * Receivers beyond MaxRange receive at power -1000 dBm (effectively zero).
+ * The propagation model does not attenuate the signal; the FER of each link is computed once (and again only after any of its nodes
+ * reports a CourseChange) and stored into a MatrixErrorModel, which takes the frame-level decision (see GetErrorModel).
  *
+ * Scenarios whose PHY layer already holds another error model (i.e. BEAR or HMM) can keep the legacy behavior by means of the
+ * DecideFrames attribute: every frame is then decided here, against the cached FER, and the errored ones are received at -10000 dBm.
  *
  */
 
@@ -631,17 +757,49 @@ public:
 	 */
 	float GetMaxDistance(void) const;
 
+	/**
+	 * \param distance Distance between the transmitter and the receiver
+	 * \returns The FER given by the model at such distance
+	 */
+	double GetFer (double distance) const;
+
+	/**
+	 * \returns The error model which decides the frame errors, according to the FER of each link. It must be set at the PHY layer
+	 * (unless DecideFrames is enabled)
+	 */
+	inline Ptr<MatrixErrorModel> GetErrorModel () {return m_error;}
+
 private:
 	SimplePropagationLossModel (const SimplePropagationLossModel& o);
 	SimplePropagationLossModel & operator=(const SimplePropagationLossModel& o);
 	virtual double DoCalcRxPower(double txPowerDbm, Ptr<MobilityModel> a,
 			Ptr<MobilityModel> b) const;
+	/**
+	 * The legacy per-frame decision (DecideFrames) is not drawn for the frames which are only heard as interference
+	 */
+	virtual double DoCalcInterferenceRxPower(double txPowerDbm, Ptr<MobilityModel> a,
+			Ptr<MobilityModel> b) const;
+	virtual void DoDispose (void);
+
+	/**
+	 * CourseChange trace sink: the FER of every link of the node must be calculated again
+	 */
+	void CourseChanged (Ptr<const MobilityModel> model);
 
 	//class specific parameters
 	float m_maxDistance;
 	float m_alpha;
 	float m_beta;
-	RandomVariable m_ranvar;
+	double m_ferDenominator;		//1 - alpha^beta
+	bool m_decideFrames;			//Legacy mode: the errored frames are received at -10000 dBm, instead of being decided by m_error
+	RandomVariable m_ranvar;		//Only used in the legacy mode
+	Ptr<MatrixErrorModel> m_error;
+
+	//FER cache (tx * m_nodes + rx); a negative value means that the link is not up to date
+	mutable std::vector<double> m_linkFer;
+	mutable u_int32_t m_nodes;
+	//Mobility models whose CourseChange is connected, indexed by node ID
+	mutable std::map<u_int32_t, Ptr<MobilityModel> > m_trackedNodes;
 };
 
 
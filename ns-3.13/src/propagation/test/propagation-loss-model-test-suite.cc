@@ -21,9 +21,11 @@
 #include "ns3/test.h"
 #include "ns3/config.h"
 #include "ns3/double.h"
+#include "ns3/boolean.h"
 #include "ns3/propagation-loss-model.h"
 #include "ns3/constant-position-mobility-model.h"
 #include "ns3/simulator.h"
+#include "ns3/node.h"
 
 using namespace ns3;
 
@@ -434,6 +436,189 @@ RangePropagationLossModelTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+class SimplePropagationLossModelTestCase : public TestCase
+{
+public:
+  SimplePropagationLossModelTestCase ();
+  virtual ~SimplePropagationLossModelTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SimplePropagationLossModelTestCase::SimplePropagationLossModelTestCase ()
+  : TestCase ("Test SimplePropagationLossModel FER cache")
+{
+}
+
+SimplePropagationLossModelTestCase::~SimplePropagationLossModelTestCase ()
+{
+}
+
+void
+SimplePropagationLossModelTestCase::DoRun (void)
+{
+  Ptr<Node> nodeA = CreateObject<Node> ();
+  Ptr<Node> nodeB = CreateObject<Node> ();
+  Ptr<MobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<MobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  nodeA->AggregateObject (a);
+  nodeB->AggregateObject (b);
+  a->SetPosition (Vector (0,0,0));
+  b->SetPosition (Vector (5,0,0));  // below alpha * MaxDistance
+
+  Ptr<SimplePropagationLossModel> lossModel = CreateObject<SimplePropagationLossModel> ();
+  lossModel->SetAttribute ("MaxDistance", DoubleValue (20.0));
+  lossModel->SetAttribute ("Alpha", DoubleValue (0.5));
+  lossModel->SetAttribute ("Beta", DoubleValue (2.0));
+
+  double txPwrdBm = 16.0;
+  double tolerance = 1e-6;
+  // 1 - FER = (1 - (18/20)^2) / (1 - 0.5^2)
+  double fer18 = 1 - (1 - 0.81) / 0.75;
+
+  NS_TEST_EXPECT_MSG_EQ_TOL (lossModel->GetFer (5.0), 0.0, tolerance, "Got unexpected FER");
+  NS_TEST_EXPECT_MSG_EQ_TOL (lossModel->GetFer (18.0), fer18, tolerance, "Got unexpected FER");
+  NS_TEST_EXPECT_MSG_EQ_TOL (lossModel->GetFer (25.0), 1.0, tolerance, "Got unexpected FER");
+
+  // The signal is not attenuated; the FER of the link is handed to the error model
+  NS_TEST_EXPECT_MSG_EQ_TOL (lossModel->CalcRxPower (txPwrdBm, a, b), txPwrdBm, tolerance, "Got unexpected rcv power");
+  NS_TEST_EXPECT_MSG_EQ_TOL (lossModel->GetErrorModel ()->GetFer (nodeA->GetId (), nodeB->GetId ()), 0.0, tolerance, "Got unexpected link FER");
+
+  // The cached FER must be updated after the CourseChange
+  b->SetPosition (Vector (18,0,0));
+  NS_TEST_EXPECT_MSG_EQ_TOL (lossModel->CalcRxPower (txPwrdBm, a, b), txPwrdBm, tolerance, "Got unexpected rcv power");
+  NS_TEST_EXPECT_MSG_EQ_TOL (lossModel->GetErrorModel ()->GetFer (nodeA->GetId (), nodeB->GetId ()), fer18, tolerance,
+                             "Link FER not updated after CourseChange");
+  a->SetPosition (Vector (-10,0,0));
+  lossModel->CalcRxPower (txPwrdBm, a, b);
+  NS_TEST_EXPECT_MSG_EQ_TOL (lossModel->GetErrorModel ()->GetFer (nodeA->GetId (), nodeB->GetId ()), 1.0, tolerance,
+                             "Link FER not updated after CourseChange");
+
+  // Legacy mode: frames are decided by the propagation model, and lost if the FER of the link is at least 0.5
+  Ptr<SimplePropagationLossModel> legacyModel = CreateObject<SimplePropagationLossModel> ();
+  legacyModel->SetAttribute ("MaxDistance", DoubleValue (20.0));
+  legacyModel->SetAttribute ("Alpha", DoubleValue (0.5));
+  legacyModel->SetAttribute ("Beta", DoubleValue (2.0));
+  legacyModel->SetAttribute ("DecideFrames", BooleanValue (true));
+  legacyModel->SetAttribute ("RanVar", RandomVariableValue (ConstantVariable (0.5)));
+
+  a->SetPosition (Vector (0,0,0));
+  b->SetPosition (Vector (5,0,0));
+  NS_TEST_EXPECT_MSG_EQ_TOL (legacyModel->CalcRxPower (txPwrdBm, a, b), txPwrdBm, tolerance, "Got unexpected rcv power");
+
+  // FER = 0.7467 > 0.5, only seen if the FER cached at 5 m is dropped after the CourseChange
+  b->SetPosition (Vector (18,0,0));
+  NS_TEST_EXPECT_MSG_EQ_TOL (legacyModel->CalcRxPower (txPwrdBm, a, b), -10000, tolerance, "FER not updated after CourseChange");
+
+  // The CourseChange sinks are disconnected when the models are disposed
+  lossModel->Dispose ();
+  legacyModel->Dispose ();
+  a->SetPosition (Vector (0,0,0));
+  Simulator::Destroy ();
+}
+
+class DeterministicLossCacheTestCase : public TestCase
+{
+public:
+  DeterministicLossCacheTestCase ();
+  virtual ~DeterministicLossCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DeterministicLossCacheTestCase::DeterministicLossCacheTestCase ()
+  : TestCase ("Test the deterministic loss cache of PropagationLossModel chains")
+{
+}
+
+DeterministicLossCacheTestCase::~DeterministicLossCacheTestCase ()
+{
+}
+
+void
+DeterministicLossCacheTestCase::DoRun (void)
+{
+  // Links are cached by node ID
+  Ptr<MobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0,0,0));
+  CreateObject<Node> ()->AggregateObject (a);
+  Ptr<MobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  b->SetPosition (Vector (100,0,0));
+  CreateObject<Node> ()->AggregateObject (b);
+
+  // Cached chain: LogDistance -> Friis (deterministic) -> Random (constant 3 dB loss, applied on every call)
+  Ptr<LogDistancePropagationLossModel> cached = CreateObject<LogDistancePropagationLossModel> ();
+  cached->SetAttribute ("CacheDeterministicLoss", BooleanValue (true));
+  Ptr<FriisPropagationLossModel> cachedFriis = CreateObject<FriisPropagationLossModel> ();
+  Ptr<RandomPropagationLossModel> cachedRandom = CreateObject<RandomPropagationLossModel> ();
+  cachedRandom->SetAttribute ("Variable", RandomVariableValue (ConstantVariable (3.0)));
+  cached->SetNext (cachedFriis);
+  cachedFriis->SetNext (cachedRandom);
+
+  // Reference chain, with the cache disabled (default)
+  Ptr<LogDistancePropagationLossModel> reference = CreateObject<LogDistancePropagationLossModel> ();
+  Ptr<FriisPropagationLossModel> referenceFriis = CreateObject<FriisPropagationLossModel> ();
+  reference->SetNext (referenceFriis);
+
+  double txPwrdBm = 16.0;
+  double tolerance = 1e-6;
+  double expected = reference->CalcRxPower (txPwrdBm, a, b) - 3.0;
+  NS_TEST_EXPECT_MSG_EQ_TOL (cached->CalcRxPower (txPwrdBm, a, b), expected, tolerance, "Got unexpected rcv power");
+  NS_TEST_EXPECT_MSG_EQ_TOL (cached->CalcRxPower (txPwrdBm, a, b), expected, tolerance, "Got unexpected cached rcv power");
+
+  // A different transmission power is not taken from the cache
+  expected = reference->CalcRxPower (txPwrdBm - 10.0, a, b) - 3.0;
+  NS_TEST_EXPECT_MSG_EQ_TOL (cached->CalcRxPower (txPwrdBm - 10.0, a, b), expected, tolerance, "Got unexpected rcv power");
+
+  // The stochastic tail is still applied
+  cachedRandom->SetAttribute ("Variable", RandomVariableValue (ConstantVariable (5.0)));
+  expected = reference->CalcRxPower (txPwrdBm, a, b) - 5.0;
+  NS_TEST_EXPECT_MSG_EQ_TOL (cached->CalcRxPower (txPwrdBm, a, b), expected, tolerance, "Stochastic model not applied");
+
+  // The cache is invalidated by a CourseChange
+  b->SetPosition (Vector (250,0,0));
+  expected = reference->CalcRxPower (txPwrdBm, a, b) - 5.0;
+  NS_TEST_EXPECT_MSG_EQ_TOL (cached->CalcRxPower (txPwrdBm, a, b), expected, tolerance, "Cache not invalidated after CourseChange");
+
+  // The cache is invalidated when a parameter of the head or of a later deterministic model changes
+  cached->SetPathLossExponent (2.5);
+  reference->SetPathLossExponent (2.5);
+  expected = reference->CalcRxPower (txPwrdBm, a, b) - 5.0;
+  NS_TEST_EXPECT_MSG_EQ_TOL (cached->CalcRxPower (txPwrdBm, a, b), expected, tolerance, "Cache not invalidated after SetPathLossExponent");
+  cachedFriis->SetSystemLoss (2.0);
+  referenceFriis->SetSystemLoss (2.0);
+  expected = reference->CalcRxPower (txPwrdBm, a, b) - 5.0;
+  NS_TEST_EXPECT_MSG_EQ_TOL (cached->CalcRxPower (txPwrdBm, a, b), expected, tolerance, "Cache not invalidated after a change of the next model");
+  cached->SetAttribute ("ReferenceLoss", DoubleValue (40.0));
+  reference->SetAttribute ("ReferenceLoss", DoubleValue (40.0));
+  expected = reference->CalcRxPower (txPwrdBm, a, b) - 5.0;
+  NS_TEST_EXPECT_MSG_EQ_TOL (cached->CalcRxPower (txPwrdBm, a, b), expected, tolerance, "Cache not invalidated after an attribute change");
+
+  // Chained FixedRss and Range models
+  Ptr<FixedRssLossModel> fixed = CreateObject<FixedRssLossModel> ();
+  Ptr<RangePropagationLossModel> range = CreateObject<RangePropagationLossModel> ();
+  fixed->SetAttribute ("CacheDeterministicLoss", BooleanValue (true));
+  fixed->SetNext (range);
+  fixed->SetRss (-60.0);
+  NS_TEST_EXPECT_MSG_EQ_TOL (fixed->CalcRxPower (txPwrdBm, a, b), -1000.0, tolerance, "Receiver out of range");
+  range->SetAttribute ("SecondRangeDistance", DoubleValue (300.0));
+  NS_TEST_EXPECT_MSG_EQ_TOL (fixed->CalcRxPower (txPwrdBm, a, b), -190.0, tolerance, "Cache not invalidated after SecondRangeDistance");
+  fixed->SetRss (-50.0);
+  NS_TEST_EXPECT_MSG_EQ_TOL (fixed->CalcRxPower (txPwrdBm, a, b), -180.0, tolerance, "Cache not invalidated after SetRss");
+
+  // Mobility models without a node are not cached
+  Ptr<MobilityModel> c = CreateObject<ConstantPositionMobilityModel> ();
+  c->SetPosition (Vector (10,0,0));
+  NS_TEST_EXPECT_MSG_EQ_TOL (fixed->CalcRxPower (txPwrdBm, a, c), -50.0, tolerance, "Got unexpected rcv power");
+
+  cached->Dispose ();
+  fixed->Dispose ();
+  b->SetPosition (Vector (100,0,0));
+  Simulator::Destroy ();
+}
+
 class PropagationLossModelsTestSuite : public TestSuite
 {
 public:
@@ -448,6 +633,8 @@ PropagationLossModelsTestSuite::PropagationLossModelsTestSuite ()
   AddTestCase (new LogDistancePropagationLossModelTestCase);
   AddTestCase (new MatrixPropagationLossModelTestCase);
   AddTestCase (new RangePropagationLossModelTestCase);
+  AddTestCase (new SimplePropagationLossModelTestCase);
+  AddTestCase (new DeterministicLossCacheTestCase);
 }
 
 static PropagationLossModelsTestSuite propagationLossModelsTestSuite;
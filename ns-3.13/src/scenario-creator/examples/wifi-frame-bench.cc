@@ -0,0 +1,458 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+
+/*
+ * Frame-level microbenchmark of the wifi transmission and reception path
+ * (YansWifiPhy, MacLow, DcfManager and DcaTxop). N adhoc stations, all
+ * within range of each other, keep their DcaTxop queues saturated with
+ * unicast UDP frames towards the next station. No application, transport
+ * or tracing layers are involved, so that the cost measured is the one of
+ * the per-frame hot path.
+ *
+ * For each error model (YANS and NIST error rate models, BEAR, HMM and
+ * Matrix) it reports:
+ *  - ns/frame: wall clock time per frame put on the air (data and ACKs)
+ *  - events/frame: simulator events executed per frame
+ *  - allocs/frame: heap allocations per frame, the ones made to generate
+ *    the traffic excluded
+ *  - timeouts/frame, cancels/frame: DcfManager access timeouts scheduled
+ *    and cancelled per frame
+ *
+ * It must be run from the top directory (the BEAR model looks for its AR
+ * coefficients under src/bear-model/configs), i.e.
+ *   ./waf --run "wifi-frame-bench --nodes=8 --duration=10"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/dcf-manager.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/udp-header.h"
+#include "ns3/bear-propagation-loss-model.h"
+#include "ns3/hidden-markov-propagation-loss-model.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+#include <math.h>
+
+using namespace ns3;
+
+static uint64_t g_nAllocs = 0;
+
+void *
+operator new (size_t size) throw (std::bad_alloc)
+{
+  g_nAllocs++;
+  void *p = malloc (size == 0 ? 1 : size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) throw ()
+{
+  free (p);
+}
+
+namespace ns3 {
+
+/**
+ * Map scheduler which counts the events it hands to the simulator.
+ */
+class CountingScheduler : public MapScheduler
+{
+public:
+  static TypeId GetTypeId (void);
+  static uint64_t GetNEvents (void);
+  virtual Event RemoveNext (void);
+private:
+  static uint64_t m_nEvents;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (CountingScheduler);
+
+uint64_t CountingScheduler::m_nEvents = 0;
+
+TypeId
+CountingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CountingScheduler")
+    .SetParent<MapScheduler> ()
+    .AddConstructor<CountingScheduler> ()
+  ;
+  return tid;
+}
+
+uint64_t
+CountingScheduler::GetNEvents (void)
+{
+  return m_nEvents;
+}
+
+Scheduler::Event
+CountingScheduler::RemoveNext (void)
+{
+  m_nEvents++;
+  return MapScheduler::RemoveNext ();
+}
+
+} // namespace ns3
+
+class FrameBench
+{
+public:
+  enum Model
+  {
+    YANS,
+    NIST,
+    BEAR,
+    HMM,
+    MATRIX
+  };
+  struct Input
+  {
+    Input ();
+    uint32_t nNodes;
+    double duration;
+    double radius;
+    double fer;
+    uint32_t packetSize;
+    uint32_t queueDepth;
+    std::string txMode;
+  };
+  struct Output
+  {
+    uint64_t nFrames;
+    uint64_t nRxOk;
+    uint64_t nEvents;
+    uint64_t nAllocs;
+    uint64_t nAccessTimeoutsScheduled;
+    uint64_t nAccessTimeoutsCancelled;
+    int64_t elapsedMs;
+  };
+
+  FrameBench ();
+  struct FrameBench::Output Run (struct FrameBench::Input input, enum Model model);
+
+private:
+  /// A saturated adhoc station
+  class Station
+  {
+public:
+    Station (FrameBench *bench, Ptr<WifiNetDevice> device, Address to);
+    void Refill (void);
+    void TxBegin (Ptr<const Packet> packet);
+    void RxEnd (Ptr<const Packet> packet);
+private:
+    FrameBench *m_bench;
+    Ptr<WifiNetDevice> m_device;
+    Ptr<WifiMacQueue> m_queue;
+    Address m_to;
+  };
+
+  void SetErrorModel (enum Model model, NodeContainer nodes,
+                      YansWifiChannelHelper &channel, YansWifiPhyHelper &phy);
+
+  struct Input m_input;
+  struct Output m_output;
+  Ptr<Packet> m_packet;
+  uint64_t m_nGeneratorAllocs;
+};
+
+FrameBench::Input::Input ()
+  : nNodes (4),
+    duration (10.0),
+    radius (5.0),
+    fer (0.1),
+    packetSize (1000),
+    queueDepth (4),
+    txMode ("OfdmRate54Mbps")
+{
+}
+
+FrameBench::Station::Station (FrameBench *bench, Ptr<WifiNetDevice> device, Address to)
+  : m_bench (bench),
+    m_device (device),
+    m_to (to)
+{
+  PointerValue ptr;
+  m_device->GetMac ()->GetAttribute ("DcaTxop", ptr);
+  m_queue = ptr.Get<DcaTxop> ()->GetQueue ();
+}
+
+void
+FrameBench::Station::Refill (void)
+{
+  uint64_t allocs = g_nAllocs;
+  while (m_queue->GetSize () < m_bench->m_input.queueDepth)
+    {
+      m_device->Send (m_bench->m_packet->Copy (), m_to, 0x0800);
+    }
+  m_bench->m_nGeneratorAllocs += g_nAllocs - allocs;
+}
+
+void
+FrameBench::Station::TxBegin (Ptr<const Packet> packet)
+{
+  m_bench->m_output.nFrames++;
+  Refill ();
+}
+
+void
+FrameBench::Station::RxEnd (Ptr<const Packet> packet)
+{
+  m_bench->m_output.nRxOk++;
+}
+
+FrameBench::FrameBench ()
+  : m_nGeneratorAllocs (0)
+{
+}
+
+void
+FrameBench::SetErrorModel (enum Model model, NodeContainer nodes,
+                           YansWifiChannelHelper &channel, YansWifiPhyHelper &phy)
+{
+  // Every link has the configurable FER (option 5 of the channel configuration files)
+  std::map<int, std::vector<u_int8_t> > ferMap;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      ferMap[i] = std::vector<u_int8_t> (nodes.GetN (), 5);
+    }
+
+  switch (model)
+    {
+    case YANS:
+      channel.AddPropagationLoss ("ns3::LogDistancePropagationLossModel");
+      phy.SetErrorRateModel ("ns3::YansErrorRateModel");
+      break;
+    case NIST:
+      channel.AddPropagationLoss ("ns3::LogDistancePropagationLossModel");
+      phy.SetErrorRateModel ("ns3::NistErrorRateModel");
+      break;
+    case BEAR:
+      {
+        // The links are taken from the NodeList when the model is created
+        Ptr<BearPropagationLossModel> bear = CreateObject<BearPropagationLossModel> ();
+        bear->SetPropagationLoss ("ns3::LogDistancePropagationLossModel");
+        channel.AddPropagationLoss (bear);
+        phy.SetErrorModel (bear->GetErrorModel ());
+        break;
+      }
+    case HMM:
+      {
+        Ptr<HiddenMarkovPropagationLossModel> hmm = CreateObject<HiddenMarkovPropagationLossModel> ();
+        hmm->SetAttribute ("Mode", EnumValue (HMM_FRAME_BASED_SIMULATION));
+        hmm->SetAttribute ("FER", DoubleValue (m_input.fer));
+        hmm->InitFromFer (ferMap);
+        channel.AddPropagationLoss ("ns3::LogDistancePropagationLossModel");
+        channel.AddPropagationLoss (hmm);
+        phy.SetErrorModel (hmm->GetErrorModel ());
+        break;
+      }
+    case MATRIX:
+      {
+        Ptr<MatrixErrorModel> matrix = CreateObject<MatrixErrorModel> ();
+        matrix->SetDefaultFer (0.0);
+        matrix->SetFerMatrix (nodes.GetN (), std::vector<double> (nodes.GetN () * nodes.GetN (), m_input.fer));
+        channel.AddPropagationLoss ("ns3::LogDistancePropagationLossModel");
+        phy.SetErrorModel (matrix);
+        break;
+      }
+    }
+}
+
+struct FrameBench::Output
+FrameBench::Run (struct FrameBench::Input input, enum Model model)
+{
+  m_input = input;
+  m_output.nFrames = 0;
+  m_output.nRxOk = 0;
+  m_nGeneratorAllocs = 0;
+
+  NodeContainer nodes;
+  nodes.Create (m_input.nNodes);
+
+  // All the stations lie on a circle, within range of each other
+  MobilityHelper mobility;
+  Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+  for (uint32_t i = 0; i < m_input.nNodes; i++)
+    {
+      double angle = 2 * M_PI * i / m_input.nNodes;
+      positions->Add (Vector (m_input.radius * cos (angle), m_input.radius * sin (angle), 0.0));
+    }
+  mobility.SetPositionAllocator (positions);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+
+  YansWifiChannelHelper channel;
+  channel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+  SetErrorModel (model, nodes, channel, phy);
+  phy.SetChannel (channel.Create ());
+
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211a);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode", StringValue (m_input.txMode),
+                                "ControlMode", StringValue ("OfdmRate6Mbps"));
+  NqosWifiMacHelper mac = NqosWifiMacHelper::Default ();
+  mac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (phy, mac, nodes);
+
+  // UDP datagrams, so that every error model handles them as data frames
+  Ipv4Header ipv4;
+  ipv4.SetProtocol (17);
+  ipv4.SetPayloadSize (m_input.packetSize + 8);
+  UdpHeader udp;
+  m_packet = Create<Packet> (m_input.packetSize);
+  m_packet->AddHeader (udp);
+  m_packet->AddHeader (ipv4);
+
+  std::vector<Station *> stations;
+  for (uint32_t i = 0; i < m_input.nNodes; i++)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (devices.Get (i));
+      Station *station = new Station (this, device, devices.Get ((i + 1) % m_input.nNodes)->GetAddress ());
+      device->GetPhy ()->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&Station::TxBegin, station));
+      device->GetPhy ()->TraceConnectWithoutContext ("PhyRxEnd", MakeCallback (&Station::RxEnd, station));
+      Simulator::ScheduleNow (&Station::Refill, station);
+      stations.push_back (station);
+    }
+
+  Simulator::Stop (Seconds (m_input.duration));
+
+  uint64_t events = CountingScheduler::GetNEvents ();
+  uint64_t allocs = g_nAllocs;
+  uint64_t timeoutsScheduled = DcfManager::GetNAccessTimeoutsScheduled ();
+  uint64_t timeoutsCancelled = DcfManager::GetNAccessTimeoutsCancelled ();
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Run ();
+  m_output.elapsedMs = clock.End ();
+  m_output.nEvents = CountingScheduler::GetNEvents () - events;
+  m_output.nAllocs = g_nAllocs - allocs - m_nGeneratorAllocs;
+  m_output.nAccessTimeoutsScheduled = DcfManager::GetNAccessTimeoutsScheduled () - timeoutsScheduled;
+  m_output.nAccessTimeoutsCancelled = DcfManager::GetNAccessTimeoutsCancelled () - timeoutsCancelled;
+
+  Simulator::Destroy ();
+  for (uint32_t i = 0; i < stations.size (); i++)
+    {
+      delete stations[i];
+    }
+  m_packet = 0;
+  return m_output;
+}
+
+static void
+PrintResult (std::string name, struct FrameBench::Output output)
+{
+  double frames = output.nFrames > 0 ? output.nFrames : 1;
+  std::cout << std::left << std::setw (8) << name << std::right
+            << std::setw (12) << output.nFrames
+            << std::setw (12) << output.nRxOk
+            << std::setw (12) << std::fixed << std::setprecision (1) << output.elapsedMs * 1e6 / frames
+            << std::setw (14) << std::setprecision (2) << output.nEvents / frames
+            << std::setw (14) << output.nAllocs / frames
+            << std::setw (16) << output.nAccessTimeoutsScheduled / frames
+            << std::setw (15) << output.nAccessTimeoutsCancelled / frames
+            << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  struct FrameBench::Input input;
+  std::string models = "yans,nist,bear,hmm,matrix";
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of saturated stations", input.nNodes);
+  cmd.AddValue ("duration", "Simulated time of each run (s)", input.duration);
+  cmd.AddValue ("radius", "Radius of the circle the stations lie on (m)", input.radius);
+  cmd.AddValue ("fer", "FER of the links (HMM and Matrix models)", input.fer);
+  cmd.AddValue ("packetSize", "UDP payload size (bytes)", input.packetSize);
+  cmd.AddValue ("queueDepth", "Frames kept in the DcaTxop queue of each station", input.queueDepth);
+  cmd.AddValue ("txMode", "Data transmission mode", input.txMode);
+  cmd.AddValue ("models", "Comma separated error models (yans, nist, bear, hmm, matrix)", models);
+  cmd.Parse (argc, argv);
+
+  GlobalValue::Bind ("SchedulerType", TypeIdValue (CountingScheduler::GetTypeId ()));
+
+  std::cout << std::left << std::setw (8) << "model" << std::right
+            << std::setw (12) << "frames"
+            << std::setw (12) << "rx ok"
+            << std::setw (12) << "ns/frame"
+            << std::setw (14) << "events/frame"
+            << std::setw (14) << "allocs/frame"
+            << std::setw (16) << "timeouts/frame"
+            << std::setw (15) << "cancels/frame"
+            << std::endl;
+
+  std::string::size_type start = 0;
+  while (start <= models.size ())
+    {
+      std::string::size_type end = models.find (',', start);
+      if (end == std::string::npos)
+        {
+          end = models.size ();
+        }
+      std::string name = models.substr (start, end - start);
+      start = end + 1;
+
+      enum FrameBench::Model model;
+      if (name == "yans")
+        {
+          model = FrameBench::YANS;
+        }
+      else if (name == "nist")
+        {
+          model = FrameBench::NIST;
+        }
+      else if (name == "bear")
+        {
+          model = FrameBench::BEAR;
+        }
+      else if (name == "hmm")
+        {
+          model = FrameBench::HMM;
+        }
+      else if (name == "matrix")
+        {
+          model = FrameBench::MATRIX;
+        }
+      else
+        {
+          std::cerr << "Unknown error model " << name << std::endl;
+          return 1;
+        }
+      FrameBench bench;
+      PrintResult (name, bench.Run (input, model));
+    }
+
+  return 0;
+}
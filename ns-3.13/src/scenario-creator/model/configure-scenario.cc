@@ -221,6 +221,10 @@ bool ConfigureScenario::ParseConfigurationFile(string confFile)
     {
     	m_simulationChannel = SIM_MANUAL_MODEL;
     }
+    else if (!value.compare("REALIZATION"))
+    {
+    	m_simulationChannel = SIM_REALIZATION_MODEL;
+    }
     else
     {
         NS_ABORT_MSG("Incorrect channel model. " << value << " Please fix the configuration file");
@@ -509,6 +513,9 @@ void ConfigureScenario::Init()
     Config::SetDefault ("ns3::WifiMacQueue::MaxPacketNumber", UintegerValue(1000000)); 						//Maximum number of packets supported by the Wifi MAC buffer
     Config::SetDefault ("ns3::WifiRemoteStationManager::MaxSlrc", UintegerValue(4)); 						//Maximum number of transmission attempts
     Config::SetDefault ("ns3::WifiNetDevice::Mtu", UintegerValue(1512)); //
+
+    //The propagation chains are not changed once built --> Cache the losses of the deterministic models
+    Config::SetDefault ("ns3::PropagationLossModel::CacheDeterministicLoss", BooleanValue(true));
     
     //IP layer default options
 //    Config::SetDefault ("ns3::Ipv4L3Protocol::DefaultTtl", UintegerValue (4));
@@ -618,16 +625,35 @@ void ConfigureScenario::Init()
 
 }
 
+template <class ChannelModel>
+void ConfigureScenario::ConfigureChannelCheckpoint (Ptr<ChannelModel> model, const char *section)
+{
+	NS_LOG_FUNCTION (section);
+	string fileName, saveTime;
+
+	if (m_configurationFile->GetKeyValue (section, "LOAD_CHANNEL_STATE", fileName) >= 0)
+	{
+		NS_ABORT_MSG_UNLESS (model->LoadChannelState (fileName), "Cannot restore the channel state from " << fileName << ". Please fix");
+	}
+
+	if (m_configurationFile->GetKeyValue (section, "SAVE_CHANNEL_STATE", fileName) >= 0)
+	{
+		NS_ABORT_MSG_IF (m_configurationFile->GetKeyValue (section, "SAVE_CHANNEL_STATE_TIME", saveTime) < 0, "SAVE_CHANNEL_STATE needs SAVE_CHANNEL_STATE_TIME in [" << section << "]. Please fix");
+		Simulator::Schedule (Seconds (atof (saveTime.c_str())), &ChannelModel::SaveChannelState, model, fileName);
+	}
+}
+
 void ConfigureScenario::SetChannel ()
 {
     NS_LOG_FUNCTION(this);
+    Ptr<RangePropagationLossModel> range;
 
     switch (m_simulationChannel) {
         case SIM_RATE_ERROR: //MatrixPropagationLossModel + RateErrorModel (Simplest configuration)
         {
             Config::SetDefault("ns3::RangePropagationLossModel::MaxRange", DoubleValue(20.0));
-            Ptr<RangePropagationLossModel> prop = CreateObject<RangePropagationLossModel > ();
-            m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss(prop);
+            range = CreateObject<RangePropagationLossModel > ();
+            m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss(range);
 
             Ptr<RateErrorModel> error = CreateObject<RateErrorModel > ();
             error->SetUnit(EU_PKT);
@@ -656,8 +682,8 @@ void ConfigureScenario::SetChannel ()
 
         	//We will implement a maximum range in order to limit the coverage area of the nodes
         	Config::SetDefault("ns3::RangePropagationLossModel::MaxRange", DoubleValue(20.0));
-        	Ptr<RangePropagationLossModel> prop = CreateObject<RangePropagationLossModel > ();
-        	m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss(prop);
+        	range = CreateObject<RangePropagationLossModel > ();
+        	m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss(range);
 
         	//Create and prepare the loss propagation loss model
         	Ptr<HiddenMarkovPropagationLossModel> hmmModel = CreateObject<HiddenMarkovPropagationLossModel> ();
@@ -668,8 +694,14 @@ void ConfigureScenario::SetChannel ()
         		hmmModel->SetAttribute ("Mode", EnumValue(HMM_TIME_BASED_SIMULATION));
         	else if (temp == "FRAMES")
         		hmmModel->SetAttribute ("Mode", EnumValue(HMM_FRAME_BASED_SIMULATION));
+        	else if (temp == "SEMI_MARKOV")
+        	{
+        		hmmModel->SetAttribute ("Mode", EnumValue(HMM_SEMI_MARKOV_SIMULATION));
+        		NS_ABORT_MSG_IF (m_configurationFile->GetKeyValue ("HMM", "SOJOURN_FILE", temp) < 0, "SEMI_MARKOV mode needs SOJOURN_FILE in [HMM]. Please fix");
+        		hmmModel->SetAttribute ("SojournFile", StringValue(temp));
+        	}
         	else
-        		NS_ABORT_MSG ("Incorrect Hidden Markov model mode. Valid options: TIME or FRAMES. Please fix");
+        		NS_ABORT_MSG ("Incorrect Hidden Markov model mode. Valid options: TIME, FRAMES or SEMI_MARKOV. Please fix");
 
         	//Check the operation mode
         	assert (m_configurationFile->GetKeyValue ("HMM", "OPERATION", temp) >= 0);
@@ -698,6 +730,9 @@ void ConfigureScenario::SetChannel ()
             	NS_ABORT_MSG ("HMM operation " << temp << " not valid.Please fix");
             }
 
+            //Start from a stored channel state (optional)
+            ConfigureChannelCheckpoint (hmmModel, "HMM");
+
             //Add both propagation and error models to the Wifi instance helpers
              m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss (hmmModel);
              m_scenarioObjectContainer->m_yansWifiPhyHelper.SetErrorModel (hmmModel->GetErrorModel());
@@ -710,8 +745,8 @@ void ConfigureScenario::SetChannel ()
             //We can limit the transmission to a particular coverage area by means of the declaration of a range propagation loss model
             Config::SetDefault("ns3::RangePropagationLossModel::FirstRangeDistance", DoubleValue(30.0));
             Config::SetDefault("ns3::RangePropagationLossModel::SecondRangeDistance", DoubleValue(30.0));
-            Ptr<RangePropagationLossModel> prop = CreateObject<RangePropagationLossModel > ();
-            m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss(prop);
+            range = CreateObject<RangePropagationLossModel > ();
+            m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss(range);
 
             //Instance the BEAR propagation loss model (the error model is implicitly created)
             Ptr<BearPropagationLossModel> bearModel = CreateObject<BearPropagationLossModel > ();
@@ -734,6 +769,9 @@ void ConfigureScenario::SetChannel ()
             assert (m_configurationFile->GetKeyValue("BEAR", "FF_VARIANCE", temp) >= 0);
             bearModel->SetAttribute ("FastFadingVariance", DoubleValue(atof(temp.c_str())));
 
+            //Start from a stored channel state (optional)
+            ConfigureChannelCheckpoint (bearModel, "BEAR");
+
             //Add both propagation and error models to the Wifi instance helpers
             m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss (bearModel);
             m_scenarioObjectContainer->m_yansWifiPhyHelper.SetErrorModel (bearModel->GetErrorModel());
@@ -745,51 +783,91 @@ void ConfigureScenario::SetChannel ()
 
         	// First, set the RangePropagationLossModel
         	Config::SetDefault("ns3::RangePropagationLossModel::MaxRange", DoubleValue(20.0));
-        	Ptr<RangePropagationLossModel> prop = CreateObject<RangePropagationLossModel > ();
-        	m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss(prop);
+        	range = CreateObject<RangePropagationLossModel > ();
+        	m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss(range);
 
         	//Second, parse the scenario topology and configure the MatrixPropagationLossErrorModel
         	Ptr<MatrixErrorModel> error = CreateObject<MatrixErrorModel> ();
         	error->SetDefaultFer (0.0);
 
-        	///// MatrixPropagationLossModel Configuration (taken from the channel configuration file)
-        	for (i = 0; i < (int) NodeList().GetNNodes (); i++) {
-        		for (j = 0; j < (int) NodeList().GetNNodes (); j++) {
+        	///// MatrixPropagationLossModel Configuration (taken from the channel configuration file), loaded at once into the dense FER matrix
+        	u_int16_t nodes = NodeList().GetNNodes ();
+        	vector<double> ferMatrix ((size_t) nodes * nodes, -1.0);
+        	for (i = 0; i < nodes; i++) {
+        		map<int, vector<u_int8_t> >::const_iterator row = m_channelFer.find(i);
+        		if (row == m_channelFer.end()) {
+        			NS_LOG_ERROR("Key " << i << " not found");
+        			continue;
+        		}
+        		for (j = 0; j < nodes && j < row->second.size(); j++) {
         			if (i != j) {
-        				if (m_channelFer.find(i) != m_channelFer.end()) {
-        					//Configure the FER between the nodes. There are three possibilities: 0- The filter leaves the packet to pass through; 1- The filter blocks the packet; 5- The packet go beyond the filter,
-        					//but it's up to the next propagation loss model to handle the channel response
-        					//printf("Element %d, %d = %d\n", i, j, m_channelFer.find(i)->second[j]);
-
-        					switch (m_channelFer.find(i)->second[j])
-        					{
-        					case 0: //No FER
-        						error->SetFer (NodeList().GetNode(i)->GetId(), NodeList().GetNode(j)->GetId(), 0.0);
-        						break;
-        					case 1: //All frames will be discarded
-        						error->SetFer (NodeList().GetNode(i)->GetId(), NodeList().GetNode(j)->GetId(), 1.0);
-        						break;
-        					case 5: //Configurable FER (through m_fer variable) --> Need to find a way to instance the desired propagation loss models
-        						error->SetFer (NodeList().GetNode(i)->GetId(), NodeList().GetNode(j)->GetId(), m_fer);
-        						break;
-
-        					default:
-        						NS_LOG_ERROR("Non-handled option");
-        						break;
-        					}
-        				}
-        				else {
-        					NS_LOG_ERROR("Key " << i << " not found");
+        				//Configure the FER between the nodes. There are three possibilities: 0- The filter leaves the packet to pass through; 1- The filter blocks the packet; 5- The packet go beyond the filter,
+        				//but it's up to the next propagation loss model to handle the channel response
+        				switch (row->second[j])
+        				{
+        				case 0: //No FER
+        					ferMatrix[i * nodes + j] = 0.0;
+        					break;
+        				case 1: //All frames will be discarded
+        					ferMatrix[i * nodes + j] = 1.0;
+        					break;
+        				case 5: //Configurable FER (through m_fer variable) --> Need to find a way to instance the desired propagation loss models
+        					ferMatrix[i * nodes + j] = m_fer;
+        					break;
+
+        				default:
+        					NS_LOG_ERROR("Non-handled option");
+        					break;
         				}
         			}
         		}
         	}
+        	error->SetFerMatrix (nodes, ferMatrix);
+
+        	//Optional time-varying FER (i.e. a FER sweep within a single run)
+        	string scheduleFile;
+        	if (m_configurationFile->GetKeyValue ("STACK", "FER_SCHEDULE", scheduleFile) >= 0 && !error->LoadFerSchedule (scheduleFile))
+        		NS_ABORT_MSG ("Cannot load the FER schedule " << scheduleFile << ". Please fix");
 
         	m_scenarioObjectContainer->m_yansWifiPhyHelper.SetErrorModel(error);
 
         	break;
         }
+        case SIM_REALIZATION_MODEL: //ChannelRealizationPropagationLossModel + ChannelRealizationErrorModel (playback of a precomputed channel)
+        {
+        	string temp;
+
+        	Config::SetDefault("ns3::RangePropagationLossModel::MaxRange", DoubleValue(20.0));
+        	range = CreateObject<RangePropagationLossModel > ();
+        	m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss(range);
+
+        	Ptr<ChannelRealizationPropagationLossModel> realizationModel = CreateObject<ChannelRealizationPropagationLossModel> ();
+        	NS_ABORT_MSG_IF (m_configurationFile->GetKeyValue ("REALIZATION", "FILE", temp) < 0, "Missing FILE in [REALIZATION]. Please fix");
+        	if (!realizationModel->SetRealizationFile (temp))
+        		NS_ABORT_MSG ("Cannot load the channel realization file " << temp << ". Please fix");
+
+        	//Add both propagation and error models to the Wifi instance helpers
+        	m_scenarioObjectContainer->m_yanswifiChannelHelper.AddPropagationLoss (realizationModel);
+        	m_scenarioObjectContainer->m_yansWifiPhyHelper.SetErrorModel (realizationModel->GetErrorModel());
+        	break;
+        }
     }
+
+    //Frames beyond the RangePropagationLossModel cutoff are not delivered to the receivers' PHYs
+    SetChannelMaxRange (range);
+}
+
+void ConfigureScenario::SetChannelMaxRange (Ptr<RangePropagationLossModel> range)
+{
+	NS_LOG_FUNCTION (this << range);
+	DoubleValue cutoff;
+
+	//Not every channel limits the coverage area (i.e. SIM_DEFAULT_MODEL)
+	if (range == 0)
+		return;
+
+	range->GetAttribute ("SecondRangeDistance", cutoff);
+	Config::SetDefault ("ns3::YansWifiChannel::MaxRange", cutoff);
 }
 
 void ConfigureScenario::ConfigureRoutingProtocol()
@@ -1104,6 +1182,9 @@ std::string ConfigureScenario::ComposeTraceFileName(u_int32_t runCounter)
         case SIM_MANUAL_MODEL:
         	fileName += "MANUAL_";
         	break;
+        case SIM_REALIZATION_MODEL:
+        	fileName += "REALIZATION_";
+        	break;
     }
 
     // 4 - Scenario topology and error configuration
@@ -42,6 +42,7 @@
 #include "ns3/error-model.h"
 #include "ns3/bear-propagation-loss-model.h"
 #include "ns3/hidden-markov-propagation-loss-model.h"
+#include "ns3/channel-realization-propagation-loss-model.h"
 
 #include <fstream>
 #include <map>
@@ -61,7 +62,8 @@ enum SimulationChannelType_t {
 	SIM_DEFAULT_MODEL,		//LogDistancePropagationLossModel + RandomPropagationLossModel + YansErrorRateModel
 	SIM_HMM_MODEL,			//HiddenMarkovPropagationLossModel + HiddenMarkovErrorModel
 	SIM_BEAR_MODEL,			//BearPropagationLossModel + BearErrorModel
-	SIM_MANUAL_MODEL		//Matrix configuration file + MatrixPropagationLossErrorModel
+	SIM_MANUAL_MODEL,		//Matrix configuration file + MatrixPropagationLossErrorModel
+	SIM_REALIZATION_MODEL	//ChannelRealizationPropagationLossModel + ChannelRealizationErrorModel (precomputed BEAR/HMM channel)
 };
 
 enum RoutingProtocol_t {
@@ -375,6 +377,22 @@ public:
 	
 	//Extracted from InternetStackHelper (see documentation therein)
 	void CreateAndAggregateObjectFromTypeId (Ptr<Node> node, const std::string typeId);
+
+	/**
+	 * \brief Restore the links state of a memory-channel model (BEAR or HMM) from the LOAD_CHANNEL_STATE checkpoint of its configuration
+	 * section, and schedule a checkpoint into SAVE_CHANNEL_STATE at SAVE_CHANNEL_STATE_TIME (seconds). All the keys are optional
+	 * \param model Propagation loss model, once its links have been created
+	 * \param section Section of the configuration file (BEAR or HMM)
+	 */
+	template <class ChannelModel>
+	void ConfigureChannelCheckpoint (Ptr<ChannelModel> model, const char *section);
+
+private:
+	/**
+	 * \brief Limit the YansWifiChannel delivery to the cutoff (SecondRangeDistance) of the range propagation loss model of the channel
+	 * \param range Range propagation loss model of the chain (null if the channel does not limit the coverage area)
+	 */
+	void SetChannelMaxRange (Ptr<RangePropagationLossModel> range);
 };
 
 } //End namespace ns3
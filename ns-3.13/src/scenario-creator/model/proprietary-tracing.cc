@@ -117,7 +117,7 @@ packetInfo_t ProprietaryTracing::ParsePacket (Ptr<const Packet> packet)
     return packetInfo;
 }
 
-void ProprietaryTracing::DefaultPhyRxTrace (Ptr<Packet> packet, bool error, double snr, int nodeId)
+void ProprietaryTracing::DefaultPhyRxTrace (Ptr<const Packet> packet, bool error, double snr, int nodeId)
 {
     NS_LOG_FUNCTION(this);
     //Update statistics
@@ -110,7 +110,7 @@ public:
 	 * \param snr
 	 * \param nodeId
 	 */
-	void DefaultPhyRxTrace (Ptr<Packet> packet, bool error, double snr, int nodeId);
+	void DefaultPhyRxTrace (Ptr<const Packet> packet, bool error, double snr, int nodeId);
 
 	
 	/**
@@ -13,6 +13,7 @@
 #include "ns3/pointer.h"
 #include "ns3/double.h"
 #include "ns3/string.h"
+#include "ns3/uinteger.h"
 
 using namespace ns3;
 
@@ -112,6 +113,136 @@ ErrorModelSimple::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ (m_drops, 8, "Wrong number of drops.");
 }
 
+// MatrixErrorModel: dense per-link FER lookup and frame class filter
+class MatrixErrorModelFer : public TestCase
+{
+public:
+  MatrixErrorModelFer ();
+  virtual ~MatrixErrorModelFer ();
+
+private:
+  virtual void DoRun (void);
+  bool Corrupt (Ptr<MatrixErrorModel> em, uint16_t tx, uint16_t rx, MatrixErrorModel::FrameClass frameClass);
+};
+
+MatrixErrorModelFer::MatrixErrorModelFer ()
+  : TestCase ("MatrixErrorModel FER matrix and frame class filter")
+{
+}
+
+MatrixErrorModelFer::~MatrixErrorModelFer ()
+{
+}
+
+bool
+MatrixErrorModelFer::Corrupt (Ptr<MatrixErrorModel> em, uint16_t tx, uint16_t rx, MatrixErrorModel::FrameClass frameClass)
+{
+  em->SetTransmitter (tx);
+  em->SetReceiver (rx);
+  em->SetFrameClass (frameClass);
+  return em->IsCorrupt (Create<Packet> (1000));
+}
+
+void
+MatrixErrorModelFer::DoRun (void)
+{
+  Ptr<MatrixErrorModel> em = CreateObject<MatrixErrorModel> ();
+  std::vector<double> fer (9, -1.0);
+
+  // Bulk load: 0 -> 1 always lost, 1 -> 0 never lost, the rest use the default FER
+  fer[0 * 3 + 1] = 1.0;
+  fer[1 * 3 + 0] = 0.0;
+  em->SetFerMatrix (3, fer);
+  em->SetDefaultFer (1.0);
+
+  NS_TEST_ASSERT_MSG_EQ (Corrupt (em, 0, 1, MatrixErrorModel::FRAME_DATA), true, "0 -> 1 data frame should be lost");
+  NS_TEST_ASSERT_MSG_EQ (Corrupt (em, 1, 0, MatrixErrorModel::FRAME_DATA), false, "1 -> 0 data frame should be received");
+  NS_TEST_ASSERT_MSG_EQ (Corrupt (em, 2, 1, MatrixErrorModel::FRAME_DATA), true, "2 -> 1 should use the default FER");
+  NS_TEST_ASSERT_MSG_EQ (Corrupt (em, 7, 1, MatrixErrorModel::FRAME_DATA), true, "Unknown nodes should use the default FER");
+
+  // Only the error prone classes can be corrupted
+  NS_TEST_ASSERT_MSG_EQ (Corrupt (em, 0, 1, MatrixErrorModel::FRAME_TCP_ACK), false, "TCP ACK should not be error prone");
+  NS_TEST_ASSERT_MSG_EQ (Corrupt (em, 0, 1, MatrixErrorModel::FRAME_MAC_ACK), false, "802.11 ACK should not be error prone");
+  em->SetAttribute ("ErrorProneFrames", UintegerValue (MatrixErrorModel::FRAME_DATA | MatrixErrorModel::FRAME_TCP_ACK));
+  NS_TEST_ASSERT_MSG_EQ (Corrupt (em, 0, 1, MatrixErrorModel::FRAME_TCP_ACK), true, "TCP ACK should be error prone");
+
+  // Setting a link beyond the matrix grows it, keeping the configured links
+  em->SetFer (4, 3, 0.0);
+  NS_TEST_ASSERT_MSG_EQ (em->GetFer (4, 3), 0.0, "Wrong FER after growing the matrix");
+  NS_TEST_ASSERT_MSG_EQ (em->GetFer (0, 1), 1.0, "Link lost after growing the matrix");
+  NS_TEST_ASSERT_MSG_EQ (em->GetFer (1, 0), 0.0, "Link lost after growing the matrix");
+  NS_TEST_ASSERT_MSG_EQ (em->GetFer (3, 4), 1.0, "Non-set link should use the default FER");
+}
+
+// MatrixErrorModel: time-varying FER schedule, advanced lazily
+class MatrixErrorModelSchedule : public TestCase
+{
+public:
+  MatrixErrorModelSchedule ();
+  virtual ~MatrixErrorModelSchedule ();
+
+private:
+  virtual void DoRun (void);
+  void Check (Ptr<MatrixErrorModel> em, bool expected);
+};
+
+MatrixErrorModelSchedule::MatrixErrorModelSchedule ()
+  : TestCase ("MatrixErrorModel piecewise-constant FER schedule")
+{
+}
+
+MatrixErrorModelSchedule::~MatrixErrorModelSchedule ()
+{
+}
+
+void
+MatrixErrorModelSchedule::Check (Ptr<MatrixErrorModel> em, bool expected)
+{
+  em->SetTransmitter (0);
+  em->SetReceiver (1);
+  em->SetFrameClass (MatrixErrorModel::FRAME_DATA);
+  NS_TEST_EXPECT_MSG_EQ (em->IsCorrupt (Create<Packet> (1000)), expected, "Wrong FER at " << Simulator::Now ().GetSeconds () << " s");
+}
+
+void
+MatrixErrorModelSchedule::DoRun (void)
+{
+  Ptr<MatrixErrorModel> em = CreateObject<MatrixErrorModel> ();
+  std::vector<std::pair<Time, double> > schedule;
+
+  // Static FER 0 until 1 s, then 1 until 3 s, then 0 again
+  em->SetFer (0, 1, 0.0);
+  schedule.push_back (std::make_pair (Seconds (1.0), 1.0));
+  schedule.push_back (std::make_pair (Seconds (3.0), 0.0));
+  em->SetFerSchedule (0, 1, schedule);
+
+  Simulator::Schedule (Seconds (0.5), &MatrixErrorModelSchedule::Check, this, em, false);
+  Simulator::Schedule (Seconds (1.0), &MatrixErrorModelSchedule::Check, this, em, true);
+  Simulator::Schedule (Seconds (2.5), &MatrixErrorModelSchedule::Check, this, em, true);
+  Simulator::Schedule (Seconds (4.0), &MatrixErrorModelSchedule::Check, this, em, false);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // The scheduled FER does not overwrite the static one, and Reset rewinds the schedule
+  em->SetFer (0, 1, 1.0);
+  schedule.clear ();
+  schedule.push_back (std::make_pair (Seconds (1.0), 0.0));
+  em->SetFerSchedule (0, 1, schedule);
+
+  Simulator::Schedule (Seconds (0.5), &MatrixErrorModelSchedule::Check, this, em, true);
+  Simulator::Schedule (Seconds (1.5), &MatrixErrorModelSchedule::Check, this, em, false);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  NS_TEST_ASSERT_MSG_EQ (em->GetFer (0, 1), 0.0, "Scheduled FER should take precedence over the static one");
+
+  em->Reset ();
+  NS_TEST_ASSERT_MSG_EQ (em->GetFer (0, 1), 1.0, "Static FER lost after the schedule");
+  Simulator::Schedule (Seconds (0.5), &MatrixErrorModelSchedule::Check, this, em, true);
+  Simulator::Schedule (Seconds (1.5), &MatrixErrorModelSchedule::Check, this, em, false);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
 // This is the start of an error model test suite.  For starters, this is
 // just testing that the SimpleNetDevice is working but this can be
 // extended to many more test cases in the future
@@ -125,6 +256,8 @@ ErrorModelTestSuite::ErrorModelTestSuite ()
   : TestSuite ("error-model", UNIT)
 {
   AddTestCase (new ErrorModelSimple);
+  AddTestCase (new MatrixErrorModelFer);
+  AddTestCase (new MatrixErrorModelSchedule);
 }
 
 // Do not forget to allocate an instance of this TestSuite
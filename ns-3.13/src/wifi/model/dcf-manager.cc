@@ -35,6 +35,9 @@ NS_LOG_COMPONENT_DEFINE ("DcfManager");
 
 namespace ns3 {
 
+static uint64_t g_nAccessTimeoutsScheduled = 0;
+static uint64_t g_nAccessTimeoutsCancelled = 0;
+
 /****************************************************************
  *      Implement the DCF state holder
  ****************************************************************/
@@ -276,6 +279,11 @@ DcfManager::DcfManager ()
 
 DcfManager::~DcfManager ()
 {
+  // Stale timeouts may still be armed
+  for (AccessTimeouts::iterator i = m_accessTimeouts.begin (); i != m_accessTimeouts.end (); i++)
+    {
+      i->second.Cancel ();
+    }
   delete m_phyListener;
   delete m_lowListener;
   m_phyListener = 0;
@@ -415,12 +423,13 @@ DcfManager::RequestAccess (DcfState *state)
 void
 DcfManager::DoGrantAccess (void)
 {
+  Time accessGrantStart = GetAccessGrantStart ();
   uint32_t k = 0;
   for (States::const_iterator i = m_states.begin (); i != m_states.end (); k++)
     {
       DcfState *state = *i;
       if (state->IsAccessRequested ()
-          && GetBackoffEndFor (state) <= Simulator::Now () )
+          && GetBackoffEndFor (state, accessGrantStart) <= Simulator::Now () )
         {
           /**
            * This is the first dcf we find with an expired backoff and which
@@ -434,7 +443,7 @@ DcfManager::DoGrantAccess (void)
             {
               DcfState *otherState = *j;
               if (otherState->IsAccessRequested ()
-                  && GetBackoffEndFor (otherState) <= Simulator::Now ())
+                  && GetBackoffEndFor (otherState, accessGrantStart) <= Simulator::Now ())
                 {
                   MY_DEBUG ("dcf " << k << " needs access. backoff expired. internal collision. slots=" <<
                             otherState->GetBackoffSlots ());
@@ -469,8 +478,30 @@ DcfManager::DoGrantAccess (void)
 void
 DcfManager::AccessTimeout (void)
 {
-  UpdateBackoff ();
-  DoGrantAccess ();
+  m_accessTimeouts.erase (m_accessTimeouts.begin (), m_accessTimeouts.upper_bound (Simulator::Now ()));
+
+  /**
+   * The medium may have become busy since this timeout was scheduled, in
+   * which case no backoff has expired yet: the backoffs were already updated
+   * when the medium became busy, so just wait for the new earliest end.
+   */
+  Time accessGrantStart = GetAccessGrantStart ();
+  bool accessGrantDue = false;
+  for (States::const_iterator i = m_states.begin (); i != m_states.end (); i++)
+    {
+      DcfState *state = *i;
+      if (state->IsAccessRequested ()
+          && GetBackoffEndFor (state, accessGrantStart) <= Simulator::Now ())
+        {
+          accessGrantDue = true;
+          break;
+        }
+    }
+  if (accessGrantDue)
+    {
+      UpdateBackoff ();
+      DoGrantAccess ();
+    }
   DoRestartAccessTimeoutIfNeeded ();
 }
 
@@ -513,29 +544,30 @@ DcfManager::GetAccessGrantStart (void) const
 }
 
 Time
-DcfManager::GetBackoffStartFor (DcfState *state)
+DcfManager::GetBackoffStartFor (DcfState *state, Time accessGrantStart) const
 {
   Time mostRecentEvent = MostRecent (state->GetBackoffStart (),
-                                     GetAccessGrantStart () + MicroSeconds (state->GetAifsn () * m_slotTimeUs));
+                                     accessGrantStart + MicroSeconds (state->GetAifsn () * m_slotTimeUs));
 
   return mostRecentEvent;
 }
 
 Time
-DcfManager::GetBackoffEndFor (DcfState *state)
+DcfManager::GetBackoffEndFor (DcfState *state, Time accessGrantStart) const
 {
-  return GetBackoffStartFor (state) + MicroSeconds (state->GetBackoffSlots () * m_slotTimeUs);
+  return GetBackoffStartFor (state, accessGrantStart) + MicroSeconds (state->GetBackoffSlots () * m_slotTimeUs);
 }
 
 void
 DcfManager::UpdateBackoff (void)
 {
+  Time accessGrantStart = GetAccessGrantStart ();
   uint32_t k = 0;
   for (States::const_iterator i = m_states.begin (); i != m_states.end (); i++, k++)
     {
       DcfState *state = *i;
 
-      Time backoffStart = GetBackoffStartFor (state);
+      Time backoffStart = GetBackoffStartFor (state, accessGrantStart);
       if (backoffStart <= Simulator::Now ())
         {
           uint32_t nus = (Simulator::Now () - backoffStart).GetMicroSeconds ();
@@ -557,12 +589,13 @@ DcfManager::DoRestartAccessTimeoutIfNeeded (void)
    */
   bool accessTimeoutNeeded = false;
   Time expectedBackoffEnd = Simulator::GetMaximumSimulationTime ();
+  Time accessGrantStart = GetAccessGrantStart ();
   for (States::const_iterator i = m_states.begin (); i != m_states.end (); i++)
     {
       DcfState *state = *i;
       if (state->IsAccessRequested ())
         {
-          Time tmp = GetBackoffEndFor (state);
+          Time tmp = GetBackoffEndFor (state, accessGrantStart);
           if (tmp > Simulator::Now ())
             {
               accessTimeoutNeeded = true;
@@ -573,16 +606,17 @@ DcfManager::DoRestartAccessTimeoutIfNeeded (void)
   if (accessTimeoutNeeded)
     {
       MY_DEBUG ("expected backoff end=" << expectedBackoffEnd);
-      Time expectedBackoffDelay = expectedBackoffEnd - Simulator::Now ();
-      if (m_accessTimeout.IsRunning ()
-          && Simulator::GetDelayLeft (m_accessTimeout) > expectedBackoffDelay)
-        {
-          m_accessTimeout.Cancel ();
-        }
-      if (m_accessTimeout.IsExpired ())
+      /**
+       * A pending timeout which expires no later than the expected backoff
+       * end will re-check the grant, so it is enough. Otherwise, add an
+       * earlier one and leave the later one armed.
+       */
+      if (m_accessTimeouts.empty ()
+          || m_accessTimeouts.begin ()->first > expectedBackoffEnd)
         {
-          m_accessTimeout = Simulator::Schedule (expectedBackoffDelay,
-                                                 &DcfManager::AccessTimeout, this);
+          m_accessTimeouts[expectedBackoffEnd] = Simulator::Schedule (expectedBackoffEnd - Simulator::Now (),
+                                                                      &DcfManager::AccessTimeout, this);
+          g_nAccessTimeoutsScheduled++;
         }
     }
 }
@@ -673,11 +707,13 @@ DcfManager::NotifySwitchingStartNow (Time duration)
       m_lastCtsTimeoutEnd = now;
     }
 
-  // Cancel timeout
-  if (m_accessTimeout.IsRunning ())
+  // Cancel timeouts
+  for (AccessTimeouts::iterator i = m_accessTimeouts.begin (); i != m_accessTimeouts.end (); i++)
     {
-      m_accessTimeout.Cancel ();
+      i->second.Cancel ();
+      g_nAccessTimeoutsCancelled++;
     }
+  m_accessTimeouts.clear ();
 
   // Reset backoffs
   for (States::iterator i = m_states.begin (); i != m_states.end (); i++)
@@ -753,4 +789,16 @@ DcfManager::NotifyCtsTimeoutResetNow ()
   m_lastCtsTimeoutEnd = Simulator::Now ();
   DoRestartAccessTimeoutIfNeeded ();
 }
+
+uint64_t
+DcfManager::GetNAccessTimeoutsScheduled (void)
+{
+  return g_nAccessTimeoutsScheduled;
+}
+
+uint64_t
+DcfManager::GetNAccessTimeoutsCancelled (void)
+{
+  return g_nAccessTimeoutsCancelled;
+}
 } // namespace ns3
@@ -24,6 +24,7 @@
 #include "ns3/nstime.h"
 #include "ns3/event-id.h"
 #include <vector>
+#include <map>
 
 namespace ns3 {
 
@@ -284,6 +285,17 @@ public:
   void NotifyAckTimeoutResetNow ();
   void NotifyCtsTimeoutStartNow (Time duration);
   void NotifyCtsTimeoutResetNow ();
+
+  /**
+   * \returns the number of access timeout events scheduled so far by all
+   * the DcfManager instances.
+   */
+  static uint64_t GetNAccessTimeoutsScheduled (void);
+  /**
+   * \returns the number of access timeout events cancelled so far by all
+   * the DcfManager instances.
+   */
+  static uint64_t GetNAccessTimeoutsCancelled (void);
 private:
   void UpdateBackoff (void);
   Time MostRecent (Time a, Time b) const;
@@ -299,8 +311,12 @@ private:
    * be granted
    */
   Time GetAccessGrantStart (void) const;
-  Time GetBackoffStartFor (DcfState *state);
-  Time GetBackoffEndFor (DcfState *state);
+  /**
+   * The access grant start is the same for all the DcfStates, so that
+   * callers iterating over them compute it only once.
+   */
+  Time GetBackoffStartFor (DcfState *state, Time accessGrantStart) const;
+  Time GetBackoffEndFor (DcfState *state, Time accessGrantStart) const;
   void DoRestartAccessTimeoutIfNeeded (void);
   void AccessTimeout (void);
   void DoGrantAccess (void);
@@ -326,7 +342,16 @@ private:
   bool m_rxing;
   bool m_sleeping;
   Time m_eifsNoDifs;
-  EventId m_accessTimeout;
+  /**
+   * Pending access timeouts, indexed by their expiry time. A timeout is
+   * never cancelled when the earliest backoff end moves: if it moves later,
+   * the armed timeout expires early, re-checks the grant and is re-armed;
+   * if it moves earlier, a new timeout is added and the later one is left
+   * armed, to be re-checked when it fires. Timeouts are only cancelled on a
+   * channel switch.
+   */
+  typedef std::map<Time, EventId> AccessTimeouts;
+  AccessTimeouts m_accessTimeouts;
   uint32_t m_slotTimeUs;
   Time m_sifs;
   PhyListener* m_phyListener;
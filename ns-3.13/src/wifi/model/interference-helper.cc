@@ -32,6 +32,33 @@ namespace ns3 {
  *       Phy event class
  ****************************************************************/
 
+InterferenceHelper::Event::FreeEvent *InterferenceHelper::Event::m_freeEvents = 0;
+
+void *
+InterferenceHelper::Event::operator new (size_t size)
+{
+  NS_ASSERT (size == sizeof (InterferenceHelper::Event));
+  if (m_freeEvents != 0)
+    {
+      FreeEvent *event = m_freeEvents;
+      m_freeEvents = event->next;
+      return event;
+    }
+  return ::operator new (size);
+}
+
+void
+InterferenceHelper::Event::operator delete (void *p)
+{
+  if (p == 0)
+    {
+      return;
+    }
+  FreeEvent *event = static_cast<FreeEvent *> (p);
+  event->next = m_freeEvents;
+  m_freeEvents = event;
+}
+
 InterferenceHelper::Event::Event (uint32_t size, WifiMode payloadMode,
                                   enum WifiPreamble preamble,
                                   Time duration, double rxPower)
@@ -83,32 +110,6 @@ InterferenceHelper::Event::GetPreambleType (void) const
   return m_preamble;
 }
 
-/****************************************************************
- *       Class which records SNIR change events for a
- *       short period of time.
- ****************************************************************/
-
-InterferenceHelper::NiChange::NiChange (Time time, double delta)
-  : m_time (time),
-    m_delta (delta)
-{
-}
-Time
-InterferenceHelper::NiChange::GetTime (void) const
-{
-  return m_time;
-}
-double
-InterferenceHelper::NiChange::GetDelta (void) const
-{
-  return m_delta;
-}
-bool
-InterferenceHelper::NiChange::operator < (const InterferenceHelper::NiChange& o) const
-{
-  return (m_time < o.m_time);
-}
-
 /****************************************************************
  *       The actual InterferenceHelper
  ****************************************************************/
@@ -116,7 +117,10 @@ InterferenceHelper::NiChange::operator < (const InterferenceHelper::NiChange& o)
 InterferenceHelper::InterferenceHelper ()
   : m_errorRateModel (0),
     m_firstPower (0.0),
-    m_rxing (false)
+    m_rxing (false),
+    m_accumulated (m_niChanges.end ()),
+    m_accumulatedPower (0.0),
+    m_accumulatedUntil (Seconds (0))
 {
 }
 InterferenceHelper::~InterferenceHelper ()
@@ -170,17 +174,20 @@ Time
 InterferenceHelper::GetEnergyDuration (double energyW)
 {
   Time now = Simulator::Now ();
-  double noiseInterferenceW = 0.0;
+  // The past changes are accumulated only once
+  while (m_accumulated != m_niChanges.end () && m_accumulated->first < now)
+    {
+      m_accumulatedPower += m_accumulated->second;
+      m_accumulated++;
+    }
+  m_accumulatedUntil = now;
+
+  double noiseInterferenceW = m_firstPower + m_accumulatedPower;
   Time end = now;
-  noiseInterferenceW = m_firstPower;
-  for (NiChanges::const_iterator i = m_niChanges.begin (); i != m_niChanges.end (); i++)
+  for (NiChanges::const_iterator i = m_accumulated; i != m_niChanges.end (); i++)
     {
-      noiseInterferenceW += i->GetDelta ();
-      end = i->GetTime ();
-      if (end < now)
-        {
-          continue;
-        }
+      noiseInterferenceW += i->second;
+      end = i->first;
       if (noiseInterferenceW < energyW)
         {
           break;
@@ -195,20 +202,25 @@ InterferenceHelper::AppendEvent (Ptr<InterferenceHelper::Event> event)
   Time now = Simulator::Now ();
   if (!m_rxing)
     {
-      NiChanges::iterator nowIterator = GetPosition (now);
-      for (NiChanges::iterator i = m_niChanges.begin (); i != nowIterator; i++)
+      // No reception in progress: the changes up to now are folded into m_firstPower
+      while (!m_niChanges.empty () && m_niChanges.begin ()->first <= now)
         {
-          m_firstPower += i->GetDelta ();
+          NiChanges::iterator i = m_niChanges.begin ();
+          if (i == m_accumulated)
+            {
+              m_accumulated++;
+            }
+          else
+            {
+              m_accumulatedPower -= i->second;
+            }
+          m_firstPower += i->second;
+          m_niChanges.erase (i);
         }
-      m_niChanges.erase (m_niChanges.begin (), nowIterator);
-      m_niChanges.insert (m_niChanges.begin (), NiChange (event->GetStartTime (), event->GetRxPowerW ()));
     }
-  else
-    {
-      AddNiChangeEvent (NiChange (event->GetStartTime (), event->GetRxPowerW ()));
-    }
-  AddNiChangeEvent (NiChange (event->GetEndTime (), -event->GetRxPowerW ()));
-
+  // If not receiving, the start of the event becomes the first change
+  AddNiChangeEvent (event->GetStartTime (), event->GetRxPowerW ());
+  AddNiChangeEvent (event->GetEndTime (), -event->GetRxPowerW ());
 }
 
 
@@ -229,21 +241,11 @@ InterferenceHelper::CalculateSnr (double signal, double noiseInterference, WifiM
 }
 
 double
-InterferenceHelper::CalculateNoiseInterferenceW (Ptr<InterferenceHelper::Event> event, NiChanges *ni) const
+InterferenceHelper::CalculateNoiseInterferenceW (Ptr<InterferenceHelper::Event> event) const
 {
-  double noiseInterference = m_firstPower;
   NS_ASSERT (m_rxing);
-  for (NiChanges::const_iterator i = m_niChanges.begin () + 1; i != m_niChanges.end (); i++)
-    {
-      if ((event->GetEndTime () == i->GetTime ()) && event->GetRxPowerW () == -i->GetDelta ())
-        {
-          break;
-        }
-      ni->push_back (*i);
-    }
-  ni->insert (ni->begin (), NiChange (event->GetStartTime (), noiseInterference));
-  ni->push_back (NiChange (event->GetEndTime (), 0));
-  return noiseInterference;
+  NS_ASSERT (!m_niChanges.empty () && m_niChanges.begin ()->first == event->GetStartTime ());
+  return m_firstPower;
 }
 
 double
@@ -260,23 +262,34 @@ InterferenceHelper::CalculateChunkSuccessRate (double snir, Time duration, WifiM
 }
 
 double
-InterferenceHelper::CalculatePer (Ptr<const InterferenceHelper::Event> event, NiChanges *ni) const
+InterferenceHelper::CalculatePer (Ptr<const InterferenceHelper::Event> event, double noiseInterferenceW) const
 {
   double psr = 1.0; /* Packet Success Rate */
-  NiChanges::iterator j = ni->begin ();
-  Time previous = (*j).GetTime ();
+  NiChanges::const_iterator j = m_niChanges.begin ();
+  Time previous = event->GetStartTime ();
   WifiMode payloadMode = event->GetPayloadMode ();
   WifiPreamble preamble = event->GetPreambleType ();
   WifiMode headerMode = WifiPhy::GetPlcpHeaderMode (payloadMode, preamble);
-  Time plcpHeaderStart = (*j).GetTime () + MicroSeconds (WifiPhy::GetPlcpPreambleDurationMicroSeconds (payloadMode, preamble));
+  Time plcpHeaderStart = previous + MicroSeconds (WifiPhy::GetPlcpPreambleDurationMicroSeconds (payloadMode, preamble));
   Time plcpPayloadStart = plcpHeaderStart + MicroSeconds (WifiPhy::GetPlcpHeaderDurationMicroSeconds (payloadMode, preamble));
-  double noiseInterferenceW = (*j).GetDelta ();
   double powerW = event->GetRxPowerW ();
+  bool last = false;
 
   j++;
-  while (ni->end () != j)
+  while (!last)
     {
-      Time current = (*j).GetTime ();
+      // The changes of the medium up to the end of the event (identified by its own change)
+      Time current = event->GetEndTime ();
+      double delta = 0.0;
+      if (j == m_niChanges.end () || (j->first == current && j->second == -powerW))
+        {
+          last = true;
+        }
+      else
+        {
+          current = j->first;
+          delta = j->second;
+        }
       NS_ASSERT (current >= previous);
 
       if (previous >= plcpPayloadStart)
@@ -337,9 +350,12 @@ InterferenceHelper::CalculatePer (Ptr<const InterferenceHelper::Event> event, Ni
             }
         }
 
-      noiseInterferenceW += (*j).GetDelta ();
-      previous = (*j).GetTime ();
-      j++;
+      noiseInterferenceW += delta;
+      previous = current;
+      if (!last)
+        {
+          j++;
+        }
     }
 
   double per = 1 - psr;
@@ -350,8 +366,7 @@ InterferenceHelper::CalculatePer (Ptr<const InterferenceHelper::Event> event, Ni
 struct InterferenceHelper::SnrPer
 InterferenceHelper::CalculateSnrPer (Ptr<InterferenceHelper::Event> event)
 {
-  NiChanges ni;
-  double noiseInterferenceW = CalculateNoiseInterferenceW (event, &ni);
+  double noiseInterferenceW = CalculateNoiseInterferenceW (event);
   double snr = CalculateSnr (event->GetRxPowerW (),
                              noiseInterferenceW,
                              event->GetPayloadMode ());
@@ -359,7 +374,7 @@ InterferenceHelper::CalculateSnrPer (Ptr<InterferenceHelper::Event> event)
   /* calculate the SNIR at the start of the packet and accumulate
    * all SNIR changes in the snir vector.
    */
-  double per = CalculatePer (event, &ni);
+  double per = CalculatePer (event, noiseInterferenceW);
 
   struct SnrPer snrPer;
   snrPer.snr = snr;
@@ -373,17 +388,22 @@ InterferenceHelper::EraseEvents (void)
   m_niChanges.clear ();
   m_rxing = false;
   m_firstPower = 0.0;
-}
-InterferenceHelper::NiChanges::iterator
-InterferenceHelper::GetPosition (Time moment)
-{
-  return std::upper_bound (m_niChanges.begin (), m_niChanges.end (), NiChange (moment, 0));
-
+  m_accumulated = m_niChanges.end ();
+  m_accumulatedPower = 0.0;
 }
 void
-InterferenceHelper::AddNiChangeEvent (NiChange change)
+InterferenceHelper::AddNiChangeEvent (Time time, double delta)
 {
-  m_niChanges.insert (GetPosition (change.GetTime ()), change);
+  // Inserted after the changes at the same time (O(log n))
+  NiChanges::iterator change = m_niChanges.insert (std::make_pair (time, delta));
+  if (time < m_accumulatedUntil)
+    {
+      m_accumulatedPower += delta;
+    }
+  else if (m_accumulated == m_niChanges.end () || time < m_accumulated->first)
+    {
+      m_accumulated = change;
+    }
 }
 void
 InterferenceHelper::NotifyRxStart ()
@@ -21,8 +21,11 @@
 #define INTERFERENCE_HELPER_H
 
 #include <stdint.h>
-#include <vector>
+#include <map>
 #include <list>
+#include <new>
+#include <cstddef>
+#include <functional>
 #include "wifi-mode.h"
 #include "wifi-preamble.h"
 #include "wifi-phy-standard.h"
@@ -55,7 +58,21 @@ public:
     uint32_t GetSize (void) const;
     WifiMode GetPayloadMode (void) const;
     enum WifiPreamble GetPreambleType (void) const;
+
+    /**
+     * Events are recycled through a free list (shared by every InterferenceHelper):
+     * the memory of an event released at the end of its reception is reused by the
+     * next one, instead of going back to the heap.
+     */
+    static void * operator new (size_t size);
+    static void operator delete (void *p);
 private:
+    struct FreeEvent
+    {
+      FreeEvent *next;
+    };
+    static FreeEvent *m_freeEvents;
+
     uint32_t m_size;
     WifiMode m_payloadMode;
     enum WifiPreamble m_preamble;
@@ -97,37 +114,129 @@ private:
   void NotifyRxEnd ();
   void EraseEvents (void);
 private:
-  class NiChange
+  /**
+   * Allocator of the NI change nodes: the released nodes are kept in a free
+   * list (shared by every InterferenceHelper) and reused.
+   */
+  template <typename T>
+  class NiChangeAllocator
   {
 public:
-    NiChange (Time time, double delta);
-    Time GetTime (void) const;
-    double GetDelta (void) const;
-    bool operator < (const NiChange& o) const;
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    template <typename U>
+    struct rebind
+    {
+      typedef NiChangeAllocator<U> other;
+    };
+
+    NiChangeAllocator ()
+    {
+    }
+    template <typename U>
+    NiChangeAllocator (const NiChangeAllocator<U> &)
+    {
+    }
+    pointer address (reference x) const
+    {
+      return &x;
+    }
+    const_pointer address (const_reference x) const
+    {
+      return &x;
+    }
+    pointer allocate (size_type n, const void * = 0)
+    {
+      FreeNode *&freeNodes = GetFreeNodes ();
+      if (n == 1 && freeNodes != 0)
+        {
+          FreeNode *node = freeNodes;
+          freeNodes = node->next;
+          return reinterpret_cast<pointer> (node);
+        }
+      return static_cast<pointer> (::operator new (n * (sizeof (T) > sizeof (FreeNode) ? sizeof (T) : sizeof (FreeNode))));
+    }
+    void deallocate (pointer p, size_type n)
+    {
+      if (n == 1)
+        {
+          FreeNode *node = reinterpret_cast<FreeNode *> (p);
+          node->next = GetFreeNodes ();
+          GetFreeNodes () = node;
+          return;
+        }
+      ::operator delete (p);
+    }
+    size_type max_size () const
+    {
+      return size_type (-1) / sizeof (T);
+    }
+    void construct (pointer p, const T &value)
+    {
+      new (p) T (value);
+    }
+    void destroy (pointer p)
+    {
+      p->~T ();
+    }
+    bool operator == (const NiChangeAllocator &) const
+    {
+      return true;
+    }
+    bool operator != (const NiChangeAllocator &) const
+    {
+      return false;
+    }
 private:
-    Time m_time;
-    double m_delta;
+    struct FreeNode
+    {
+      FreeNode *next;
+    };
+    static FreeNode *& GetFreeNodes (void)
+    {
+      static FreeNode *freeNodes = 0;
+      return freeNodes;
+    }
   };
-  typedef std::vector <NiChange> NiChanges;
+
+  /**
+   * Changes of the noise + interference power (delta, in W) on the medium, in
+   * time order. Changes at the same time are kept in insertion order.
+   */
+  typedef std::multimap<Time, double, std::less<Time>,
+                        NiChangeAllocator<std::pair<const Time, double> > > NiChanges;
   typedef std::list<Ptr<Event> > Events;
 
   InterferenceHelper (const InterferenceHelper &o);
   InterferenceHelper &operator = (const InterferenceHelper &o);
   void AppendEvent (Ptr<Event> event);
-  double CalculateNoiseInterferenceW (Ptr<Event> event, NiChanges *ni) const;
+  double CalculateNoiseInterferenceW (Ptr<Event> event) const;
   double CalculateSnr (double signal, double noiseInterference, WifiMode mode) const;
   double CalculateChunkSuccessRate (double snir, Time delay, WifiMode mode) const;
-  double CalculatePer (Ptr<const Event> event, NiChanges *ni) const;
+  /**
+   * Walk the changes from the start of the event (the first one, since it is
+   * being received) up to its end.
+   */
+  double CalculatePer (Ptr<const Event> event, double noiseInterferenceW) const;
 
   double m_noiseFigure; /**< noise figure (linear) */
   Ptr<ErrorRateModel> m_errorRateModel;
   /// Experimental: needed for energy duration calculation
   NiChanges m_niChanges;
+  /// Power of the changes already removed from m_niChanges
   double m_firstPower;
   bool m_rxing;
-  /// Returns an iterator to the first nichange, which is later than moment
-  NiChanges::iterator GetPosition (Time moment);
-  void AddNiChangeEvent (NiChange change);
+  /// First change whose delta is not in m_accumulatedPower yet
+  NiChanges::iterator m_accumulated;
+  /// Power of the changes of m_niChanges before m_accumulated (all of them earlier than m_accumulatedUntil)
+  double m_accumulatedPower;
+  Time m_accumulatedUntil;
+  void AddNiChangeEvent (Time time, double delta);
 };
 
 } // namespace ns3
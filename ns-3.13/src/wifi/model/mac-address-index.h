@@ -0,0 +1,158 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+#ifndef MAC_ADDRESS_INDEX_H
+#define MAC_ADDRESS_INDEX_H
+
+#include <vector>
+#include <stdint.h>
+#include "ns3/mac48-address.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * Open addressing (linear probing) hash table which maps a 48-bit address
+ * and a TID to per-peer records. The records are not owned by the index,
+ * so that the owner can keep them in a container with stable pointers.
+ */
+template <typename T>
+class MacAddressIndex
+{
+public:
+  MacAddressIndex ();
+  /**
+   * \param address the address of the peer
+   * \param tid the TID, or any other 8-bit discriminator
+   * \returns the key of the address and TID
+   */
+  static uint64_t GetKey (Mac48Address address, uint8_t tid);
+  /// \returns the value of the key, 0 if not found
+  T * Find (uint64_t key) const;
+  void Insert (uint64_t key, T *value);
+  void Clear (void);
+private:
+  static const uint64_t EMPTY = ~(uint64_t) 0;
+  uint32_t GetSlot (uint64_t key) const;
+  void Grow (void);
+  std::vector<uint64_t> m_keys;
+  std::vector<T *> m_values;
+  uint32_t m_size;
+};
+
+template <typename T>
+const uint64_t MacAddressIndex<T>::EMPTY;
+
+template <typename T>
+MacAddressIndex<T>::MacAddressIndex ()
+  : m_keys (16, EMPTY),
+    m_values (16, (T *) 0),
+    m_size (0)
+{
+}
+
+template <typename T>
+uint64_t
+MacAddressIndex<T>::GetKey (Mac48Address address, uint8_t tid)
+{
+  uint8_t buffer[6];
+  address.CopyTo (buffer);
+  uint64_t key = 0;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      key = (key << 8) | buffer[i];
+    }
+  return (key << 8) | tid;
+}
+
+template <typename T>
+uint32_t
+MacAddressIndex<T>::GetSlot (uint64_t key) const
+{
+  // Fibonacci hashing; the capacity is a power of two
+  return (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & (m_keys.size () - 1);
+}
+
+template <typename T>
+T *
+MacAddressIndex<T>::Find (uint64_t key) const
+{
+  for (uint32_t slot = GetSlot (key); m_keys[slot] != EMPTY; slot = (slot + 1) & (m_keys.size () - 1))
+    {
+      if (m_keys[slot] == key)
+        {
+          return m_values[slot];
+        }
+    }
+  return 0;
+}
+
+template <typename T>
+void
+MacAddressIndex<T>::Insert (uint64_t key, T *value)
+{
+  if (2 * (m_size + 1) > m_keys.size ())
+    {
+      Grow ();
+    }
+  uint32_t slot = GetSlot (key);
+  while (m_keys[slot] != EMPTY && m_keys[slot] != key)
+    {
+      slot = (slot + 1) & (m_keys.size () - 1);
+    }
+  if (m_keys[slot] == EMPTY)
+    {
+      m_size++;
+    }
+  m_keys[slot] = key;
+  m_values[slot] = value;
+}
+
+template <typename T>
+void
+MacAddressIndex<T>::Clear (void)
+{
+  m_keys.assign (m_keys.size (), EMPTY);
+  m_values.assign (m_values.size (), (T *) 0);
+  m_size = 0;
+}
+
+template <typename T>
+void
+MacAddressIndex<T>::Grow (void)
+{
+  std::vector<uint64_t> keys (m_keys.size () * 2, EMPTY);
+  std::vector<T *> values (m_values.size () * 2, (T *) 0);
+  keys.swap (m_keys);
+  values.swap (m_values);
+  m_size = 0;
+  for (uint32_t i = 0; i < keys.size (); i++)
+    {
+      if (keys[i] != EMPTY)
+        {
+          Insert (keys[i], values[i]);
+        }
+    }
+}
+
+} // namespace ns3
+
+#endif /* MAC_ADDRESS_INDEX_H */
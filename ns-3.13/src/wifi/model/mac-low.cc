@@ -367,6 +367,11 @@ MacLow::MacLow ()
   m_lastNavDuration = Seconds (0);
   m_lastNavStart = Seconds (0);
   m_promisc = false;
+  m_ackHdr.SetType (WIFI_MAC_CTL_ACK);
+  m_ackHdr.SetDsNotFrom ();
+  m_ackHdr.SetDsNotTo ();
+  m_ackHdr.SetNoRetry ();
+  m_ackHdr.SetNoMoreFragments ();
 }
 
 MacLow::~MacLow ()
@@ -468,6 +473,7 @@ void
 MacLow::SetPhy (Ptr<WifiPhy> phy)
 {
   m_phy = phy;
+  m_ackDurations.clear ();
   m_phy->SetReceiveOkCallback (MakeCallback (&MacLow::ReceiveOk, this));
   m_phy->SetReceiveErrorCallback (MakeCallback (&MacLow::ReceiveError, this));
   SetupPhyMacLowListener (phy);
@@ -958,7 +964,17 @@ Time
 MacLow::GetAckDuration (Mac48Address to, WifiMode dataTxMode) const
 {
   WifiMode ackMode = GetAckTxModeForData (to, dataTxMode);
-  return m_phy->CalculateTxDuration (GetAckSize (), ackMode, WIFI_PREAMBLE_LONG);
+  // ACKs always have the same size, so their duration only depends on the mode
+  uint32_t uid = ackMode.GetUid ();
+  if (uid >= m_ackDurations.size ())
+    {
+      m_ackDurations.resize (uid + 1, Seconds (0));
+    }
+  if (m_ackDurations[uid].IsZero ())
+    {
+      m_ackDurations[uid] = m_phy->CalculateTxDuration (GetAckSize (), ackMode, WIFI_PREAMBLE_LONG);
+    }
+  return m_ackDurations[uid];
 }
 Time
 MacLow::GetBlockAckDuration (Mac48Address to, WifiMode blockAckReqTxMode, enum BlockAckType type) const
@@ -1309,6 +1325,12 @@ MacLow::StartDataTxTimers (void)
 {
   WifiMode dataTxMode = GetDataTxMode (m_currentPacket, &m_currentHdr);
   Time txDuration = m_phy->CalculateTxDuration (GetSize (m_currentPacket, &m_currentHdr), dataTxMode, WIFI_PREAMBLE_LONG);
+  StartDataTxTimers (dataTxMode, txDuration);
+}
+
+void
+MacLow::StartDataTxTimers (WifiMode dataTxMode, Time txDuration)
+{
   if (m_txParams.MustWaitNormalAck ())
     {
       Time timerDelay = txDuration + GetAckTimeout ();
@@ -1361,9 +1383,11 @@ MacLow::SendDataPacket (void)
 {
   NS_LOG_FUNCTION (this);
   /* send this packet directly. No RTS is needed. */
-  StartDataTxTimers ();
-
   WifiMode dataTxMode = GetDataTxMode (m_currentPacket, &m_currentHdr);
+  StartDataTxTimers (dataTxMode,
+                     m_phy->CalculateTxDuration (GetSize (m_currentPacket, &m_currentHdr),
+                                                 dataTxMode, WIFI_PREAMBLE_LONG));
+
   Time duration = Seconds (0.0);
   if (m_txParams.HasDurationId ())
     {
@@ -1461,14 +1485,14 @@ MacLow::SendDataAfterCts (Mac48Address source, Time duration, WifiMode txMode)
    * RTS/CTS/DATA/ACK hanshake
    */
   NS_ASSERT (m_currentPacket != 0);
-  StartDataTxTimers ();
-
   WifiMode dataTxMode = GetDataTxMode (m_currentPacket, &m_currentHdr);
+  Time txDuration = m_phy->CalculateTxDuration (GetSize (m_currentPacket, &m_currentHdr),
+                                                dataTxMode, WIFI_PREAMBLE_LONG);
+  StartDataTxTimers (dataTxMode, txDuration);
+
   Time newDuration = Seconds (0);
   newDuration += GetSifs ();
   newDuration += GetAckDuration (m_currentHdr.GetAddr1 (), dataTxMode);
-  Time txDuration = m_phy->CalculateTxDuration (GetSize (m_currentPacket, &m_currentHdr),
-                                                dataTxMode, WIFI_PREAMBLE_LONG);
   duration -= txDuration;
   duration -= GetSifs ();
 
@@ -1508,12 +1532,7 @@ MacLow::SendAckAfterData (Mac48Address source, Time duration, WifiMode dataTxMod
    * a packet after SIFS.
    */
   WifiMode ackTxMode = GetAckTxModeForData (source, dataTxMode);
-  WifiMacHeader ack;
-  ack.SetType (WIFI_MAC_CTL_ACK);
-  ack.SetDsNotFrom ();
-  ack.SetDsNotTo ();
-  ack.SetNoRetry ();
-  ack.SetNoMoreFragments ();
+  WifiMacHeader ack = m_ackHdr;
   ack.SetAddr1 (source);
   duration -= GetAckDuration (source, dataTxMode);
   duration -= GetSifs ();
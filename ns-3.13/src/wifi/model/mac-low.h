@@ -551,6 +551,14 @@ private:
   void SendDataPacket (void);
   void SendCurrentTxPacket (void);
   void StartDataTxTimers (void);
+  /**
+   * \param dataTxMode the mode of the current data frame
+   * \param txDuration the transmission time of the current data frame
+   *
+   * Same as StartDataTxTimers (void), for callers which already know the
+   * mode and transmission time of the frame.
+   */
+  void StartDataTxTimers (WifiMode dataTxMode, Time txDuration);
   virtual void DoDispose (void);
   /**
    * \param originator Address of peer participating in Block Ack mechanism.
@@ -623,6 +631,10 @@ private:
 
   Ptr<Packet> m_currentPacket;
   WifiMacHeader m_currentHdr;
+  // ACK frame with the fields which are the same for all the ACKs
+  WifiMacHeader m_ackHdr;
+  // ACK transmission times, indexed by the uid of the ACK mode (zero if unknown)
+  mutable std::vector<Time> m_ackDurations;
   MacLowTransmissionParameters m_txParams;
   MacLowTransmissionListener *m_listener;
   Mac48Address m_self;
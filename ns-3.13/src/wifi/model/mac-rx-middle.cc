@@ -26,18 +26,22 @@
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
 #include "ns3/sequence-number.h"
-#include <list>
 
 NS_LOG_COMPONENT_DEFINE ("MacRxMiddle");
 
 namespace ns3 {
 
+namespace {
+// TID of the originator records of frames other than unicast QoS data
+const uint8_t NON_QOS = 0xff;
+} // anonymous namespace
 
 class OriginatorRxStatus
 {
 private:
-  typedef std::list<Ptr<const Packet> > Fragments;
-  typedef std::list<Ptr<const Packet> >::const_iterator FragmentsCI;
+  // cleared, rather than freed, between MSDUs so that its storage is reused
+  typedef std::vector<Ptr<const Packet> > Fragments;
+  typedef std::vector<Ptr<const Packet> >::const_iterator FragmentsCI;
 
   bool m_defragmenting;
   uint16_t m_lastSequenceControl;
@@ -68,12 +72,13 @@ public:
     NS_ASSERT (m_defragmenting);
     m_fragments.push_back (packet);
     m_defragmenting = false;
-    Ptr<Packet> full = Create<Packet> ();
-    for (FragmentsCI i = m_fragments.begin (); i != m_fragments.end (); i++)
+    FragmentsCI i = m_fragments.begin ();
+    Ptr<Packet> full = (*i)->Copy ();
+    for (i++; i != m_fragments.end (); i++)
       {
         full->AddAtEnd (*i);
       }
-    m_fragments.erase (m_fragments.begin (), m_fragments.end ());
+    m_fragments.clear ();
     return full;
   }
   void AccumulateFragment (Ptr<const Packet> packet)
@@ -113,20 +118,13 @@ MacRxMiddle::MacRxMiddle ()
 MacRxMiddle::~MacRxMiddle ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  for (OriginatorsI i = m_originatorStatus.begin ();
-       i != m_originatorStatus.end (); i++)
-    {
-      delete (*i).second;
-    }
-  m_originatorStatus.erase (m_originatorStatus.begin (),
-                            m_originatorStatus.end ());
-  for (QosOriginatorsI i = m_qosOriginatorStatus.begin ();
-       i != m_qosOriginatorStatus.end (); i++)
+  for (Originators::const_iterator i = m_originators.begin ();
+       i != m_originators.end (); i++)
     {
-      delete (*i).second;
+      delete (*i);
     }
-  m_qosOriginatorStatus.erase (m_qosOriginatorStatus.begin (),
-                               m_qosOriginatorStatus.end ());
+  m_originators.clear ();
+  m_originatorIndex.Clear ();
 }
 
 void
@@ -140,18 +138,13 @@ OriginatorRxStatus *
 MacRxMiddle::Lookup (const WifiMacHeader *hdr)
 {
   NS_LOG_FUNCTION (hdr);
-  OriginatorRxStatus *originator;
   Mac48Address source = hdr->GetAddr2 ();
+  uint8_t tid;
   if (hdr->IsQosData ()
       && !hdr->GetAddr2 ().IsGroup ())
     {
       /* only for qos data non-broadcast frames */
-      originator = m_qosOriginatorStatus[std::make_pair (source, hdr->GetQosTid ())];
-      if (originator == 0)
-        {
-          originator = new OriginatorRxStatus ();
-          m_qosOriginatorStatus[std::make_pair (source, hdr->GetQosTid ())] = originator;
-        }
+      tid = hdr->GetQosTid ();
     }
   else
     {
@@ -160,12 +153,15 @@ MacRxMiddle::Lookup (const WifiMacHeader *hdr)
        * - nqos data frames
        * see section 7.1.3.4.1
        */
-      originator = m_originatorStatus[source];
-      if (originator == 0)
-        {
-          originator = new OriginatorRxStatus ();
-          m_originatorStatus[source] = originator;
-        }
+      tid = NON_QOS;
+    }
+  uint64_t key = MacAddressIndex<OriginatorRxStatus>::GetKey (source, tid);
+  OriginatorRxStatus *originator = m_originatorIndex.Find (key);
+  if (originator == 0)
+    {
+      originator = new OriginatorRxStatus ();
+      m_originators.push_back (originator);
+      m_originatorIndex.Insert (key, originator);
     }
   return originator;
 }
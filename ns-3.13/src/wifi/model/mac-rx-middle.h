@@ -21,11 +21,11 @@
 #ifndef MAC_RX_MIDDLE_H
 #define MAC_RX_MIDDLE_H
 
-#include <map>
-#include <utility>
+#include <vector>
 #include "ns3/callback.h"
 #include "ns3/mac48-address.h"
 #include "ns3/packet.h"
+#include "mac-address-index.h"
 
 namespace ns3 {
 
@@ -55,12 +55,12 @@ private:
   Ptr<Packet> HandleFragments (Ptr<Packet> packet, const WifiMacHeader* hdr,
                                OriginatorRxStatus *originator);
 
-  typedef std::map <Mac48Address, OriginatorRxStatus *, std::less<Mac48Address> > Originators;
-  typedef std::map <std::pair<Mac48Address, uint8_t>, OriginatorRxStatus *, std::less<std::pair<Mac48Address,uint8_t> > > QosOriginators;
-  typedef std::map <Mac48Address, OriginatorRxStatus *, std::less<Mac48Address> >::iterator OriginatorsI;
-  typedef std::map <std::pair<Mac48Address, uint8_t>, OriginatorRxStatus *, std::less<std::pair<Mac48Address,uint8_t> > >::iterator QosOriginatorsI;
-  Originators m_originatorStatus;
-  QosOriginators m_qosOriginatorStatus;
+  typedef std::vector<OriginatorRxStatus *> Originators;
+
+  // owns the originator records, which are indexed by source address and
+  // TID (QoS data) or NON_QOS (other frames)
+  Originators m_originators;
+  MacAddressIndex<OriginatorRxStatus> m_originatorIndex;
   ForwardUpCallback m_callback;
 };
 
@@ -38,6 +38,7 @@
 #include "ns3/wifi-mac.h"
 #include "ns3/assert.h"
 #include <vector>
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE ("MinstrelWifiManager");
 
@@ -77,6 +78,26 @@ struct MinstrelWifiRemoteStation : public WifiRemoteStation
   bool m_initialized;  ///< for initializing tables
 };
 
+MinstrelRate::MinstrelRate ()
+{
+}
+
+MinstrelRate::MinstrelRate (uint32_t nRates)
+  : perfectTxTime (nRates),
+    retryCount (nRates, 0),
+    adjustedRetryCount (nRates, 0),
+    numRateAttempt (nRates, 0),
+    numRateSuccess (nRates, 0),
+    prob (nRates, 0),
+    ewmaProb (nRates, 0),
+    prevNumRateAttempt (nRates, 0),
+    prevNumRateSuccess (nRates, 0),
+    successHist (nRates, 0),
+    attemptHist (nRates, 0),
+    throughput (nRates, 0)
+{
+}
+
 NS_OBJECT_ENSURE_REGISTERED (MinstrelWifiManager);
 
 TypeId
@@ -269,30 +290,30 @@ MinstrelWifiManager::DoReportDataFailed (WifiRemoteStation *st)
   if (!station->m_isSampling)
     {
       /// use best throughput rate
-      if (station->m_longRetry < m_minstrelTable[station->m_txrate].adjustedRetryCount)
+      if (station->m_longRetry < m_minstrelTable.adjustedRetryCount[station->m_txrate])
         {
           ;  ///<  there's still a few retries left
         }
 
       /// use second best throughput rate
-      else if (station->m_longRetry <= (m_minstrelTable[station->m_txrate].adjustedRetryCount +
-                                        m_minstrelTable[station->m_maxTpRate].adjustedRetryCount))
+      else if (station->m_longRetry <= (m_minstrelTable.adjustedRetryCount[station->m_txrate] +
+                                        m_minstrelTable.adjustedRetryCount[station->m_maxTpRate]))
         {
           station->m_txrate = station->m_maxTpRate2;
         }
 
       /// use best probability rate
-      else if (station->m_longRetry <= (m_minstrelTable[station->m_txrate].adjustedRetryCount +
-                                        m_minstrelTable[station->m_maxTpRate2].adjustedRetryCount +
-                                        m_minstrelTable[station->m_maxTpRate].adjustedRetryCount))
+      else if (station->m_longRetry <= (m_minstrelTable.adjustedRetryCount[station->m_txrate] +
+                                        m_minstrelTable.adjustedRetryCount[station->m_maxTpRate2] +
+                                        m_minstrelTable.adjustedRetryCount[station->m_maxTpRate]))
         {
           station->m_txrate = station->m_maxProbRate;
         }
 
       /// use lowest base rate
-      else if (station->m_longRetry > (m_minstrelTable[station->m_txrate].adjustedRetryCount +
-                                       m_minstrelTable[station->m_maxTpRate2].adjustedRetryCount +
-                                       m_minstrelTable[station->m_maxTpRate].adjustedRetryCount))
+      else if (station->m_longRetry > (m_minstrelTable.adjustedRetryCount[station->m_txrate] +
+                                       m_minstrelTable.adjustedRetryCount[station->m_maxTpRate2] +
+                                       m_minstrelTable.adjustedRetryCount[station->m_maxTpRate]))
         {
           station->m_txrate = 0;
         }
@@ -305,30 +326,30 @@ MinstrelWifiManager::DoReportDataFailed (WifiRemoteStation *st)
       if (station->m_sampleRateSlower)
         {
           /// use best throughput rate
-          if (station->m_longRetry < m_minstrelTable[station->m_txrate].adjustedRetryCount)
+          if (station->m_longRetry < m_minstrelTable.adjustedRetryCount[station->m_txrate])
             {
               ; ///<  there are a few retries left
             }
 
           ///	use random rate
-          else if (station->m_longRetry <= (m_minstrelTable[station->m_txrate].adjustedRetryCount +
-                                            m_minstrelTable[station->m_maxTpRate].adjustedRetryCount))
+          else if (station->m_longRetry <= (m_minstrelTable.adjustedRetryCount[station->m_txrate] +
+                                            m_minstrelTable.adjustedRetryCount[station->m_maxTpRate]))
             {
               station->m_txrate = station->m_sampleRate;
             }
 
           /// use max probability rate
-          else if (station->m_longRetry <= (m_minstrelTable[station->m_txrate].adjustedRetryCount +
-                                            m_minstrelTable[station->m_sampleRate].adjustedRetryCount +
-                                            m_minstrelTable[station->m_maxTpRate].adjustedRetryCount ))
+          else if (station->m_longRetry <= (m_minstrelTable.adjustedRetryCount[station->m_txrate] +
+                                            m_minstrelTable.adjustedRetryCount[station->m_sampleRate] +
+                                            m_minstrelTable.adjustedRetryCount[station->m_maxTpRate] ))
             {
               station->m_txrate = station->m_maxProbRate;
             }
 
           /// use lowest base rate
-          else if (station->m_longRetry > (m_minstrelTable[station->m_txrate].adjustedRetryCount +
-                                           m_minstrelTable[station->m_sampleRate].adjustedRetryCount +
-                                           m_minstrelTable[station->m_maxTpRate].adjustedRetryCount))
+          else if (station->m_longRetry > (m_minstrelTable.adjustedRetryCount[station->m_txrate] +
+                                           m_minstrelTable.adjustedRetryCount[station->m_sampleRate] +
+                                           m_minstrelTable.adjustedRetryCount[station->m_maxTpRate]))
             {
               station->m_txrate = 0;
             }
@@ -338,30 +359,30 @@ MinstrelWifiManager::DoReportDataFailed (WifiRemoteStation *st)
       else
         {
           /// use random rate
-          if (station->m_longRetry < m_minstrelTable[station->m_txrate].adjustedRetryCount)
+          if (station->m_longRetry < m_minstrelTable.adjustedRetryCount[station->m_txrate])
             {
               ;    ///< keep using it
             }
 
           /// use the best rate
-          else if (station->m_longRetry <= (m_minstrelTable[station->m_txrate].adjustedRetryCount +
-                                            m_minstrelTable[station->m_sampleRate].adjustedRetryCount))
+          else if (station->m_longRetry <= (m_minstrelTable.adjustedRetryCount[station->m_txrate] +
+                                            m_minstrelTable.adjustedRetryCount[station->m_sampleRate]))
             {
               station->m_txrate = station->m_maxTpRate;
             }
 
           /// use the best probability rate
-          else if (station->m_longRetry <= (m_minstrelTable[station->m_txrate].adjustedRetryCount +
-                                            m_minstrelTable[station->m_maxTpRate].adjustedRetryCount +
-                                            m_minstrelTable[station->m_sampleRate].adjustedRetryCount))
+          else if (station->m_longRetry <= (m_minstrelTable.adjustedRetryCount[station->m_txrate] +
+                                            m_minstrelTable.adjustedRetryCount[station->m_maxTpRate] +
+                                            m_minstrelTable.adjustedRetryCount[station->m_sampleRate]))
             {
               station->m_txrate = station->m_maxProbRate;
             }
 
           /// use the lowest base rate
-          else if (station->m_longRetry > (m_minstrelTable[station->m_txrate].adjustedRetryCount +
-                                           m_minstrelTable[station->m_maxTpRate].adjustedRetryCount +
-                                           m_minstrelTable[station->m_sampleRate].adjustedRetryCount))
+          else if (station->m_longRetry > (m_minstrelTable.adjustedRetryCount[station->m_txrate] +
+                                           m_minstrelTable.adjustedRetryCount[station->m_maxTpRate] +
+                                           m_minstrelTable.adjustedRetryCount[station->m_sampleRate]))
             {
               station->m_txrate = 0;
             }
@@ -384,12 +405,12 @@ MinstrelWifiManager::DoReportDataOk (WifiRemoteStation *st,
       return;
     }
 
-  m_minstrelTable[station->m_txrate].numRateSuccess++;
-  m_minstrelTable[station->m_txrate].numRateAttempt++;
+  m_minstrelTable.numRateSuccess[station->m_txrate]++;
+  m_minstrelTable.numRateAttempt[station->m_txrate]++;
 
   UpdateRetry (station);
 
-  m_minstrelTable[station->m_txrate].numRateAttempt += station->m_retry;
+  m_minstrelTable.numRateAttempt[station->m_txrate] += station->m_retry;
   station->m_packetCount++;
 
   if (m_nsupported >= 1)
@@ -409,7 +430,7 @@ MinstrelWifiManager::DoReportFinalDataFailed (WifiRemoteStation *st)
 
   UpdateRetry (station);
 
-  m_minstrelTable[station->m_txrate].numRateAttempt += station->m_retry;
+  m_minstrelTable.numRateAttempt[station->m_txrate] += station->m_retry;
   station->m_err++;
 
   if (m_nsupported >= 1)
@@ -541,7 +562,7 @@ MinstrelWifiManager::FindRate (MinstrelWifiRemoteStation *station)
 
           /// is this rate slower than the current best rate
           station->m_sampleRateSlower =
-            (m_minstrelTable[idx].perfectTxTime > m_minstrelTable[station->m_maxTpRate].perfectTxTime);
+            (m_minstrelTable.perfectTxTime[idx] > m_minstrelTable.perfectTxTime[station->m_maxTpRate]);
 
           /// using the best rate instead
           if (station->m_sampleRateSlower)
@@ -580,99 +601,94 @@ MinstrelWifiManager::UpdateStats (MinstrelWifiRemoteStation *station)
 
   station->m_nextStatsUpdate = Simulator::Now () + m_updateStats;
 
-  Time txTime;
+  MinstrelRate &table = m_minstrelTable;
   uint32_t tempProb;
+  uint32_t max_prob = 0, index_max_prob = 0, max_tp = 0, index_max_tp = 0, index_max_tp2 = 0;
 
+  /**
+   * update the statistics of every rate, and go find max throughput and
+   * high probability succ in the same pass, since the statistics of a rate
+   * are final once updated
+   */
   for (uint32_t i = 0; i < m_nsupported; i++)
     {
 
       /// calculate the perfect tx time for this rate
-      txTime = m_minstrelTable[i].perfectTxTime;
+      int64_t txTimeUs = table.perfectTxTime[i].GetMicroSeconds ();
 
       /// just for initialization
-      if (txTime.GetMicroSeconds () == 0)
+      if (txTimeUs == 0)
         {
-          txTime = Seconds (1);
+          txTimeUs = 1000000;
         }
 
       NS_LOG_DEBUG ("m_txrate=" << station->m_txrate <<
-                    "\t attempt=" << m_minstrelTable[i].numRateAttempt <<
-                    "\t success=" << m_minstrelTable[i].numRateSuccess);
+                    "\t attempt=" << table.numRateAttempt[i] <<
+                    "\t success=" << table.numRateSuccess[i]);
 
       /// if we've attempted something
-      if (m_minstrelTable[i].numRateAttempt)
+      if (table.numRateAttempt[i])
         {
           /**
            * calculate the probability of success
            * assume probability scales from 0 to 18000
            */
-          tempProb = (m_minstrelTable[i].numRateSuccess * 18000) / m_minstrelTable[i].numRateAttempt;
+          tempProb = (table.numRateSuccess[i] * 18000) / table.numRateAttempt[i];
 
           /// bookeeping
-          m_minstrelTable[i].successHist += m_minstrelTable[i].numRateSuccess;
-          m_minstrelTable[i].attemptHist += m_minstrelTable[i].numRateAttempt;
-          m_minstrelTable[i].prob = tempProb;
+          table.successHist[i] += table.numRateSuccess[i];
+          table.attemptHist[i] += table.numRateAttempt[i];
+          table.prob[i] = tempProb;
 
           /// ewma probability (cast for gcc 3.4 compatibility)
-          tempProb = static_cast<uint32_t> (((tempProb * (100 - m_ewmaLevel)) + (m_minstrelTable[i].ewmaProb * m_ewmaLevel) ) / 100);
+          tempProb = static_cast<uint32_t> (((tempProb * (100 - m_ewmaLevel)) + (table.ewmaProb[i] * m_ewmaLevel) ) / 100);
 
-          m_minstrelTable[i].ewmaProb = tempProb;
+          table.ewmaProb[i] = tempProb;
 
           /// calculating throughput
-          m_minstrelTable[i].throughput = tempProb * (1000000 / txTime.GetMicroSeconds ());
+          table.throughput[i] = tempProb * (1000000 / txTimeUs);
 
         }
 
       /// bookeeping
-      m_minstrelTable[i].prevNumRateAttempt = m_minstrelTable[i].numRateAttempt;
-      m_minstrelTable[i].prevNumRateSuccess = m_minstrelTable[i].numRateSuccess;
-      m_minstrelTable[i].numRateSuccess = 0;
-      m_minstrelTable[i].numRateAttempt = 0;
+      table.prevNumRateAttempt[i] = table.numRateAttempt[i];
+      table.prevNumRateSuccess[i] = table.numRateSuccess[i];
+      table.numRateSuccess[i] = 0;
+      table.numRateAttempt[i] = 0;
 
       /// Sample less often below 10% and  above 95% of success
-      if ((m_minstrelTable[i].ewmaProb > 17100) || (m_minstrelTable[i].ewmaProb < 1800))
+      if ((table.ewmaProb[i] > 17100) || (table.ewmaProb[i] < 1800))
         {
           /**
            * retry count denotes the number of retries permitted for each rate
            * # retry_count/2
            */
-          m_minstrelTable[i].adjustedRetryCount = m_minstrelTable[i].retryCount >> 1;
-          if (m_minstrelTable[i].adjustedRetryCount > 2)
-            {
-              m_minstrelTable[i].adjustedRetryCount = 2;
-            }
+          table.adjustedRetryCount[i] = std::min (table.retryCount[i] >> 1, (uint32_t) 2);
         }
       else
         {
-          m_minstrelTable[i].adjustedRetryCount = m_minstrelTable[i].retryCount;
+          table.adjustedRetryCount[i] = table.retryCount[i];
         }
 
       /// if it's 0 allow one retry limit
-      if (m_minstrelTable[i].adjustedRetryCount == 0)
+      if (table.adjustedRetryCount[i] == 0)
         {
-          m_minstrelTable[i].adjustedRetryCount = 1;
+          table.adjustedRetryCount[i] = 1;
         }
-    }
-
 
-  uint32_t max_prob = 0, index_max_prob = 0, max_tp = 0, index_max_tp = 0, index_max_tp2 = 0;
-
-  /// go find max throughput, second maximum throughput, high probability succ
-  for (uint32_t i = 0; i < m_nsupported; i++)
-    {
-      NS_LOG_DEBUG ("throughput" << m_minstrelTable[i].throughput <<
-                    "\n ewma" << m_minstrelTable[i].ewmaProb);
+      NS_LOG_DEBUG ("throughput" << table.throughput[i] <<
+                    "\n ewma" << table.ewmaProb[i]);
 
-      if (max_tp < m_minstrelTable[i].throughput)
+      if (max_tp < table.throughput[i])
         {
           index_max_tp = i;
-          max_tp = m_minstrelTable[i].throughput;
+          max_tp = table.throughput[i];
         }
 
-      if (max_prob < m_minstrelTable[i].ewmaProb)
+      if (max_prob < table.ewmaProb[i])
         {
           index_max_prob = i;
-          max_prob = m_minstrelTable[i].ewmaProb;
+          max_prob = table.ewmaProb[i];
         }
     }
 
@@ -681,10 +697,10 @@ MinstrelWifiManager::UpdateStats (MinstrelWifiRemoteStation *station)
   /// find the second highest max
   for (uint32_t i = 0; i < m_nsupported; i++)
     {
-      if ((i != index_max_tp) && (max_tp < m_minstrelTable[i].throughput))
+      if ((i != index_max_tp) && (max_tp < table.throughput[i]))
         {
           index_max_tp2 = i;
-          max_tp = m_minstrelTable[i].throughput;
+          max_tp = table.throughput[i];
         }
     }
 
@@ -709,20 +725,22 @@ MinstrelWifiManager::RateInit (MinstrelWifiRemoteStation *station)
 {
   NS_LOG_DEBUG ("RateInit=" << station);
 
+  MinstrelRate &table = m_minstrelTable;
+  table.numRateAttempt.assign (m_nsupported, 0);
+  table.numRateSuccess.assign (m_nsupported, 0);
+  table.prob.assign (m_nsupported, 0);
+  table.ewmaProb.assign (m_nsupported, 0);
+  table.prevNumRateAttempt.assign (m_nsupported, 0);
+  table.prevNumRateSuccess.assign (m_nsupported, 0);
+  table.successHist.assign (m_nsupported, 0);
+  table.attemptHist.assign (m_nsupported, 0);
+  table.throughput.assign (m_nsupported, 0);
+  table.retryCount.assign (m_nsupported, 1);
+  table.adjustedRetryCount.assign (m_nsupported, 1);
+  table.perfectTxTime.resize (m_nsupported);
   for (uint32_t i = 0; i < m_nsupported; i++)
     {
-      m_minstrelTable[i].numRateAttempt = 0;
-      m_minstrelTable[i].numRateSuccess = 0;
-      m_minstrelTable[i].prob = 0;
-      m_minstrelTable[i].ewmaProb = 0;
-      m_minstrelTable[i].prevNumRateAttempt = 0;
-      m_minstrelTable[i].prevNumRateSuccess = 0;
-      m_minstrelTable[i].successHist = 0;
-      m_minstrelTable[i].attemptHist = 0;
-      m_minstrelTable[i].throughput = 0;
-      m_minstrelTable[i].perfectTxTime = GetCalcTxTime (GetSupported (station, i));
-      m_minstrelTable[i].retryCount = 1;
-      m_minstrelTable[i].adjustedRetryCount = 1;
+      table.perfectTxTime[i] = GetCalcTxTime (GetSupported (station, i));
     }
 }
 
@@ -783,7 +801,7 @@ MinstrelWifiManager::PrintTable (MinstrelWifiRemoteStation *station)
 
   for (uint32_t i = 0; i < m_nsupported; i++)
     {
-      std::cout << "index(" << i << ") = " << m_minstrelTable[i].perfectTxTime << "\n";
+      std::cout << "index(" << i << ") = " << m_minstrelTable.perfectTxTime[i] << "\n";
     }
 }
 
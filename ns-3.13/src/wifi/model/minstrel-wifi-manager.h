@@ -35,42 +35,42 @@ namespace ns3 {
 struct MinstrelWifiRemoteStation;
 
 /**
- * A struct to contain all information related to a data rate
+ * Data structure for a Minstrel Rate table, with one entry per supported
+ * rate. Each statistic is kept in its own array (structure of arrays) so
+ * that the periodic update and the searches for the best rates walk
+ * contiguous data.
  */
-struct RateInfo
+struct MinstrelRate
 {
+  MinstrelRate ();
+  MinstrelRate (uint32_t nRates);
+
   /**
    * Perfect transmission time calculation, or frame calculation
    * Given a bit rate and a packet length n bytes
    */
-  Time perfectTxTime;
+  std::vector<Time> perfectTxTime;
 
 
-  uint32_t retryCount;  ///< retry limit
-  uint32_t adjustedRetryCount;  ///< adjust the retry limit for this rate
-  uint32_t numRateAttempt;  ///< how many number of attempts so far
-  uint32_t numRateSuccess;    ///< number of successful pkts
-  uint32_t prob;  ///< (# pkts success )/(# total pkts)
+  std::vector<uint32_t> retryCount;  ///< retry limit
+  std::vector<uint32_t> adjustedRetryCount;  ///< adjust the retry limit for this rate
+  std::vector<uint32_t> numRateAttempt;  ///< how many number of attempts so far
+  std::vector<uint32_t> numRateSuccess;    ///< number of successful pkts
+  std::vector<uint32_t> prob;  ///< (# pkts success )/(# total pkts)
 
   /**
    * EWMA calculation
    * ewma_prob =[prob *(100 - ewma_level) + (ewma_prob_old * ewma_level)]/100
    */
-  uint32_t ewmaProb;
+  std::vector<uint32_t> ewmaProb;
 
-  uint32_t prevNumRateAttempt;  ///< from last rate
-  uint32_t prevNumRateSuccess;  ///< from last rate
-  uint64_t successHist;  ///< aggregate of all successes
-  uint64_t attemptHist;  ///< aggregate of all attempts
-  uint32_t throughput;  ///< throughput of a rate
+  std::vector<uint32_t> prevNumRateAttempt;  ///< from last rate
+  std::vector<uint32_t> prevNumRateSuccess;  ///< from last rate
+  std::vector<uint64_t> successHist;  ///< aggregate of all successes
+  std::vector<uint64_t> attemptHist;  ///< aggregate of all attempts
+  std::vector<uint32_t> throughput;  ///< throughput of a rate
 };
 
-/**
- * Data structure for a Minstrel Rate table
- * A vector of a struct RateInfo
- */
-typedef std::vector<struct RateInfo> MinstrelRate;
-
 /**
  * Data structure for a Sample Rate table
  * A vector of a vector uint32_t
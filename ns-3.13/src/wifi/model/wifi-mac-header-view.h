@@ -0,0 +1,352 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2013 Universidad de Cantabria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: David Gómez Fernández <dgomez@tlmat.unican.es>
+ *         Ramón Agüero Calvo <ramon@tlmat.unican.es>
+ */
+#ifndef WIFI_MAC_HEADER_VIEW_H
+#define WIFI_MAC_HEADER_VIEW_H
+
+#include <stdint.h>
+#include "ns3/assert.h"
+#include "ns3/packet.h"
+#include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * Read-only view over the serialized bytes of a WifiMacHeader. The
+ * fields are read in place (at fixed offsets) when queried, so that the
+ * readers which only need the type, the addresses or the sequence control
+ * of a received frame neither deserialize the header nor allocate memory.
+ * The accessors follow the semantics of the WifiMacHeader ones; the
+ * addresses not carried by the frame are returned as 00:00:00:00:00:00.
+ */
+class WifiMacHeaderView
+{
+public:
+  /// Offsets (bytes) of the fields within the serialized header
+  enum
+  {
+    OFFSET_FRAME_CONTROL = 0,
+    OFFSET_DURATION = 2,
+    OFFSET_ADDR1 = 4,
+    OFFSET_ADDR2 = 10,
+    OFFSET_ADDR3 = 16,
+    OFFSET_SEQUENCE_CONTROL = 22,
+    OFFSET_ADDR4 = 24,
+    /// largest header: four addresses and QoS control
+    MAX_SIZE = 32
+  };
+
+  WifiMacHeaderView ();
+  /**
+   * \param packet the packet whose first bytes hold a WifiMacHeader
+   */
+  explicit WifiMacHeaderView (Ptr<const Packet> packet);
+  /**
+   * \param packet the packet whose first bytes hold a WifiMacHeader
+   * \returns false if the packet is too short to hold a header
+   */
+  bool Peek (Ptr<const Packet> packet);
+
+  bool IsCtl (void) const;
+  bool IsMgt (void) const;
+  bool IsData (void) const;
+  bool IsQosData (void) const;
+  bool IsRts (void) const;
+  bool IsCts (void) const;
+  bool IsAck (void) const;
+  bool IsBlockAckReq (void) const;
+  bool IsBlockAck (void) const;
+  bool IsToDs (void) const;
+  bool IsFromDs (void) const;
+  bool IsMoreFragments (void) const;
+  bool IsRetry (void) const;
+  bool IsQosAmsdu (void) const;
+  uint8_t GetQosTid (void) const;
+  Time GetDuration (void) const;
+  uint16_t GetSequenceNumber (void) const;
+  uint16_t GetFragmentNumber (void) const;
+  Mac48Address GetAddr1 (void) const;
+  Mac48Address GetAddr2 (void) const;
+  Mac48Address GetAddr3 (void) const;
+  Mac48Address GetAddr4 (void) const;
+  /**
+   * \returns the size of the serialized header, i.e. the bytes to remove
+   * from the packet to reach the payload
+   */
+  uint32_t GetSize (void) const;
+
+private:
+  enum
+  {
+    TYPE_MGT = 0,
+    TYPE_CTL = 1,
+    TYPE_DATA = 2
+  };
+  enum
+  {
+    SUBTYPE_CTL_BACKREQ = 8,
+    SUBTYPE_CTL_BACKRESP = 9,
+    SUBTYPE_CTL_RTS = 11,
+    SUBTYPE_CTL_CTS = 12,
+    SUBTYPE_CTL_ACK = 13
+  };
+  uint8_t GetFrameType (void) const;
+  uint8_t GetFrameSubtype (void) const;
+  uint16_t ReadU16 (uint32_t offset) const;
+  Mac48Address ReadAddress (uint32_t offset) const;
+  uint32_t GetQosControlOffset (void) const;
+
+  uint8_t m_bytes[MAX_SIZE];
+};
+
+} // namespace ns3
+
+namespace ns3 {
+
+inline
+WifiMacHeaderView::WifiMacHeaderView ()
+{
+  m_bytes[OFFSET_FRAME_CONTROL] = 0;
+  m_bytes[OFFSET_FRAME_CONTROL + 1] = 0;
+}
+
+inline
+WifiMacHeaderView::WifiMacHeaderView (Ptr<const Packet> packet)
+{
+  Peek (packet);
+}
+
+inline bool
+WifiMacHeaderView::Peek (Ptr<const Packet> packet)
+{
+  uint32_t copied = packet->CopyData (m_bytes, MAX_SIZE);
+  for (uint32_t i = copied; i < MAX_SIZE; i++)
+    {
+      m_bytes[i] = 0;
+    }
+  return copied >= GetSize ();
+}
+
+inline uint16_t
+WifiMacHeaderView::ReadU16 (uint32_t offset) const
+{
+  // serialized little endian (Buffer::Iterator::WriteHtolsbU16)
+  return m_bytes[offset] | (m_bytes[offset + 1] << 8);
+}
+
+inline Mac48Address
+WifiMacHeaderView::ReadAddress (uint32_t offset) const
+{
+  Mac48Address address;
+  address.CopyFrom (m_bytes + offset);
+  return address;
+}
+
+inline uint8_t
+WifiMacHeaderView::GetFrameType (void) const
+{
+  return (m_bytes[OFFSET_FRAME_CONTROL] >> 2) & 0x03;
+}
+
+inline uint8_t
+WifiMacHeaderView::GetFrameSubtype (void) const
+{
+  return (m_bytes[OFFSET_FRAME_CONTROL] >> 4) & 0x0f;
+}
+
+inline bool
+WifiMacHeaderView::IsCtl (void) const
+{
+  return GetFrameType () == TYPE_CTL;
+}
+
+inline bool
+WifiMacHeaderView::IsMgt (void) const
+{
+  return GetFrameType () == TYPE_MGT;
+}
+
+inline bool
+WifiMacHeaderView::IsData (void) const
+{
+  return GetFrameType () == TYPE_DATA;
+}
+
+inline bool
+WifiMacHeaderView::IsQosData (void) const
+{
+  return IsData () && (GetFrameSubtype () & 0x08);
+}
+
+inline bool
+WifiMacHeaderView::IsRts (void) const
+{
+  return IsCtl () && GetFrameSubtype () == SUBTYPE_CTL_RTS;
+}
+
+inline bool
+WifiMacHeaderView::IsCts (void) const
+{
+  return IsCtl () && GetFrameSubtype () == SUBTYPE_CTL_CTS;
+}
+
+inline bool
+WifiMacHeaderView::IsAck (void) const
+{
+  return IsCtl () && GetFrameSubtype () == SUBTYPE_CTL_ACK;
+}
+
+inline bool
+WifiMacHeaderView::IsBlockAckReq (void) const
+{
+  return IsCtl () && GetFrameSubtype () == SUBTYPE_CTL_BACKREQ;
+}
+
+inline bool
+WifiMacHeaderView::IsBlockAck (void) const
+{
+  return IsCtl () && GetFrameSubtype () == SUBTYPE_CTL_BACKRESP;
+}
+
+inline bool
+WifiMacHeaderView::IsToDs (void) const
+{
+  return m_bytes[OFFSET_FRAME_CONTROL + 1] & 0x01;
+}
+
+inline bool
+WifiMacHeaderView::IsFromDs (void) const
+{
+  return m_bytes[OFFSET_FRAME_CONTROL + 1] & 0x02;
+}
+
+inline bool
+WifiMacHeaderView::IsMoreFragments (void) const
+{
+  return m_bytes[OFFSET_FRAME_CONTROL + 1] & 0x04;
+}
+
+inline bool
+WifiMacHeaderView::IsRetry (void) const
+{
+  return m_bytes[OFFSET_FRAME_CONTROL + 1] & 0x08;
+}
+
+inline uint32_t
+WifiMacHeaderView::GetQosControlOffset (void) const
+{
+  return (IsToDs () && IsFromDs ()) ? OFFSET_ADDR4 + 6 : OFFSET_ADDR4;
+}
+
+inline bool
+WifiMacHeaderView::IsQosAmsdu (void) const
+{
+  NS_ASSERT (IsQosData ());
+  return m_bytes[GetQosControlOffset ()] & 0x80;
+}
+
+inline uint8_t
+WifiMacHeaderView::GetQosTid (void) const
+{
+  NS_ASSERT (IsQosData ());
+  return m_bytes[GetQosControlOffset ()] & 0x0f;
+}
+
+inline Time
+WifiMacHeaderView::GetDuration (void) const
+{
+  return MicroSeconds (ReadU16 (OFFSET_DURATION));
+}
+
+inline uint16_t
+WifiMacHeaderView::GetSequenceNumber (void) const
+{
+  return (IsCtl ()) ? 0 : (ReadU16 (OFFSET_SEQUENCE_CONTROL) >> 4) & 0x0fff;
+}
+
+inline uint16_t
+WifiMacHeaderView::GetFragmentNumber (void) const
+{
+  return (IsCtl ()) ? 0 : ReadU16 (OFFSET_SEQUENCE_CONTROL) & 0x0f;
+}
+
+inline Mac48Address
+WifiMacHeaderView::GetAddr1 (void) const
+{
+  return ReadAddress (OFFSET_ADDR1);
+}
+
+inline Mac48Address
+WifiMacHeaderView::GetAddr2 (void) const
+{
+  if (IsCts () || IsAck ())
+    {
+      return Mac48Address ();
+    }
+  return ReadAddress (OFFSET_ADDR2);
+}
+
+inline Mac48Address
+WifiMacHeaderView::GetAddr3 (void) const
+{
+  if (IsCtl ())
+    {
+      return Mac48Address ();
+    }
+  return ReadAddress (OFFSET_ADDR3);
+}
+
+inline Mac48Address
+WifiMacHeaderView::GetAddr4 (void) const
+{
+  if (!IsData () || !IsToDs () || !IsFromDs ())
+    {
+      return Mac48Address ();
+    }
+  return ReadAddress (OFFSET_ADDR4);
+}
+
+inline uint32_t
+WifiMacHeaderView::GetSize (void) const
+{
+  switch (GetFrameType ())
+    {
+    case TYPE_MGT:
+      return OFFSET_SEQUENCE_CONTROL + 2;
+    case TYPE_CTL:
+      switch (GetFrameSubtype ())
+        {
+        case SUBTYPE_CTL_CTS:
+        case SUBTYPE_CTL_ACK:
+          return OFFSET_ADDR2;
+        default:
+          return OFFSET_ADDR3;
+        }
+    default:
+      return GetQosControlOffset () + ((GetFrameSubtype () & 0x08) ? 2 : 0);
+    }
+}
+
+} // namespace ns3
+
+#endif /* WIFI_MAC_HEADER_VIEW_H */
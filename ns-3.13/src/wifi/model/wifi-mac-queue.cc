@@ -22,6 +22,7 @@
 #include "ns3/simulator.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include <algorithm>
 
 #include "wifi-mac-queue.h"
 #include "qos-blocked-destinations.h"
@@ -30,14 +31,28 @@ using namespace std;
 
 namespace ns3 {
 
+namespace {
+// Position of the first packet of an empty queue; leaves room for PushFront
+const uint64_t QUEUE_ORIGIN = ((uint64_t) 1) << 62;
+const uint32_t QUEUE_INITIAL_CAPACITY = 16;
+} // anonymous namespace
+
 NS_OBJECT_ENSURE_REGISTERED (WifiMacQueue);
 
+WifiMacQueue::Item::Item ()
+  : seq (0),
+    live (false)
+{
+}
+
 WifiMacQueue::Item::Item (Ptr<const Packet> packet,
                           const WifiMacHeader &hdr,
                           Time tstamp)
   : packet (packet),
     hdr (hdr),
-    tstamp (tstamp)
+    tstamp (tstamp),
+    seq (0),
+    live (true)
 {
 }
 
@@ -60,8 +75,17 @@ WifiMacQueue::GetTypeId (void)
 }
 
 WifiMacQueue::WifiMacQueue ()
-  : m_size (0)
+  : m_queue (QUEUE_INITIAL_CAPACITY),
+    m_head (QUEUE_ORIGIN),
+    m_tail (QUEUE_ORIGIN),
+    m_expiredBegin (QUEUE_ORIGIN),
+    m_expiredEnd (QUEUE_ORIGIN),
+    m_seq (0),
+    m_removed (0),
+    m_size (0)
 {
+  m_peeked.pos = 0;
+  m_peeked.seq = 0;
 }
 
 WifiMacQueue::~WifiMacQueue ()
@@ -93,6 +117,23 @@ WifiMacQueue::GetMaxDelay (void) const
   return m_maxDelay;
 }
 
+WifiMacQueue::Item &
+WifiMacQueue::GetItem (uint64_t pos)
+{
+  return m_queue[pos & (m_queue.size () - 1)];
+}
+
+bool
+WifiMacQueue::IsValid (const Handle &handle)
+{
+  if (handle.pos < m_head || handle.pos >= m_tail)
+    {
+      return false;
+    }
+  const Item &item = GetItem (handle.pos);
+  return item.live && item.seq == handle.seq;
+}
+
 void
 WifiMacQueue::Enqueue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
 {
@@ -101,47 +142,222 @@ WifiMacQueue::Enqueue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
     {
       return;
     }
-  Time now = Simulator::Now ();
-  m_queue.push_back (Item (packet, hdr, now));
+  Insert (packet, hdr, true);
+}
+
+void
+WifiMacQueue::Insert (Ptr<const Packet> packet, const WifiMacHeader &hdr, bool back)
+{
+  Reserve ();
+  uint64_t pos;
+  if (back)
+    {
+      pos = m_tail++;
+    }
+  else
+    {
+      // the new packet is the newest one, so it can only be in front of the
+      // non-increasing part of the queue
+      pos = --m_head;
+    }
+  Item &item = GetItem (pos);
+  item = Item (packet, hdr, Simulator::Now ());
+  item.seq = ++m_seq;
   m_size++;
+  IndexItem (pos, back);
+}
+
+void
+WifiMacQueue::Reserve (void)
+{
+  if (m_tail - m_head < m_queue.size ())
+    {
+      return;
+    }
+  if (m_removed > m_size)
+    {
+      Compact ();
+      return;
+    }
+  // positions are kept, so are the handles in the indices
+  PacketQueue queue (2 * m_queue.size ());
+  for (uint64_t pos = m_head; pos != m_tail; pos++)
+    {
+      queue[pos & (queue.size () - 1)] = GetItem (pos);
+    }
+  m_queue.swap (queue);
+}
+
+void
+WifiMacQueue::Compact (void)
+{
+  PacketQueue queue (m_queue.size ());
+  uint32_t mask = queue.size () - 1;
+  // keep the non-increasing part of the queue in front of m_expiredBegin and
+  // the non-decreasing one after it
+  uint64_t front = m_expiredBegin;
+  for (uint64_t pos = m_expiredBegin; pos != m_head; pos--)
+    {
+      if (GetItem (pos - 1).live)
+        {
+          queue[--front & mask] = GetItem (pos - 1);
+        }
+    }
+  uint64_t back = m_expiredBegin;
+  for (uint64_t pos = m_expiredEnd; pos != m_tail; pos++)
+    {
+      if (GetItem (pos).live)
+        {
+          queue[back++ & mask] = GetItem (pos);
+        }
+    }
+  m_queue.swap (queue);
+  m_head = front;
+  m_tail = back;
+  m_expiredEnd = m_expiredBegin;
+  m_removed = 0;
+  m_indices.clear ();
+  for (uint64_t pos = m_head; pos != m_tail; pos++)
+    {
+      IndexItem (pos, true);
+    }
+}
+
+void
+WifiMacQueue::IndexItem (uint64_t pos, bool back)
+{
+  const Item &item = GetItem (pos);
+  if (!item.hdr.IsQosData ())
+    {
+      return;
+    }
+  Handle handle;
+  handle.pos = pos;
+  handle.seq = item.seq;
+  TidAddressIndex &index = m_indices[std::make_pair (item.hdr.GetQosTid (), item.hdr.GetAddr1 ())];
+  if (index.handles.empty ())
+    {
+      index.nPackets = 0;
+    }
+  if (back)
+    {
+      index.handles.push_back (handle);
+    }
+  else
+    {
+      index.handles.push_front (handle);
+    }
+  index.nPackets++;
+}
+
+void
+WifiMacQueue::Kill (uint64_t pos)
+{
+  Item &item = GetItem (pos);
+  NS_ASSERT (item.live);
+  if (item.hdr.IsQosData ())
+    {
+      TidAddressIndices::iterator i = m_indices.find (std::make_pair (item.hdr.GetQosTid (), item.hdr.GetAddr1 ()));
+      NS_ASSERT (i != m_indices.end ());
+      if (--i->second.nPackets == 0)
+        {
+          m_indices.erase (i);
+        }
+      else if (i->second.handles.front ().pos == pos)
+        {
+          i->second.handles.pop_front ();
+        }
+      // other stale handles are dropped when they get to the front
+    }
+  item.live = false;
+  item.packet = 0;
+  m_size--;
+  m_removed++;
+}
+
+void
+WifiMacQueue::Erase (uint64_t pos)
+{
+  Kill (pos);
+  Trim ();
+}
+
+void
+WifiMacQueue::Trim (void)
+{
+  while (m_head != m_tail && !GetItem (m_head).live)
+    {
+      m_head++;
+      m_removed--;
+    }
+  while (m_tail != m_head && !GetItem (m_tail - 1).live)
+    {
+      m_tail--;
+      m_removed--;
+    }
+  if (m_head == m_tail)
+    {
+      // keep the positions away from the ends of the 64-bit range
+      m_head = QUEUE_ORIGIN;
+      m_tail = QUEUE_ORIGIN;
+      m_expiredBegin = QUEUE_ORIGIN;
+      m_expiredEnd = QUEUE_ORIGIN;
+      return;
+    }
+  m_expiredBegin = std::min (std::max (m_expiredBegin, m_head), m_tail);
+  m_expiredEnd = std::min (std::max (m_expiredEnd, m_expiredBegin), m_tail);
 }
 
 void
 WifiMacQueue::Cleanup (void)
 {
-  if (m_queue.empty ())
+  if (m_size == 0)
     {
       return;
     }
 
   Time now = Simulator::Now ();
-  uint32_t n = 0;
-  for (PacketQueueI i = m_queue.begin (); i != m_queue.end ();)
+  // the oldest packets are those next to the expired range
+  while (m_expiredEnd != m_tail)
     {
-      if (i->tstamp + m_maxDelay > now)
+      Item &item = GetItem (m_expiredEnd);
+      if (item.live)
         {
-          i++;
+          if (item.tstamp + m_maxDelay > now)
+            {
+              break;
+            }
+          Kill (m_expiredEnd);
         }
-      else
+      m_expiredEnd++;
+    }
+  while (m_expiredBegin != m_head)
+    {
+      Item &item = GetItem (m_expiredBegin - 1);
+      if (item.live)
         {
-          i = m_queue.erase (i);
-          n++;
+          if (item.tstamp + m_maxDelay > now)
+            {
+              break;
+            }
+          Kill (m_expiredBegin - 1);
         }
+      m_expiredBegin--;
     }
-  m_size -= n;
+  Trim ();
 }
 
 Ptr<const Packet>
 WifiMacQueue::Dequeue (WifiMacHeader *hdr)
 {
   Cleanup ();
-  if (!m_queue.empty ())
+  if (m_size != 0)
     {
-      Item i = m_queue.front ();
-      m_queue.pop_front ();
-      m_size--;
-      *hdr = i.hdr;
-      return i.packet;
+      Item &item = GetItem (m_head);
+      Ptr<const Packet> packet = item.packet;
+      *hdr = item.hdr;
+      Erase (m_head);
+      return packet;
     }
   return 0;
 }
@@ -150,42 +366,69 @@ Ptr<const Packet>
 WifiMacQueue::Peek (WifiMacHeader *hdr)
 {
   Cleanup ();
-  if (!m_queue.empty ())
+  if (m_size != 0)
     {
-      Item i = m_queue.front ();
-      *hdr = i.hdr;
-      return i.packet;
+      Item &item = GetItem (m_head);
+      *hdr = item.hdr;
+      m_peeked.pos = m_head;
+      m_peeked.seq = item.seq;
+      return item.packet;
     }
   return 0;
 }
 
+uint64_t
+WifiMacQueue::FindByTidAndAddress (uint8_t tid, Mac48Address addr)
+{
+  TidAddressIndices::iterator i = m_indices.find (std::make_pair (tid, addr));
+  if (i == m_indices.end ())
+    {
+      return m_tail;
+    }
+  std::deque<Handle> &handles = i->second.handles;
+  while (!IsValid (handles.front ()))
+    {
+      handles.pop_front ();
+    }
+  return handles.front ().pos;
+}
+
+uint64_t
+WifiMacQueue::FindByTidAndAddress (uint8_t tid, WifiMacHeader::AddressType type, Mac48Address addr)
+{
+  NS_ASSERT (type <= 4);
+  if (type == WifiMacHeader::ADDR1)
+    {
+      return FindByTidAndAddress (tid, addr);
+    }
+  for (uint64_t pos = m_head; pos != m_tail; pos++)
+    {
+      const Item &item = GetItem (pos);
+      if (item.live && item.hdr.IsQosData ()
+          && GetAddressForPacket (type, item) == addr
+          && item.hdr.GetQosTid () == tid)
+        {
+          return pos;
+        }
+    }
+  return m_tail;
+}
+
 Ptr<const Packet>
 WifiMacQueue::DequeueByTidAndAddress (WifiMacHeader *hdr, uint8_t tid,
                                       WifiMacHeader::AddressType type, Mac48Address dest)
 {
   Cleanup ();
-  Ptr<const Packet> packet = 0;
-  if (!m_queue.empty ())
+  uint64_t pos = FindByTidAndAddress (tid, type, dest);
+  if (pos != m_tail)
     {
-      PacketQueueI it;
-      NS_ASSERT (type <= 4);
-      for (it = m_queue.begin (); it != m_queue.end (); ++it)
-        {
-          if (it->hdr.IsQosData ())
-            {
-              if (GetAddressForPacket (type, it) == dest
-                  && it->hdr.GetQosTid () == tid)
-                {
-                  packet = it->packet;
-                  *hdr = it->hdr;
-                  m_queue.erase (it);
-                  m_size--;
-                  break;
-                }
-            }
-        }
+      Item &item = GetItem (pos);
+      Ptr<const Packet> packet = item.packet;
+      *hdr = item.hdr;
+      Erase (pos);
+      return packet;
     }
-  return packet;
+  return 0;
 }
 
 Ptr<const Packet>
@@ -193,22 +436,14 @@ WifiMacQueue::PeekByTidAndAddress (WifiMacHeader *hdr, uint8_t tid,
                                    WifiMacHeader::AddressType type, Mac48Address dest)
 {
   Cleanup ();
-  if (!m_queue.empty ())
+  uint64_t pos = FindByTidAndAddress (tid, type, dest);
+  if (pos != m_tail)
     {
-      PacketQueueI it;
-      NS_ASSERT (type <= 4);
-      for (it = m_queue.begin (); it != m_queue.end (); ++it)
-        {
-          if (it->hdr.IsQosData ())
-            {
-              if (GetAddressForPacket (type, it) == dest
-                  && it->hdr.GetQosTid () == tid)
-                {
-                  *hdr = it->hdr;
-                  return it->packet;
-                }
-            }
-        }
+      Item &item = GetItem (pos);
+      *hdr = item.hdr;
+      m_peeked.pos = pos;
+      m_peeked.seq = item.seq;
+      return item.packet;
     }
   return 0;
 }
@@ -217,7 +452,7 @@ bool
 WifiMacQueue::IsEmpty (void)
 {
   Cleanup ();
-  return m_queue.empty ();
+  return m_size == 0;
 }
 
 uint32_t
@@ -229,24 +464,31 @@ WifiMacQueue::GetSize (void)
 void
 WifiMacQueue::Flush (void)
 {
-  m_queue.erase (m_queue.begin (), m_queue.end ());
+  PacketQueue queue (QUEUE_INITIAL_CAPACITY);
+  m_queue.swap (queue);
+  m_indices.clear ();
+  m_head = QUEUE_ORIGIN;
+  m_tail = QUEUE_ORIGIN;
+  m_expiredBegin = QUEUE_ORIGIN;
+  m_expiredEnd = QUEUE_ORIGIN;
+  m_removed = 0;
   m_size = 0;
 }
 
 Mac48Address
-WifiMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQueueI it)
+WifiMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, const Item &item) const
 {
   if (type == WifiMacHeader::ADDR1)
     {
-      return it->hdr.GetAddr1 ();
+      return item.hdr.GetAddr1 ();
     }
   if (type == WifiMacHeader::ADDR2)
     {
-      return it->hdr.GetAddr2 ();
+      return item.hdr.GetAddr2 ();
     }
   if (type == WifiMacHeader::ADDR3)
     {
-      return it->hdr.GetAddr3 ();
+      return item.hdr.GetAddr3 ();
     }
   return 0;
 }
@@ -254,13 +496,18 @@ WifiMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQ
 bool
 WifiMacQueue::Remove (Ptr<const Packet> packet)
 {
-  PacketQueueI it = m_queue.begin ();
-  for (; it != m_queue.end (); it++)
+  // EdcaTxopN removes the packets it has just peeked while aggregating
+  if (IsValid (m_peeked) && GetItem (m_peeked.pos).packet == packet)
+    {
+      Erase (m_peeked.pos);
+      return true;
+    }
+  for (uint64_t pos = m_head; pos != m_tail; pos++)
     {
-      if (it->packet == packet)
+      const Item &item = GetItem (pos);
+      if (item.live && item.packet == packet)
         {
-          m_queue.erase (it);
-          m_size--;
+          Erase (pos);
           return true;
         }
     }
@@ -275,9 +522,7 @@ WifiMacQueue::PushFront (Ptr<const Packet> packet, const WifiMacHeader &hdr)
     {
       return;
     }
-  Time now = Simulator::Now ();
-  m_queue.push_front (Item (packet, hdr, now));
-  m_size++;
+  Insert (packet, hdr, false);
 }
 
 uint32_t
@@ -285,20 +530,20 @@ WifiMacQueue::GetNPacketsByTidAndAddress (uint8_t tid, WifiMacHeader::AddressTyp
                                           Mac48Address addr)
 {
   Cleanup ();
+  NS_ASSERT (type <= 4);
+  if (type == WifiMacHeader::ADDR1)
+    {
+      TidAddressIndices::const_iterator i = m_indices.find (std::make_pair (tid, addr));
+      return (i != m_indices.end ()) ? i->second.nPackets : 0;
+    }
   uint32_t nPackets = 0;
-  if (!m_queue.empty ())
+  for (uint64_t pos = m_head; pos != m_tail; pos++)
     {
-      PacketQueueI it;
-      NS_ASSERT (type <= 4);
-      for (it = m_queue.begin (); it != m_queue.end (); it++)
+      const Item &item = GetItem (pos);
+      if (item.live && GetAddressForPacket (type, item) == addr
+          && item.hdr.IsQosData () && item.hdr.GetQosTid () == tid)
         {
-          if (GetAddressForPacket (type, it) == addr)
-            {
-              if (it->hdr.IsQosData () && it->hdr.GetQosTid () == tid)
-                {
-                  nPackets++;
-                }
-            }
+          nPackets++;
         }
     }
   return nPackets;
@@ -309,21 +554,21 @@ WifiMacQueue::DequeueFirstAvailable (WifiMacHeader *hdr, Time &timestamp,
                                      const QosBlockedDestinations *blockedPackets)
 {
   Cleanup ();
-  Ptr<const Packet> packet = 0;
-  for (PacketQueueI it = m_queue.begin (); it != m_queue.end (); it++)
+  for (uint64_t pos = m_head; pos != m_tail; pos++)
     {
-      if (!it->hdr.IsQosData ()
-          || !blockedPackets->IsBlocked (it->hdr.GetAddr1 (), it->hdr.GetQosTid ()))
+      Item &item = GetItem (pos);
+      if (item.live
+          && (!item.hdr.IsQosData ()
+              || !blockedPackets->IsBlocked (item.hdr.GetAddr1 (), item.hdr.GetQosTid ())))
         {
-          *hdr = it->hdr;
-          timestamp = it->tstamp;
-          packet = it->packet;
-          m_queue.erase (it);
-          m_size--;
+          Ptr<const Packet> packet = item.packet;
+          *hdr = item.hdr;
+          timestamp = item.tstamp;
+          Erase (pos);
           return packet;
         }
     }
-  return packet;
+  return 0;
 }
 
 Ptr<const Packet>
@@ -331,14 +576,18 @@ WifiMacQueue::PeekFirstAvailable (WifiMacHeader *hdr, Time &timestamp,
                                   const QosBlockedDestinations *blockedPackets)
 {
   Cleanup ();
-  for (PacketQueueI it = m_queue.begin (); it != m_queue.end (); it++)
+  for (uint64_t pos = m_head; pos != m_tail; pos++)
     {
-      if (!it->hdr.IsQosData ()
-          || !blockedPackets->IsBlocked (it->hdr.GetAddr1 (), it->hdr.GetQosTid ()))
+      Item &item = GetItem (pos);
+      if (item.live
+          && (!item.hdr.IsQosData ()
+              || !blockedPackets->IsBlocked (item.hdr.GetAddr1 (), item.hdr.GetQosTid ())))
         {
-          *hdr = it->hdr;
-          timestamp = it->tstamp;
-          return it->packet;
+          *hdr = item.hdr;
+          timestamp = item.tstamp;
+          m_peeked.pos = pos;
+          m_peeked.seq = item.seq;
+          return item.packet;
         }
     }
   return 0;
@@ -22,7 +22,9 @@
 #ifndef WIFI_MAC_QUEUE_H
 #define WIFI_MAC_QUEUE_H
 
-#include <list>
+#include <vector>
+#include <deque>
+#include <map>
 #include <utility>
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
@@ -48,6 +50,17 @@ class QosBlockedDestinations;
  * to verify whether or not it should be dropped. If
  * dot11EDCATableMSDULifetime has elapsed, it is dropped.
  * Otherwise, it is returned to the caller.
+ *
+ * Packets are stored in a ring buffer indexed by a monotonic position.
+ * Since packets are always timestamped with the current time, timestamps
+ * grow from the positions where PushFront stops and Enqueue starts towards
+ * both ends of the queue; the expired packets are hence a contiguous range
+ * around that point, which is tracked by a cursor so that the lifetime
+ * check is amortized O(1) instead of a scan of the whole queue. Packets
+ * removed from the middle of the queue leave an empty slot behind, which is
+ * reclaimed when it reaches either end or when the buffer is compacted.
+ * QoS data packets are also indexed by their TID and Address1 fields, which
+ * are the lookups performed by ns3::EdcaTxopN and ns3::BlockAckManager.
  */
 class WifiMacQueue : public Object
 {
@@ -90,7 +103,8 @@ public:
   /**
    * If exists, removes <i>packet</i> from queue and returns true. Otherwise it
    * takes no effects and return false. Deletion of the packet is
-   * performed in linear time (O(n)).
+   * performed in linear time (O(n)), but for the packet returned by the
+   * last Peek operation, which is removed in constant time.
    */
   bool Remove (Ptr<const Packet> packet);
   /**
@@ -123,24 +137,71 @@ public:
 private:
   struct Item;
 
-  typedef std::list<struct Item> PacketQueue;
-  typedef std::list<struct Item>::reverse_iterator PacketQueueRI;
-  typedef std::list<struct Item>::iterator PacketQueueI;
+  typedef std::vector<struct Item> PacketQueue;
+
+  /// Reference to a queued packet, which is stale once the slot is reused
+  struct Handle
+  {
+    uint64_t pos;
+    uint64_t seq;
+  };
+  typedef std::pair<uint8_t, Mac48Address> TidAddress;
+  /// Queued QoS data packets of a TID and Address1, in queue order
+  struct TidAddressIndex
+  {
+    std::deque<Handle> handles;
+    uint32_t nPackets;
+  };
+  typedef std::map<TidAddress, TidAddressIndex> TidAddressIndices;
 
   void Cleanup (void);
-  Mac48Address GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQueueI);
+  Mac48Address GetAddressForPacket (enum WifiMacHeader::AddressType type, const Item &item) const;
+
+  Item & GetItem (uint64_t pos);
+  bool IsValid (const Handle &handle);
+  /// Stores a packet at the tail (back) or in front of the head of the queue
+  void Insert (Ptr<const Packet> packet, const WifiMacHeader &hdr, bool back);
+  /// Makes room for one more packet, either growing or compacting the buffer
+  void Reserve (void);
+  void Compact (void);
+  /// Empties the slot at <i>pos</i>; Trim must be called afterwards
+  void Kill (uint64_t pos);
+  /// Kill followed by Trim
+  void Erase (uint64_t pos);
+  /// Reclaims the empty slots at both ends of the queue
+  void Trim (void);
+  void IndexItem (uint64_t pos, bool back);
+  /// \returns the position of the first packet of the tid and address, m_tail if none
+  uint64_t FindByTidAndAddress (uint8_t tid, Mac48Address addr);
+  /// \returns the position of the first packet of the tid and address, m_tail if none
+  uint64_t FindByTidAndAddress (uint8_t tid, WifiMacHeader::AddressType type, Mac48Address addr);
 
   struct Item
   {
+    Item ();
     Item (Ptr<const Packet> packet,
           const WifiMacHeader &hdr,
           Time tstamp);
     Ptr<const Packet> packet;
     WifiMacHeader hdr;
     Time tstamp;
+    uint64_t seq;
+    bool live;
   };
 
   PacketQueue m_queue;
+  // Queued packets (and empty slots) are in [m_head, m_tail); all the slots in
+  // [m_expiredBegin, m_expiredEnd) are empty; live packets have non-increasing
+  // timestamps in [m_head, m_expiredBegin) and non-decreasing ones in
+  // [m_expiredEnd, m_tail)
+  uint64_t m_head;
+  uint64_t m_tail;
+  uint64_t m_expiredBegin;
+  uint64_t m_expiredEnd;
+  uint64_t m_seq;
+  uint32_t m_removed;
+  Handle m_peeked;
+  TidAddressIndices m_indices;
   WifiMacParameters *m_parameters;
   uint32_t m_size;
   uint32_t m_maxSize;
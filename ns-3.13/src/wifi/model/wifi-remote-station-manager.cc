@@ -202,11 +202,13 @@ WifiRemoteStationManager::DoDispose (void)
       delete (*i);
     }
   m_states.clear ();
+  m_stateIndex.Clear ();
   for (Stations::const_iterator i = m_stations.begin (); i != m_stations.end (); i++)
     {
       delete (*i);
     }
   m_stations.clear ();
+  m_stationIndex.Clear ();
 }
 void
 WifiRemoteStationManager::SetupPhy (Ptr<WifiPhy> phy)
@@ -676,18 +678,18 @@ WifiRemoteStationManager::GetInfo (Mac48Address address)
 WifiRemoteStationState *
 WifiRemoteStationManager::LookupState (Mac48Address address) const
 {
-  for (StationStates::const_iterator i = m_states.begin (); i != m_states.end (); i++)
+  uint64_t key = MacAddressIndex<WifiRemoteStationState>::GetKey (address, 0);
+  WifiRemoteStationState *state = m_stateIndex.Find (key);
+  if (state != 0)
     {
-      if ((*i)->m_address == address)
-        {
-          return (*i);
-        }
+      return state;
     }
-  WifiRemoteStationState *state = new WifiRemoteStationState ();
+  state = new WifiRemoteStationState ();
   state->m_state = WifiRemoteStationState::BRAND_NEW;
   state->m_address = address;
   state->m_operationalRateSet.push_back (GetDefaultMode ());
   const_cast<WifiRemoteStationManager *> (this)->m_states.push_back (state);
+  m_stateIndex.Insert (key, state);
   return state;
 }
 WifiRemoteStation *
@@ -707,23 +709,22 @@ WifiRemoteStationManager::Lookup (Mac48Address address, const WifiMacHeader *hea
 WifiRemoteStation *
 WifiRemoteStationManager::Lookup (Mac48Address address, uint8_t tid) const
 {
-  for (Stations::const_iterator i = m_stations.begin (); i != m_stations.end (); i++)
+  uint64_t key = MacAddressIndex<WifiRemoteStation>::GetKey (address, tid);
+  WifiRemoteStation *station = m_stationIndex.Find (key);
+  if (station != 0)
     {
-      if ((*i)->m_tid == tid
-          && (*i)->m_state->m_address == address)
-        {
-          return (*i);
-        }
+      return station;
     }
   WifiRemoteStationState *state = LookupState (address);
 
-  WifiRemoteStation *station = DoCreateStation ();
+  station = DoCreateStation ();
   station->m_state = state;
   station->m_tid = tid;
   station->m_ssrc = 0;
   station->m_slrc = 0;
   // XXX
   const_cast<WifiRemoteStationManager *> (this)->m_stations.push_back (station);
+  m_stationIndex.Insert (key, station);
   return station;
 
 }
@@ -741,6 +742,7 @@ WifiRemoteStationManager::Reset (void)
       delete (*i);
     }
   m_stations.clear ();
+  m_stationIndex.Clear ();
   m_bssBasicRateSet.clear ();
   m_bssBasicRateSet.push_back (m_defaultTxMode);
   NS_ASSERT (m_defaultTxMode.IsMandatory ());
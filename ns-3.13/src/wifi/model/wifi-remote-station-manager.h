@@ -28,6 +28,7 @@
 #include "ns3/object.h"
 #include "ns3/nstime.h"
 #include "wifi-mode.h"
+#include "mac-address-index.h"
 
 namespace ns3 {
 
@@ -400,6 +401,9 @@ private:
 
   StationStates m_states;
   Stations m_stations;
+  // the states are indexed by address (TID 0), the stations by address and TID
+  mutable MacAddressIndex<WifiRemoteStationState> m_stateIndex;
+  mutable MacAddressIndex<WifiRemoteStation> m_stationIndex;
   /**
    * This is a pointer to the WifiPhy associated with this
    * WifiRemoteStationManager that is set on call to
@@ -490,7 +494,6 @@ struct WifiRemoteStation
   uint8_t m_tid;
 };
 
-
 } // namespace ns3
 
 #endif /* WIFI_REMOTE_STATION_MANAGER_H */
@@ -20,11 +20,22 @@
 #include "yans-error-rate-model.h"
 #include "wifi-phy.h"
 #include "ns3/log.h"
+#include "ns3/enum.h"
+#include <math.h>
+#include <limits>
 
 NS_LOG_COMPONENT_DEFINE ("YansErrorRateModel");
 
 namespace ns3 {
 
+// SNR bins of the success rate tables (dB)
+static const double TABLE_MIN_SNR_DB = -10.0;
+static const double TABLE_MAX_SNR_DB = 60.0;
+static const double TABLE_STEP_DB = 0.01;
+static const uint32_t TABLE_BINS = (uint32_t) ((TABLE_MAX_SNR_DB - TABLE_MIN_SNR_DB) / TABLE_STEP_DB) + 1;
+// Maximum difference (VALIDATE mode) between the interpolated and the analytic success rates
+static const double TABLE_TOLERANCE = 1e-3;
+
 NS_OBJECT_ENSURE_REGISTERED (YansErrorRateModel);
 
 TypeId
@@ -33,11 +44,20 @@ YansErrorRateModel::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::YansErrorRateModel")
     .SetParent<ErrorRateModel> ()
     .AddConstructor<YansErrorRateModel> ()
+    .AddAttribute ("Computation",
+                   "How the chunk success rate is obtained: interpolated from tables shared by every instance (Table), "
+                   "by evaluating the formulas for every chunk (Analytic) or both, warning if they differ (Validate).",
+                   EnumValue (YansErrorRateModel::TABLE),
+                   MakeEnumAccessor (&YansErrorRateModel::m_computation),
+                   MakeEnumChecker (YansErrorRateModel::TABLE, "Table",
+                                    YansErrorRateModel::ANALYTIC, "Analytic",
+                                    YansErrorRateModel::VALIDATE, "Validate"))
   ;
   return tid;
 }
 
 YansErrorRateModel::YansErrorRateModel ()
+  : m_computation (TABLE)
 {
 }
 
@@ -171,6 +191,90 @@ YansErrorRateModel::GetFecQamBer (double snr, uint32_t nbits,
 
 double
 YansErrorRateModel::GetChunkSuccessRate (WifiMode mode, double snr, uint32_t nbits) const
+{
+  switch (m_computation)
+    {
+    case TABLE:
+      return GetTableChunkSuccessRate (mode, snr, nbits);
+    case VALIDATE:
+      {
+        double analytic = CalculateChunkSuccessRate (mode, snr, nbits);
+        double table = GetTableChunkSuccessRate (mode, snr, nbits);
+        if (fabs (analytic - table) > TABLE_TOLERANCE)
+          {
+            NS_LOG_WARN ("mode=" << mode << " snr=" << snr << " nbits=" << nbits << ": table success rate " << table
+                                 << " differs from the analytic one " << analytic);
+          }
+        return analytic;
+      }
+    default:
+      return CalculateChunkSuccessRate (mode, snr, nbits);
+    }
+}
+
+std::vector<std::vector<double> > &
+YansErrorRateModel::GetTables (void)
+{
+  static std::vector<std::vector<double> > tables;
+  return tables;
+}
+
+double
+YansErrorRateModel::GetTableLogBer (WifiMode mode, std::vector<double> &table, uint32_t bin) const
+{
+  if (table[bin] != table[bin])   // NaN --> not calculated yet
+    {
+      double snr = pow (10.0, (TABLE_MIN_SNR_DB + bin * TABLE_STEP_DB) / 10.0);
+      table[bin] = log (1.0 - CalculateChunkSuccessRate (mode, snr, 1));
+    }
+  return table[bin];
+}
+
+double
+YansErrorRateModel::GetTableChunkSuccessRate (WifiMode mode, double snr, uint32_t nbits) const
+{
+  if (nbits == 0)
+    {
+      return 1.0;
+    }
+  double position = (10.0 * log10 (snr) - TABLE_MIN_SNR_DB) / TABLE_STEP_DB;
+  if (!(position >= 0.0) || position >= TABLE_BINS - 1)
+    {
+      // Out of the table range
+      return CalculateChunkSuccessRate (mode, snr, nbits);
+    }
+
+  std::vector<std::vector<double> > &tables = GetTables ();
+  if (tables.size () <= mode.GetUid ())
+    {
+      tables.resize (mode.GetUid () + 1);
+    }
+  std::vector<double> &table = tables[mode.GetUid ()];
+  if (table.empty ())
+    {
+      table.assign (TABLE_BINS, std::numeric_limits<double>::quiet_NaN ());
+    }
+
+  // The log of the BER is (almost) linear in the SNR (dB) within a bin
+  uint32_t bin = (uint32_t) position;
+  double fraction = position - bin;
+  double lower = GetTableLogBer (mode, table, bin);
+  double upper = GetTableLogBer (mode, table, bin + 1);
+  double logBer;
+  if (lower == -std::numeric_limits<double>::infinity () || upper == -std::numeric_limits<double>::infinity ())
+    {
+      // Error free bin (BER = 0): the closest bin is taken
+      logBer = (fraction < 0.5) ? lower : upper;
+    }
+  else
+    {
+      logBer = lower + fraction * (upper - lower);
+    }
+  return exp (nbits * log1p (-exp (logBer)));
+}
+
+double
+YansErrorRateModel::CalculateChunkSuccessRate (WifiMode mode, double snr, uint32_t nbits) const
 {
   if (mode.GetModulationClass () == WIFI_MOD_CLASS_ERP_OFDM
       || mode.GetModulationClass () == WIFI_MOD_CLASS_OFDM)
@@ -21,6 +21,7 @@
 #define YANS_ERROR_RATE_MODEL_H
 
 #include <stdint.h>
+#include <vector>
 #include "wifi-mode.h"
 #include "error-rate-model.h"
 #include "dsss-error-rate-model.h"
@@ -51,10 +52,24 @@ namespace ns3 {
  *      57(2):440-449, February 2009.
  *    - More detailed description and validation can be found in
  *      http://www.nsnam.org/~pei/80211b.pdf
+ *
+ * For every mode, the success rate of a chunk is the success rate of one bit
+ * raised to the number of bits. Hence, by default, the bit error rate of each
+ * mode is tabulated (in SNR bins, filled on first use and shared by every
+ * instance) and interpolated, instead of evaluating the formulas above for
+ * every chunk. See the Computation attribute.
  */
 class YansErrorRateModel : public ErrorRateModel
 {
 public:
+  /// How the chunk success rate is obtained
+  enum Computation
+  {
+    TABLE,      ///< Interpolated from the shared tables (analytic out of the table range)
+    ANALYTIC,   ///< Formulas evaluated for every chunk
+    VALIDATE    ///< Analytic, warning when the table differs from it
+  };
+
   static TypeId GetTypeId (void);
 
   YansErrorRateModel ();
@@ -62,6 +77,17 @@ public:
   virtual double GetChunkSuccessRate (WifiMode mode, double snr, uint32_t nbits) const;
 
 private:
+  double CalculateChunkSuccessRate (WifiMode mode, double snr, uint32_t nbits) const;
+  double GetTableChunkSuccessRate (WifiMode mode, double snr, uint32_t nbits) const;
+  /**
+   * \returns the log of the bit error rate of the mode at the given bin, calculated on first use
+   */
+  double GetTableLogBer (WifiMode mode, std::vector<double> &table, uint32_t bin) const;
+  /**
+   * \returns the tables (log of the bit error rate per SNR bin) of every mode, indexed by its uid
+   */
+  static std::vector<std::vector<double> > & GetTables (void);
+
   double Log2 (double val) const;
   double GetBpskBer (double snr, uint32_t signalSpread, uint32_t phyRate) const;
   double GetQamBer (double snr, unsigned int m, uint32_t signalSpread, uint32_t phyRate) const;
@@ -78,6 +104,8 @@ private:
                        uint32_t phyRate,
                        uint32_t m, uint32_t dfree,
                        uint32_t adFree, uint32_t adFreePlusOne) const;
+
+  enum Computation m_computation;
 };
 
 
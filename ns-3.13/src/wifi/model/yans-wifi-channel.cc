@@ -25,10 +25,14 @@
 #include "ns3/log.h"
 #include "ns3/pointer.h"
 #include "ns3/object-factory.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
 #include "yans-wifi-channel.h"
 //#include "yans-wifi-phy.h"
 #include "ns3/propagation-loss-model.h"
 #include "ns3/propagation-delay-model.h"
+#include <algorithm>
+#include <math.h>
 
 NS_LOG_COMPONENT_DEFINE ("YansWifiChannel");
 
@@ -50,11 +54,31 @@ YansWifiChannel::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&YansWifiChannel::m_delay),
                    MakePointerChecker<PropagationDelayModel> ())
+    .AddAttribute ("MaxRange", "Distance (m) beyond which frames are not delivered, so that only the PHYs nearby the sender "
+                   "are visited (spatial index). 0 disables it and every PHY receives every frame.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&YansWifiChannel::SetMaxRange,
+                                       &YansWifiChannel::GetMaxRange),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("AdjacentChannels", "Number of channels, at each side of the sender channel, whose PHYs also get the "
+                   "transmitted signal as interference (it cannot be decoded). 0 disables the adjacent channel interference.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&YansWifiChannel::m_adjacentChannels),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("AdjacentChannelRejection", "Attenuation (dB) of the interference per channel of separation "
+                   "between the sender and the receiver.",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&YansWifiChannel::m_adjacentChannelRejection),
+                   MakeDoubleChecker<double> (0.0))
   ;
   return tid;
 }
 
 YansWifiChannel::YansWifiChannel ()
+  : m_maxRange (0.0),
+    m_adjacentChannels (0),
+    m_adjacentChannelRejection (10.0),
+    m_indexBuilt (false)
 {
 }
 YansWifiChannel::~YansWifiChannel ()
@@ -63,6 +87,25 @@ YansWifiChannel::~YansWifiChannel ()
   m_phyList.clear ();
 }
 
+void
+YansWifiChannel::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  // The mobility models may outlive the channel
+  for (std::set<Ptr<MobilityModel> >::const_iterator i = m_trackedMobility.begin (); i != m_trackedMobility.end (); i++)
+    {
+      Ptr<MobilityModel> mobility = *i;
+      mobility->TraceDisconnectWithoutContext ("CourseChange", MakeCallback (&YansWifiChannel::CourseChanged, this));
+    }
+  m_trackedMobility.clear ();
+  m_mobilityIndex.clear ();
+  m_buckets.clear ();
+  m_indexBuilt = false;
+  m_loss = 0;
+  m_delay = 0;
+  WifiChannel::DoDispose ();
+}
+
 void
 YansWifiChannel::SetPropagationLossModel (Ptr<PropagationLossModel> loss)
 {
@@ -74,31 +117,223 @@ YansWifiChannel::SetPropagationDelayModel (Ptr<PropagationDelayModel> delay)
   m_delay = delay;
 }
 
+void
+YansWifiChannel::SetMaxRange (double maxRange)
+{
+  m_maxRange = maxRange;
+  m_indexBuilt = false;
+}
+
+double
+YansWifiChannel::GetMaxRange (void) const
+{
+  return m_maxRange;
+}
+
+YansWifiChannel::Cell
+YansWifiChannel::GetCell (const Vector &position) const
+{
+  return std::make_pair ((int32_t) floor (position.x / m_maxRange), (int32_t) floor (position.y / m_maxRange));
+}
+
+Ptr<MobilityModel>
+YansWifiChannel::GetPhyMobility (uint32_t j) const
+{
+  if (m_phyList[j]->GetMobility () == 0)
+    {
+      return 0;
+    }
+  return m_phyList[j]->GetMobility ()->GetObject<MobilityModel> ();
+}
+
+void
+YansWifiChannel::BuildIndex (void) const
+{
+  NS_LOG_FUNCTION (this << m_phyList.size ());
+  m_buckets.clear ();
+  m_mobilityIndex.clear ();
+  m_phyChannel.assign (m_phyList.size (), 0);
+  m_phyCell.assign (m_phyList.size (), Cell (0, 0));
+
+  for (uint32_t j = 0; j < m_phyList.size (); j++)
+    {
+      m_phyChannel[j] = m_phyList[j]->GetChannelNumber ();
+      Insert (j);
+
+      Ptr<MobilityModel> mobility = GetPhyMobility (j);
+      if (m_maxRange <= 0 || mobility == 0)
+        {
+          continue;
+        }
+      m_mobilityIndex[PeekPointer (mobility)] = j;
+      if (m_trackedMobility.insert (mobility).second)
+        {
+          mobility->TraceConnectWithoutContext ("CourseChange",
+                                                MakeCallback (&YansWifiChannel::CourseChanged, const_cast<YansWifiChannel *> (this)));
+        }
+    }
+  m_indexBuilt = true;
+}
+
+void
+YansWifiChannel::Insert (uint32_t j) const
+{
+  Bucket &bucket = m_buckets[m_phyChannel[j]];
+  bucket.phys.insert (std::lower_bound (bucket.phys.begin (), bucket.phys.end (), j), j);
+  if (m_maxRange <= 0)
+    {
+      return;
+    }
+
+  Ptr<MobilityModel> mobility = GetPhyMobility (j);
+  if (mobility == 0)
+    {
+      bucket.unindexed.push_back (j);
+      return;
+    }
+  m_phyCell[j] = GetCell (mobility->GetPosition ());
+  bucket.grid[m_phyCell[j]].push_back (j);
+}
+
+void
+YansWifiChannel::Remove (uint32_t j) const
+{
+  Bucket &bucket = m_buckets[m_phyChannel[j]];
+  bucket.phys.erase (std::lower_bound (bucket.phys.begin (), bucket.phys.end (), j));
+  if (m_maxRange <= 0)
+    {
+      return;
+    }
+
+  std::vector<uint32_t>::iterator unindexed = std::find (bucket.unindexed.begin (), bucket.unindexed.end (), j);
+  if (unindexed != bucket.unindexed.end ())
+    {
+      bucket.unindexed.erase (unindexed);
+      return;
+    }
+  std::vector<uint32_t> &cell = bucket.grid[m_phyCell[j]];
+  cell.erase (std::find (cell.begin (), cell.end (), j));
+}
+
+void
+YansWifiChannel::CourseChanged (Ptr<const MobilityModel> mobility)
+{
+  if (!m_indexBuilt)
+    {
+      return;
+    }
+  std::map<const MobilityModel *, uint32_t>::const_iterator it = m_mobilityIndex.find (PeekPointer (mobility));
+  if (it == m_mobilityIndex.end ())
+    {
+      return;
+    }
+  uint32_t j = it->second;
+  Cell cell = GetCell (mobility->GetPosition ());
+  if (cell != m_phyCell[j])
+    {
+      std::vector<uint32_t> &previous = m_buckets[m_phyChannel[j]].grid[m_phyCell[j]];
+      previous.erase (std::find (previous.begin (), previous.end (), j));
+      m_buckets[m_phyChannel[j]].grid[cell].push_back (j);
+      m_phyCell[j] = cell;
+    }
+}
+
+void
+YansWifiChannel::ChannelNumberChanged (Ptr<YansWifiPhy> phy)
+{
+  if (!m_indexBuilt)
+    {
+      return;
+    }
+  std::map<const YansWifiPhy *, uint32_t>::const_iterator it = m_phyIndex.find (PeekPointer (phy));
+  NS_ASSERT (it != m_phyIndex.end ());
+  uint32_t j = it->second;
+  if (m_phyChannel[j] != phy->GetChannelNumber ())
+    {
+      NS_LOG_DEBUG ("phy " << j << " moves from channel " << m_phyChannel[j] << " to " << phy->GetChannelNumber ());
+      Remove (j);
+      m_phyChannel[j] = phy->GetChannelNumber ();
+      Insert (j);
+    }
+}
+
+void
+YansWifiChannel::GetCandidates (Ptr<MobilityModel> senderMobility, uint16_t channelNumber) const
+{
+  m_candidates.clear ();
+  if (!m_indexBuilt)
+    {
+      BuildIndex ();
+    }
+
+  // Buckets of the sender channel and, if enabled, of its adjacent channels
+  uint32_t first = (channelNumber > m_adjacentChannels) ? channelNumber - m_adjacentChannels : 0;
+  uint32_t last = (uint32_t) channelNumber + m_adjacentChannels;
+  Cell center;
+  if (m_maxRange > 0)
+    {
+      center = GetCell (senderMobility->GetPosition ());
+    }
+  for (BucketMap::const_iterator bucket = m_buckets.lower_bound (first);
+       bucket != m_buckets.end () && bucket->first <= last; bucket++)
+    {
+      if (m_maxRange <= 0)
+        {
+          m_candidates.insert (m_candidates.end (), bucket->second.phys.begin (), bucket->second.phys.end ());
+          continue;
+        }
+      // Cells are MaxRange wide, hence every receiver within range lies in the 3x3 neighbourhood
+      for (int32_t dx = -1; dx <= 1; dx++)
+        {
+          for (int32_t dy = -1; dy <= 1; dy++)
+            {
+              Grid::const_iterator cell = bucket->second.grid.find (std::make_pair (center.first + dx, center.second + dy));
+              if (cell != bucket->second.grid.end ())
+                {
+                  m_candidates.insert (m_candidates.end (), cell->second.begin (), cell->second.end ());
+                }
+            }
+        }
+      m_candidates.insert (m_candidates.end (), bucket->second.unindexed.begin (), bucket->second.unindexed.end ());
+    }
+
+  // Keep the m_phyList order, so that the reception events are scheduled as without the index
+  std::sort (m_candidates.begin (), m_candidates.end ());
+}
+
 void
 YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double txPowerDbm,
                        WifiMode wifiMode, WifiPreamble preamble) const
 {
   Ptr<MobilityModel> senderMobility = sender->GetMobility ()->GetObject<MobilityModel> ();
   NS_ASSERT (senderMobility != 0);
-  uint32_t j = 0;
-  for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++, j++)
+  uint16_t channelNumber = sender->GetChannelNumber ();
+  GetCandidates (senderMobility, channelNumber);
+  for (std::vector<uint32_t>::const_iterator k = m_candidates.begin (); k != m_candidates.end (); k++)
     {
+      uint32_t j = *k;
+      PhyList::const_iterator i = m_phyList.begin () + j;
       if (sender != (*i))
         {
-          // For now don't account for inter channel interference
-          if ((*i)->GetChannelNumber () != sender->GetChannelNumber ())
+          // Only the PHYs on the sender channel (or on an adjacent one, if enabled) are candidates
+          uint16_t separation = ((*i)->GetChannelNumber () > channelNumber) ?
+            (*i)->GetChannelNumber () - channelNumber : channelNumber - (*i)->GetChannelNumber ();
+          NS_ASSERT (separation <= m_adjacentChannels);
+
+          Ptr<MobilityModel> receiverMobility = (*i)->GetMobility ()->GetObject<MobilityModel> ();
+          if (m_maxRange > 0 && senderMobility->GetDistanceFrom (receiverMobility) > m_maxRange)
             {
               continue;
             }
-
-          Ptr<MobilityModel> receiverMobility = (*i)->GetMobility ()->GetObject<MobilityModel> ();
           Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
-          double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+          // The frames heard from an adjacent channel must not move the channel process of the
+          // link (BEAR, HMM) forward, as they are not received
+          double rxPowerDbm = (separation == 0) ? m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility)
+            : m_loss->CalcInterferenceRxPower (txPowerDbm, senderMobility, receiverMobility);
 
           NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
                         "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
 
-          Ptr<Packet> copy = packet->Copy ();
           Ptr<Object> dstNetDevice = m_phyList[j]->GetDevice ();
           uint32_t dstNode;
           if (dstNetDevice == 0)
@@ -109,20 +344,38 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
             {
               dstNode = dstNetDevice->GetObject<NetDevice> ()->GetNode ()->GetId ();
             }
-          Simulator::ScheduleWithContext (dstNode,
-                                          delay, &YansWifiChannel::Receive, this,
-                                          j, copy, rxPowerDbm, wifiMode, preamble);
+          if (separation == 0)
+            {
+              Simulator::ScheduleWithContext (dstNode,
+                                              delay, &YansWifiChannel::Receive, this,
+                                              j, packet, rxPowerDbm, wifiMode, preamble);
+            }
+          else
+            {
+              // Adjacent channel: the frame cannot be decoded, it only adds interference
+              rxPowerDbm -= separation * m_adjacentChannelRejection;
+              Simulator::ScheduleWithContext (dstNode,
+                                              delay, &YansWifiChannel::ReceiveInterference, this,
+                                              j, packet, rxPowerDbm, wifiMode, preamble);
+            }
         }
     }
 }
 
 void
-YansWifiChannel::Receive (uint32_t i, Ptr<Packet> packet, double rxPowerDbm,
+YansWifiChannel::Receive (uint32_t i, Ptr<const Packet> packet, double rxPowerDbm,
                           WifiMode txMode, WifiPreamble preamble) const
 {
 	m_phyList[i]->StartReceivePacket (packet, rxPowerDbm, txMode, preamble);
 }
 
+void
+YansWifiChannel::ReceiveInterference (uint32_t i, Ptr<const Packet> packet, double rxPowerDbm,
+                                      WifiMode txMode, WifiPreamble preamble) const
+{
+  m_phyList[i]->StartReceiveInterference (packet, rxPowerDbm, txMode, preamble);
+}
+
 uint32_t
 YansWifiChannel::GetNDevices (void) const
 {
@@ -137,7 +390,9 @@ YansWifiChannel::GetDevice (uint32_t i) const
 void
 YansWifiChannel::Add (Ptr<YansWifiPhy> phy)
 {
+  m_phyIndex[PeekPointer (phy)] = m_phyList.size ();
   m_phyList.push_back (phy);
+  m_indexBuilt = false;
 }
 
 } // namespace ns3
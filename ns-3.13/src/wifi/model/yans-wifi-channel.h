@@ -21,8 +21,11 @@
 #define YANS_WIFI_CHANNEL_H
 
 #include <vector>
+#include <map>
+#include <set>
 #include <stdint.h>
 #include "ns3/packet.h"
+#include "ns3/vector.h"
 #include "wifi-channel.h"
 #include "wifi-mode.h"
 #include "wifi-preamble.h"
@@ -36,6 +39,7 @@ namespace ns3 {
 class NetDevice;
 class PropagationLossModel;
 class PropagationDelayModel;
+class MobilityModel;
 class YansWifiPhy;
 
 /**
@@ -49,6 +53,16 @@ class YansWifiPhy;
  * class and contains a ns3::PropagationLossModel and a ns3::PropagationDelayModel.
  * By default, no propagation models are set so, it is the caller's responsability
  * to set them before using the channel.
+ *
+ * The PHYs are grouped into per-channel buckets (kept up to date through
+ * ChannelNumberChanged), so that Send only visits the PHYs on the sender
+ * channel and, if the AdjacentChannels attribute is set, on the neighbouring
+ * channels, which only get the signal as interference.
+ *
+ * If the MaxRange attribute is set, the receivers of each bucket are also kept
+ * in a grid of square cells (MaxRange wide, updated through the CourseChange
+ * trace of their mobility models), so that Send only visits the receivers
+ * within MaxRange of the sender.
  */
 class YansWifiChannel : public WifiChannel
 {
@@ -73,6 +87,16 @@ public:
    */
   void SetPropagationDelayModel (Ptr<PropagationDelayModel> delay);
 
+  /**
+   * \param maxRange distance (meters) beyond which no frame is delivered; 0 to deliver
+   *        every frame to all the PHYs (no spatial index).
+   */
+  void SetMaxRange (double maxRange);
+  /**
+   * \returns the maximum delivery distance (0 if disabled).
+   */
+  double GetMaxRange (void) const;
+
   /**
    * \param sender the device from which the packet is originating.
    * \param packet the packet to send
@@ -88,6 +112,13 @@ public:
   void Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double txPowerDbm,
              WifiMode wifiMode, WifiPreamble preamble) const;
 
+  /**
+   * Move the PHY to the bucket of its new channel; invoked by YansWifiPhy::SetChannelNumber.
+   *
+   * \param phy the PHY whose channel number has changed.
+   */
+  void ChannelNumberChanged (Ptr<YansWifiPhy> phy);
+
   ////David/Ramón
   /**
    * In order to ease the node ID recognition, this method return a pointer to the vector that contains the list of instanced YansWifiPhy objects
@@ -96,18 +127,79 @@ public:
   ////End David/Ramón
 
 
+protected:
+  virtual void DoDispose (void);
+
 private:
   YansWifiChannel& operator = (const YansWifiChannel &);
   YansWifiChannel (const YansWifiChannel &);
 
   typedef std::vector<Ptr<YansWifiPhy> > PhyList;
-  void Receive (uint32_t i, Ptr<Packet> packet, double rxPowerDbm,
+  typedef std::pair<int32_t, int32_t> Cell;
+  typedef std::map<Cell, std::vector<uint32_t> > Grid;
+  /// PHYs operating on the same channel
+  struct Bucket
+  {
+    std::vector<uint32_t> phys;      ///< Every PHY of the bucket, in increasing order
+    std::vector<uint32_t> unindexed; ///< PHYs out of the grid (no mobility model yet)
+    Grid grid;                       ///< Only used if MaxRange is set
+  };
+  typedef std::map<uint16_t, Bucket> BucketMap;
+
+  void Receive (uint32_t i, Ptr<const Packet> packet, double rxPowerDbm,
                 WifiMode txMode, WifiPreamble preamble) const;
+  void ReceiveInterference (uint32_t i, Ptr<const Packet> packet, double rxPowerDbm,
+                            WifiMode txMode, WifiPreamble preamble) const;
+
+  /**
+   * \returns the grid cell which holds the given position.
+   */
+  Cell GetCell (const Vector &position) const;
+  /**
+   * \returns the mobility model of the i-th PHY (0 if not available yet).
+   */
+  Ptr<MobilityModel> GetPhyMobility (uint32_t i) const;
+  /**
+   * Place every PHY into the bucket of its channel and, if MaxRange is set,
+   * into the grid (PHYs whose mobility model is not available yet are always
+   * visited).
+   */
+  void BuildIndex (void) const;
+  /**
+   * Add the i-th PHY to the bucket of m_phyChannel[i].
+   */
+  void Insert (uint32_t i) const;
+  /**
+   * Remove the i-th PHY from the bucket of m_phyChannel[i].
+   */
+  void Remove (uint32_t i) const;
+  /**
+   * Fill m_candidates with the PHYs to visit when a PHY on the given channel
+   * transmits, in increasing order (the same order as m_phyList).
+   */
+  void GetCandidates (Ptr<MobilityModel> senderMobility, uint16_t channelNumber) const;
+  /**
+   * CourseChange trace sink: move the PHY to its new cell.
+   */
+  void CourseChanged (Ptr<const MobilityModel> mobility);
 
 
   PhyList m_phyList;
   Ptr<PropagationLossModel> m_loss;
   Ptr<PropagationDelayModel> m_delay;
+
+  double m_maxRange;
+  uint16_t m_adjacentChannels;
+  double m_adjacentChannelRejection;
+  std::map<const YansWifiPhy *, uint32_t> m_phyIndex;
+  mutable bool m_indexBuilt;
+  mutable BucketMap m_buckets;
+  mutable std::vector<uint16_t> m_phyChannel;
+  mutable std::vector<Cell> m_phyCell;
+  mutable std::map<const MobilityModel *, uint32_t> m_mobilityIndex;
+  /// Mobility models whose CourseChange trace is connected to CourseChanged
+  mutable std::set<Ptr<MobilityModel> > m_trackedMobility;
+  mutable std::vector<uint32_t> m_candidates;
 };
 
 } // namespace ns3
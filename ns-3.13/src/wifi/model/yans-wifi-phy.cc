@@ -41,12 +41,14 @@
 #include "ns3/error-model.h"
 //YansWifiPhy::EndReceive headers parser
 #include "ns3/wifi-mac-header.h"
+#include "wifi-mac-header-view.h"
 #include "ns3/llc-snap-header.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/tcp-header.h"
 #include "ns3/mobility-model.h"
 #include "ns3/bear-propagation-loss-model.h"
 #include "ns3/hidden-markov-propagation-loss-model.h"
+#include "ns3/channel-realization-error-model.h"
 ////End David/Ramón
 
 NS_LOG_COMPONENT_DEFINE ("YansWifiPhy");
@@ -138,7 +140,11 @@ YansWifiPhy::GetTypeId (void)
 		   PointerValue(),
 		   MakePointerAccessor (&YansWifiPhy::m_errorModel),
 		   MakePointerChecker<ErrorModel>())
-
+    .AddTraceSource ("PhyRxErrorModelDrop",
+                     "Trace source indicating a frame has been dropped by the error model, "
+                     "with the transmitter node, the channel state and the reception duration "
+                     "(frames without a known transmitter, such as ACK and CTS, are not traced)",
+                     MakeTraceSourceAccessor (&YansWifiPhy::m_phyRxErrorModelDropTrace))
 
   ;
   return tid;
@@ -369,6 +375,10 @@ YansWifiPhy::SetChannelNumber (uint16_t nch)
       // this is not channel switch, this is initialization
       NS_LOG_DEBUG ("start at channel " << nch);
       m_channelNumber = nch;
+      if (m_channel != 0)
+        {
+          m_channel->ChannelNumberChanged (this);
+        }
       return;
     }
 
@@ -408,6 +418,7 @@ switchChannel:
    * out the state of the medium after the switching.
    */
   m_channelNumber = nch;
+  m_channel->ChannelNumberChanged (this);
 }
 
 uint16_t
@@ -438,10 +449,11 @@ void YansWifiPhy::SetPhyReceiveCallback(PhyRxCallback callback)
 {
 	m_phyRxCallback = callback;
 }
+
 ////End David/Ramón
 
 void
-YansWifiPhy::StartReceivePacket (Ptr<Packet> packet,
+YansWifiPhy::StartReceivePacket (Ptr<const Packet> packet,
                                  double rxPowerDbm,
                                  WifiMode txMode,
                                  enum WifiPreamble preamble)
@@ -546,6 +558,26 @@ maybeCcaBusy:
     }
 }
 
+void
+YansWifiPhy::StartReceiveInterference (Ptr<const Packet> packet,
+                                       double rxPowerDbm,
+                                       WifiMode txMode,
+                                       enum WifiPreamble preamble)
+{
+  NS_LOG_FUNCTION (this << packet << rxPowerDbm << txMode << preamble);
+  rxPowerDbm += m_rxGainDb;
+  double rxPowerW = DbmToW (rxPowerDbm);
+  Time rxDuration = CalculateTxDuration (packet->GetSize (), txMode, preamble);
+  m_interference.Add (packet->GetSize (), txMode, preamble, rxDuration, rxPowerW);
+
+  // Same as the frames which cannot be synchronized (see StartReceivePacket)
+  Time delayUntilCcaEnd = m_interference.GetEnergyDuration (m_ccaMode1ThresholdW);
+  if (!delayUntilCcaEnd.IsZero ())
+    {
+      m_state->SwitchMaybeToCcaBusy (delayUntilCcaEnd);
+    }
+}
+
 void
 YansWifiPhy::SendPacket (Ptr<const Packet> packet, WifiMode txMode, WifiPreamble preamble, uint8_t txPower)
 {
@@ -821,7 +853,7 @@ YansWifiPhy::GetPowerDbm (uint8_t power) const
 
 
 void
-YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> event)
+YansWifiPhy::EndReceive (Ptr<const Packet> packet, Ptr<InterferenceHelper::Event> event)
 {
 	NS_LOG_FUNCTION (this << packet << event);
 	NS_ASSERT (IsStateRx ());
@@ -831,14 +863,16 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 	//Packet receiver identification
 	int i;
 	u_int16_t txNodeId = 0;
+	bool txNodeFound = false;
 	u_int16_t rxNodeId = 0;
 	Ptr<YansWifiChannel> channel;
 	//Headers parsing
-	WifiMacHeader hdr;
 	LlcSnapHeader llcHdr;
 	Ipv4Header ipv4Hdr;
 	TcpHeader tcpHdr;
-	Ptr<Packet> pktCopy = packet->Copy();
+	//The received frame is shared (read-only) by all the receivers of the transmission. The error models and the reception callback only
+	//read it (they parse their own copies), so the private copy of this receiver is only made when the frame is handed up to the MAC
+	Ptr<Packet> rxPacket;
 	////End David/Ramón
 
 	struct InterferenceHelper::SnrPer snrPer;
@@ -861,6 +895,7 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 			Ptr<BearErrorModel> bearError = DynamicCast<BearErrorModel> (m_errorModel);
 			Ptr<HiddenMarkovErrorModel> hmmError = DynamicCast<HiddenMarkovErrorModel> (m_errorModel);
 			Ptr<MatrixErrorModel> matrixError = DynamicCast<MatrixErrorModel> (m_errorModel);
+			Ptr<ChannelRealizationErrorModel> realizationError = DynamicCast<ChannelRealizationErrorModel> (m_errorModel);
 
 			//Common task --> Get the transmitter and receiver nodes
 			//Identify the ID of the node that catches the frame in order to later trace it (As a wireless link will be characterized by the
@@ -878,8 +913,7 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 			}
 
 			//Locate the transmitter: to do so, we have to look a node with the particular MAC address of the transmitter
-			WifiMacHeader header;
-			packet->PeekHeader (header);
+			WifiMacHeaderView header (packet);
 
 			if (header.GetAddr2 () != Mac48Address ("00:00:00:00:00:00"))
 			{
@@ -892,6 +926,7 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 						if (tx == header.GetAddr2 ())		//If found the source node, no need to continue looping
 						{
 							txNodeId = j;
+							txNodeFound = true;
 							//DEBUG MESSAGE
 							NS_LOG_DEBUG (Simulator::Now().GetSeconds() << " :TX " << (int) txNodeId << " (" << header.GetAddr2 () << ") "
 									" -> RX " << (int) rxNodeId << " (" << header.GetAddr1 () << ")");
@@ -911,43 +946,35 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 				hmmError->SetTxIndex (txNodeId);
 				hmmError->SetRxIndex (rxNodeId);
 			}
+			else if (realizationError)
+			{
+				realizationError->SetTxIndex (txNodeId);
+				realizationError->SetRxIndex (rxNodeId);
+			}
 			//Special case --> MatrixErrorModel: The error model has a special need, it must know which node is the receiver of the frame in order to decide
 			//whether is correct or not
 			else if (matrixError)
 			{
-				WifiMacHeader header;
-				packet->PeekHeader (header);
-				matrixError->SetReceiver ((u_int16_t) rxNodeId);
+				MatrixErrorModel::FrameClass frameClass = MatrixErrorModel::FRAME_CONTROL;
+				matrixError->SetReceiver (rxNodeId);
+				matrixError->SetTransmitter (txNodeId);
 
-				if (header.GetAddr2 () == Mac48Address ("00:00:00:00:00:00"))		//Don't parse the IEEE 802.11 retransmissions
+				//Classify the frame; the error model decides which classes are error prone (by default, only data frames).
+				//Frames without transmitter address (IEEE 802.11 ACK/CTS) are not parsed
+				if (header.GetAddr2 () == Mac48Address ("00:00:00:00:00:00") || header.IsAck())
 				{
-					matrixError->SetCorrect (true);
+					frameClass = MatrixErrorModel::FRAME_MAC_ACK;
 				}
-				else
+				else if (header.IsData() && !header.GetAddr1().IsBroadcast())
 				{
-					matrixError->SetReceiver (rxNodeId);
-					matrixError->SetTransmitter (txNodeId);
-					matrixError->SetCorrect (false);
-				}
-
-				//Parse the packet and decide whether it should be defined as correct
-				//Force the IEEE 802.11 ACK frames and all broadcast/control/management messages to be correct
-				//We need a new packet copy
-				Ptr<Packet> pktCopy2 = packet->Copy();
-				pktCopy2->RemoveHeader(hdr);
-				//Decide whether the frame is correct or not according to the frame type (data, TCP or broadcast/control)
-				if (hdr.IsData() && !hdr.GetAddr1().IsBroadcast())
-				{
-					//We have split the packet decision into the following three conditions:
-					// - ARP frames --> Always correct
-					// - TCP ACK --> Always correct
-					// - Data frames --> Legacy HMM decision process
+					Ptr<Packet> pktCopy2 = packet->Copy();
+					pktCopy2->RemoveAtStart(header.GetSize());
 					pktCopy2->RemoveHeader(llcHdr);
 
 					switch (llcHdr.GetType())
 					{
 					case 0x0806:			//ARP
-						matrixError->SetCorrect (true);
+						frameClass = MatrixErrorModel::FRAME_ARP;
 						break;
 					case 0x0800:			//IP packet
 						pktCopy2->RemoveHeader(ipv4Hdr);
@@ -955,14 +982,11 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 						{
 						case 6:				//TCP
 							pktCopy2->RemoveHeader(tcpHdr);
-							//Data segments --> To be errored. We will consider data segments to those which has a payload length longer than 4 bytes
-							if (pktCopy2->GetSize() > 300)
-								matrixError->SetCorrect (false);
-							else
-								matrixError->SetCorrect (true);
+							//Data segments --> To be errored. We will consider data segments to those which has a payload length longer than 300 bytes
+							frameClass = (pktCopy2->GetSize() > 300) ? MatrixErrorModel::FRAME_DATA : MatrixErrorModel::FRAME_TCP_ACK;
 							break;
 						case 17:			//UDP
-							matrixError->SetCorrect (false);
+							frameClass = MatrixErrorModel::FRAME_DATA;
 							break;
 						default:
 							NS_LOG_ERROR ("Protocol not implemented yet (IP) --> " << ipv4Hdr.GetProtocol());
@@ -974,38 +998,52 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 							break;
 					}
 				}
-				else if (hdr.IsAck())
-					matrixError->SetCorrect (true);
-				else if (hdr.IsCtl() || hdr.IsMgt() || (hdr.GetAddr1()).IsBroadcast())
-					matrixError->SetCorrect (true);
+				matrixError->SetFrameClass (frameClass);
+			}
+
+
+			//Decide whether a frame is correct or corrupted (the same operation for every ErrorModel). The memory-channel models (BEAR and HMM)
+			//decide each subframe of an A-MSDU, moving the link once per subframe; the A-MSDU is lost if any of them is corrupted
+			bool corrupted;
+			if ((bearError || hmmError) && header.IsQosData () && header.IsQosAmsdu ())
+			{
+				if (bearError)
+					corrupted = bearError->CorruptAggregate (packet, m_subframeReceived);
 				else
-					matrixError->SetCorrect (true);
+					corrupted = hmmError->CorruptAggregate (packet, m_subframeReceived);
+			}
+			else
+			{
+				//ErrorModel::IsCorrupt takes a mutable packet: hand it a (copy-on-write) copy of the shared frame
+				corrupted = m_errorModel->IsCorrupt(packet->Copy ());
 			}
 
+			////Channel state the frame was decided at: special treatment for the AR and HiddenMarkovErrorModel
+			double channelState;
+			if (bearError)
+				channelState = bearError->GetSnr();
+			else if (hmmError)
+				channelState = hmmError->GetCurrentState();
+			else if (realizationError)
+				channelState = realizationError->GetCurrentValue();
+			else
+				channelState = WToDbm(event->GetRxPowerW());
 
-			//Decide whether a frame is correct or corrupted (the same operation for every ErrorModel)
-			if (m_errorModel->IsCorrupt(packet)) 			//Error
+			if (corrupted) 			//Error
 			{
 				NS_LOG_LOGIC("CORRUPT!!! Dropping pkt due to error model (" << this <<")");
 				NotifyRxDrop (packet);
+
+				//Frames without a known transmitter (ACK/CTS) are decided on node 0, but they do not belong to that link
+				if (txNodeFound)
+				{
+					m_phyRxErrorModelDropTrace (packet, txNodeId, channelState, event->GetDuration ());
+				}
 				m_state->SwitchFromRxEndError (packet, snrPer.snr);
 
 				if (!m_phyRxCallback.IsNull())
 				{
-					////Special treatment for the AR and HiddenMarkovErrorModel
-					if (DynamicCast<BearErrorModel> (m_errorModel) != 0)
-					{
-						Ptr <BearErrorModel> bear = m_errorModel->GetObject<BearErrorModel>();
-						m_phyRxCallback (pktCopy, false, bearError->GetSnr(), rxNodeId);
-					}
-					else if (hmmError)
-					{
-						m_phyRxCallback (pktCopy, false, hmmError->GetCurrentState(), rxNodeId);
-					}
-					else
-					{
-						m_phyRxCallback (pktCopy, false, WToDbm(event->GetRxPowerW()), rxNodeId);
-					}
+					m_phyRxCallback (packet, false, channelState, rxNodeId);
 				}
 				return;
 			}
@@ -1018,21 +1056,14 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 				double signalDbm = RatioToDb (event->GetRxPowerW ()) + 30;
 				double noiseDbm = RatioToDb (event->GetRxPowerW () / snrPer.snr) - GetRxNoiseFigure () + 30;
 				NotifyMonitorSniffRx (packet, (uint16_t)GetChannelFrequencyMhz (), GetChannelNumber (), dataRate500KbpsUnits, isShortPreamble, signalDbm, noiseDbm);
-				m_state->SwitchFromRxEndOk (packet, snrPer.snr, event->GetPayloadMode (), event->GetPreambleType ());
 
+				//The reception callback is fed before the MAC layer strips the headers of the (only) copy of the frame
+				rxPacket = packet->Copy ();
 				if (!m_phyRxCallback.IsNull())
 				{
-					////Special treatment for the AR model
-					if (DynamicCast<BearErrorModel> (m_errorModel) != 0)
-					{
-						Ptr <BearErrorModel> bear = m_errorModel->GetObject<BearErrorModel>();
-						m_phyRxCallback (pktCopy, true, bearError->GetSnr(), rxNodeId);
-					}
-					else if (DynamicCast<HiddenMarkovErrorModel> (m_errorModel) != 0)
-						m_phyRxCallback (pktCopy, true, DynamicCast<HiddenMarkovErrorModel> (m_errorModel)->GetCurrentState(), rxNodeId);
-					else
-						m_phyRxCallback (pktCopy, true, WToDbm(event->GetRxPowerW()), rxNodeId);
+					m_phyRxCallback (rxPacket, true, channelState, rxNodeId);
 				}
+				m_state->SwitchFromRxEndOk (rxPacket, snrPer.snr, event->GetPayloadMode (), event->GetPreambleType ());
 				return;
 			}
 	}
@@ -1041,14 +1072,16 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 	else     //For NS-3 default error rate model (NIST/YANS) --> Force management/ARP frames to be correct
 	{
 		//Force the IEEE 802.11 ACK frames and all broadcast/control/management messages to be correct
-		pktCopy->RemoveHeader(hdr);
+		WifiMacHeaderView header (packet);
 		//Decide whether the frame is correct or not according to the frame type (data, TCP or broadcast/control)
-		if (hdr.IsData() && !hdr.GetAddr1().IsBroadcast())
+		if (header.IsData() && !header.GetAddr1().IsBroadcast())
 		{
 			//We have split the packet decision into the following three conditions:
 			// - ARP frames --> Always correct
 			// - TCP ACK --> Always correct
 			// - Data frames --> Legacy HMM decision process
+			Ptr<Packet> pktCopy = packet->Copy();
+			pktCopy->RemoveAtStart(header.GetSize());
 			pktCopy->RemoveHeader(llcHdr);
 
 			switch (llcHdr.GetType())
@@ -1081,9 +1114,9 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 					break;
 			}
 		}
-		else if (hdr.IsAck())
+		else if (header.IsAck())
 			snrPer.per = 0;
-		else if (hdr.IsCtl() || hdr.IsMgt() || (hdr.GetAddr1()).IsBroadcast())
+		else if (header.IsCtl() || header.IsMgt() || (header.GetAddr1()).IsBroadcast())
 			snrPer.per = 0;
 		else
 			snrPer.per = 0;
@@ -1097,9 +1130,10 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 		if (m_ranvar.GetValue () > snrPer.per)
 		{
 			////David/Ramón
+			rxPacket = packet->Copy ();
 			if (!m_phyRxCallback.IsNull())
 			{
-				m_phyRxCallback (packet, true, 10 * log10 (snrPer.snr), rxNodeId);
+				m_phyRxCallback (rxPacket, true, 10 * log10 (snrPer.snr), rxNodeId);
 			}
 			////End David/Ramón
 			NotifyRxEnd (packet);
@@ -1108,7 +1142,7 @@ YansWifiPhy::EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> even
 			double signalDbm = RatioToDb (event->GetRxPowerW ()) + 30;
 			double noiseDbm = RatioToDb (event->GetRxPowerW () / snrPer.snr) - GetRxNoiseFigure () + 30;
 			NotifyMonitorSniffRx (packet, (uint16_t)GetChannelFrequencyMhz (), GetChannelNumber (), dataRate500KbpsUnits, isShortPreamble, signalDbm, noiseDbm);
-			m_state->SwitchFromRxEndOk (packet, snrPer.snr, event->GetPayloadMode (), event->GetPreambleType ());
+			m_state->SwitchFromRxEndOk (rxPacket, snrPer.snr, event->GetPayloadMode (), event->GetPreambleType ());
 		}
 		else
 		{
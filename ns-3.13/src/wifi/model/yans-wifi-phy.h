@@ -22,6 +22,7 @@
 #define YANS_WIFI_PHY_H
 
 #include <stdint.h>
+#include <vector>
 #include "ns3/callback.h"
 #include "ns3/event-id.h"
 #include "ns3/packet.h"
@@ -78,8 +79,9 @@ public:
 	 * arg2: snr of packet
 	 * arg3: True --> Correct reception; otherwise, corrupted frame
 	 * arg3: nodeId ID of the node which has received the frame
+	 * The packet is shared with the rest of receivers (or the MAC layer), so it must be treated as read-only (copy it before stripping headers)
 	 */
-	typedef Callback<void,Ptr<Packet>, bool, double, int> PhyRxCallback;
+	typedef Callback<void,Ptr<const Packet>, bool, double, int> PhyRxCallback;
 	/**
 	 * arg1: packet received unsuccessfully
 	 * arg2: snr of packet
@@ -116,10 +118,31 @@ public:
   /// Return current center channel frequency in MHz, see SetChannelNumber()
   double GetChannelFrequencyMhz () const;
 
-  void StartReceivePacket (Ptr<Packet> packet,
+  /**
+   * \param packet the frame being received. It is shared by every receiver of the
+   *        transmission, hence it must not be modified; the PHY copies it only when
+   *        it is forwarded to the upper layer.
+   * \param rxPowerDbm the received power
+   * \param mode the transmission mode
+   * \param preamble the preamble type
+   */
+  void StartReceivePacket (Ptr<const Packet> packet,
                            double rxPowerDbm,
                            WifiMode mode,
                            WifiPreamble preamble);
+  /**
+   * Account for a frame transmitted on an adjacent channel: it cannot be
+   * decoded, but it adds interference (and may keep the CCA busy).
+   *
+   * \param packet the frame being received (shared, read-only)
+   * \param rxPowerDbm the received power, after the adjacent channel rejection
+   * \param mode the transmission mode
+   * \param preamble the preamble type
+   */
+  void StartReceiveInterference (Ptr<const Packet> packet,
+                                 double rxPowerDbm,
+                                 WifiMode mode,
+                                 WifiPreamble preamble);
 
   void SetRxNoiseFigure (double noiseFigureDb);
   void SetTxPowerStart (double start);
@@ -189,7 +212,7 @@ private:
   double WToDbm (double w) const;
   double RatioToDb (double ratio) const;
   double GetPowerDbm (uint8_t power) const;
-  void EndReceive (Ptr<Packet> packet, Ptr<InterferenceHelper::Event> event);
+  void EndReceive (Ptr<const Packet> packet, Ptr<InterferenceHelper::Event> event);
 
 private:
   double   m_edThresholdW;
@@ -257,6 +280,15 @@ private:
   Ptr<ErrorModel> m_errorModel;
   PhyRxCallback m_phyRxCallback;
   PhyRxErrorCallback m_phyRxErrorCallback;
+  std::vector<bool> m_subframeReceived;
+  /**
+   * The trace source fired when the error model drops a frame: frame, ID of
+   * the transmitter node, channel state (BEAR SNR, HMM state...) and reception
+   * duration. Frames without a known transmitter (ACK, CTS) are not traced.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet>, uint16_t, double, Time> m_phyRxErrorModelDropTrace;
   ////David/Ramón
 };
 
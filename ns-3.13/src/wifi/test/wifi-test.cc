@@ -37,6 +37,14 @@
 #include "ns3/dca-txop.h"
 #include "ns3/mac-rx-middle.h"
 #include "ns3/pointer.h"
+#include "ns3/wifi-mac-queue.h"
+#include "ns3/wifi-mac-header-view.h"
+#include "ns3/wifi-mac-trailer.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include <sstream>
+#include <cstdlib>
 
 namespace ns3 {
 
@@ -286,6 +294,531 @@ InterferenceHelperSequenceTest::DoRun (void)
 
 //-----------------------------------------------------------------------------
 
+class WifiMacQueueTest : public TestCase
+{
+public:
+  WifiMacQueueTest ();
+
+  virtual void DoRun (void);
+private:
+  void Enqueue (uint32_t size, uint8_t tid, Mac48Address addr, bool front);
+  void CheckIndices (void);
+  void CheckExpiry (void);
+
+  Ptr<WifiMacQueue> m_queue;
+  Mac48Address m_a;
+  Mac48Address m_b;
+};
+
+WifiMacQueueTest::WifiMacQueueTest ()
+  : TestCase ("WifiMacQueue"),
+    m_a ("00:00:00:00:00:01"),
+    m_b ("00:00:00:00:00:02")
+{
+}
+
+void
+WifiMacQueueTest::Enqueue (uint32_t size, uint8_t tid, Mac48Address addr, bool front)
+{
+  WifiMacHeader hdr;
+  hdr.SetType (WIFI_MAC_QOSDATA);
+  hdr.SetQosTid (tid);
+  hdr.SetAddr1 (addr);
+  if (front)
+    {
+      m_queue->PushFront (Create<Packet> (size), hdr);
+    }
+  else
+    {
+      m_queue->Enqueue (Create<Packet> (size), hdr);
+    }
+}
+
+void
+WifiMacQueueTest::CheckIndices (void)
+{
+  WifiMacHeader hdr;
+  // packet i has TID i % 2 and address m_a for i < 50
+  for (uint32_t i = 1; i <= 100; i++)
+    {
+      Enqueue (i, i % 2, (i <= 50) ? m_a : m_b, false);
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_queue->GetSize (), 100, "wrong queue size");
+  NS_TEST_EXPECT_MSG_EQ (m_queue->GetNPacketsByTidAndAddress (1, WifiMacHeader::ADDR1, m_a), 25, "wrong number of packets");
+  Ptr<const Packet> packet = m_queue->PeekByTidAndAddress (&hdr, 0, WifiMacHeader::ADDR1, m_b);
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), 52, "wrong first packet of TID 0 to m_b");
+  NS_TEST_EXPECT_MSG_EQ (m_queue->Remove (packet), true, "peeked packet not removed");
+  packet = m_queue->DequeueByTidAndAddress (&hdr, 0, WifiMacHeader::ADDR1, m_b);
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), 54, "wrong first packet of TID 0 to m_b");
+  NS_TEST_EXPECT_MSG_EQ (m_queue->GetNPacketsByTidAndAddress (0, WifiMacHeader::ADDR1, m_b), 23, "wrong number of packets");
+
+  // leave holes in the middle of the queue and make it compact itself
+  while (m_queue->DequeueByTidAndAddress (&hdr, 1, WifiMacHeader::ADDR1, m_a) != 0)
+    {
+    }
+  while (m_queue->DequeueByTidAndAddress (&hdr, 1, WifiMacHeader::ADDR1, m_b) != 0)
+    {
+    }
+  while (m_queue->GetNPacketsByTidAndAddress (0, WifiMacHeader::ADDR1, m_b) > 1)
+    {
+      m_queue->DequeueByTidAndAddress (&hdr, 0, WifiMacHeader::ADDR1, m_b);
+    }
+  for (uint32_t i = 101; i <= 200; i++)
+    {
+      Enqueue (i, 1, m_a, false);
+    }
+  Enqueue (1000, 0, m_a, true);
+  NS_TEST_EXPECT_MSG_EQ (m_queue->GetSize (), 127, "wrong queue size");
+  NS_TEST_EXPECT_MSG_EQ (m_queue->GetNPacketsByTidAndAddress (0, WifiMacHeader::ADDR1, m_a), 26, "wrong number of packets");
+  NS_TEST_EXPECT_MSG_EQ (m_queue->GetNPacketsByTidAndAddress (1, WifiMacHeader::ADDR1, m_a), 100, "wrong number of packets");
+  packet = m_queue->Dequeue (&hdr);
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), 1000, "pushed front packet not first");
+  packet = m_queue->Dequeue (&hdr);
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), 2, "wrong queue order");
+  packet = m_queue->PeekByTidAndAddress (&hdr, 1, WifiMacHeader::ADDR1, m_a);
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), 101, "wrong first packet of TID 1 to m_a");
+  packet = m_queue->PeekByTidAndAddress (&hdr, 0, WifiMacHeader::ADDR1, m_b);
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), 100, "wrong first packet of TID 0 to m_b");
+}
+
+void
+WifiMacQueueTest::CheckExpiry (void)
+{
+  WifiMacHeader hdr;
+  // only the packets enqueued at 0.5s are still alive
+  NS_TEST_EXPECT_MSG_EQ (m_queue->IsEmpty (), false, "all packets expired");
+  NS_TEST_EXPECT_MSG_EQ (m_queue->GetSize (), 2, "wrong number of expired packets");
+  NS_TEST_EXPECT_MSG_EQ (m_queue->GetNPacketsByTidAndAddress (0, WifiMacHeader::ADDR1, m_a), 1, "wrong number of packets");
+  Ptr<const Packet> packet = m_queue->Dequeue (&hdr);
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), 2000, "wrong queue order");
+  packet = m_queue->Dequeue (&hdr);
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), 2001, "wrong queue order");
+  NS_TEST_EXPECT_MSG_EQ (m_queue->IsEmpty (), true, "queue not empty");
+}
+
+void
+WifiMacQueueTest::DoRun (void)
+{
+  m_queue = CreateObject<WifiMacQueue> ();
+  m_queue->SetMaxSize (1000);
+  m_queue->SetMaxDelay (Seconds (1.0));
+
+  Simulator::Schedule (Seconds (0.0), &WifiMacQueueTest::CheckIndices, this);
+  Simulator::Schedule (Seconds (0.5), &WifiMacQueueTest::Enqueue, this, 2000, 0, m_a, true);
+  Simulator::Schedule (Seconds (0.5), &WifiMacQueueTest::Enqueue, this, 2001, 1, m_b, false);
+  Simulator::Schedule (Seconds (1.2), &WifiMacQueueTest::CheckExpiry, this);
+  Simulator::Run ();
+
+  Simulator::Destroy ();
+  m_queue = 0;
+}
+
+//-----------------------------------------------------------------------------
+class WifiMacHeaderViewTest : public TestCase
+{
+public:
+  WifiMacHeaderViewTest () : TestCase ("WifiMacHeaderView reads the serialized header like WifiMacHeader")
+  {
+  }
+  virtual void DoRun (void);
+private:
+  void Check (WifiMacHeader hdr);
+};
+
+void
+WifiMacHeaderViewTest::Check (WifiMacHeader hdr)
+{
+  Ptr<Packet> packet = Create<Packet> (37);
+  packet->AddHeader (hdr);
+  WifiMacTrailer fcs;
+  packet->AddTrailer (fcs);
+  WifiMacHeader deserialized;
+  packet->PeekHeader (deserialized);
+
+  WifiMacHeaderView view (packet);
+  NS_TEST_EXPECT_MSG_EQ (view.IsCtl (), hdr.IsCtl (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.IsMgt (), hdr.IsMgt (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.IsData (), hdr.IsData (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.IsQosData (), hdr.IsQosData (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.IsRts (), hdr.IsRts (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.IsCts (), hdr.IsCts (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.IsAck (), hdr.IsAck (), hdr.GetTypeString ());
+  // the flags and the duration which are not set by the test are not initialized by WifiMacHeader either:
+  // compare them against their serialized value
+  NS_TEST_EXPECT_MSG_EQ (view.IsToDs (), deserialized.IsToDs (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.IsFromDs (), deserialized.IsFromDs (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.IsRetry (), deserialized.IsRetry (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.IsMoreFragments (), deserialized.IsMoreFragments (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.GetDuration (), deserialized.GetDuration (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.GetSize (), hdr.GetSize (), hdr.GetTypeString ());
+  // the view must not read the addresses which are not carried (i.e. from the FCS)
+  NS_TEST_EXPECT_MSG_EQ (view.GetAddr1 (), deserialized.GetAddr1 (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.GetAddr2 (), deserialized.GetAddr2 (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.GetAddr3 (), deserialized.GetAddr3 (), hdr.GetTypeString ());
+  NS_TEST_EXPECT_MSG_EQ (view.GetAddr4 (), deserialized.GetAddr4 (), hdr.GetTypeString ());
+  // control frames carry no sequence control field: WifiMacHeader leaves it
+  // uninitialized on deserialization while the view reports 0
+  if (hdr.IsCtl ())
+    {
+      NS_TEST_EXPECT_MSG_EQ (view.GetSequenceNumber (), 0, hdr.GetTypeString ());
+      NS_TEST_EXPECT_MSG_EQ (view.GetFragmentNumber (), 0, hdr.GetTypeString ());
+    }
+  else
+    {
+      NS_TEST_EXPECT_MSG_EQ (view.GetSequenceNumber (), deserialized.GetSequenceNumber (), hdr.GetTypeString ());
+      NS_TEST_EXPECT_MSG_EQ (view.GetFragmentNumber (), deserialized.GetFragmentNumber (), hdr.GetTypeString ());
+    }
+  if (hdr.IsQosData ())
+    {
+      NS_TEST_EXPECT_MSG_EQ (view.IsQosAmsdu (), hdr.IsQosAmsdu (), hdr.GetTypeString ());
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t) view.GetQosTid (), (uint32_t) hdr.GetQosTid (), hdr.GetTypeString ());
+    }
+}
+
+void
+WifiMacHeaderViewTest::DoRun (void)
+{
+  Mac48Address a1 = Mac48Address ("00:00:00:00:00:01");
+  Mac48Address a2 = Mac48Address ("00:00:00:00:00:02");
+  Mac48Address a3 = Mac48Address ("00:00:00:00:00:03");
+  Mac48Address a4 = Mac48Address ("00:00:00:00:00:04");
+  WifiMacHeader hdr;
+
+  hdr.SetType (WIFI_MAC_CTL_ACK);
+  hdr.SetAddr1 (a1);
+  hdr.SetDuration (MicroSeconds (44));
+  Check (hdr);
+
+  hdr = WifiMacHeader ();
+  hdr.SetType (WIFI_MAC_CTL_RTS);
+  hdr.SetAddr1 (a2);
+  hdr.SetAddr2 (a1);
+  hdr.SetDuration (MicroSeconds (500));
+  Check (hdr);
+
+  hdr = WifiMacHeader ();
+  hdr.SetType (WIFI_MAC_MGT_BEACON);
+  hdr.SetAddr1 (Mac48Address::GetBroadcast ());
+  hdr.SetAddr2 (a1);
+  hdr.SetAddr3 (a3);
+  hdr.SetSequenceNumber (4000);
+  Check (hdr);
+
+  hdr = WifiMacHeader ();
+  hdr.SetType (WIFI_MAC_DATA);
+  hdr.SetAddr1 (a1);
+  hdr.SetAddr2 (a2);
+  hdr.SetAddr3 (a3);
+  hdr.SetDsNotFrom ();
+  hdr.SetDsNotTo ();
+  hdr.SetSequenceNumber (1234);
+  hdr.SetFragmentNumber (3);
+  hdr.SetRetry ();
+  hdr.SetMoreFragments ();
+  hdr.SetDuration (MicroSeconds (32767));
+  Check (hdr);
+
+  hdr = WifiMacHeader ();
+  hdr.SetType (WIFI_MAC_QOSDATA);
+  hdr.SetAddr1 (a1);
+  hdr.SetAddr2 (a2);
+  hdr.SetAddr3 (a3);
+  hdr.SetAddr4 (a4);
+  hdr.SetDsFrom ();
+  hdr.SetDsTo ();
+  hdr.SetQosTid (5);
+  hdr.SetQosAmsdu ();
+  hdr.SetQosNormalAck ();
+  hdr.SetQosNoEosp ();
+  hdr.SetQosTxopLimit (0);
+  hdr.SetSequenceNumber (4095);
+  Check (hdr);
+}
+
+//-----------------------------------------------------------------------------
+class YansWifiChannelMaxRangeTest : public TestCase
+{
+public:
+  YansWifiChannelMaxRangeTest ();
+
+  virtual void DoRun (void);
+private:
+  typedef std::set<std::pair<uint32_t, uint32_t> > Receptions;
+
+  Receptions RunOne (bool cull);
+  Ptr<WifiNetDevice> CreateOne (Vector pos, Ptr<YansWifiChannel> channel, uint32_t index);
+  void SendOnePacket (Ptr<WifiNetDevice> dev, uint32_t sender);
+  void Move (Ptr<Node> node, Vector pos);
+  void RxBegin (std::string context, Ptr<const Packet> packet);
+
+  ObjectFactory m_manager;
+  ObjectFactory m_mac;
+  uint32_t m_sender;
+  Receptions m_receptions;
+};
+
+YansWifiChannelMaxRangeTest::YansWifiChannelMaxRangeTest ()
+  : TestCase ("YansWifiChannel MaxRange delivers the frames to the same receivers as the full loop")
+{
+}
+
+void
+YansWifiChannelMaxRangeTest::SendOnePacket (Ptr<WifiNetDevice> dev, uint32_t sender)
+{
+  m_sender = sender;
+  Ptr<Packet> p = Create<Packet> (100);
+  dev->Send (p, dev->GetBroadcast (), 1);
+}
+
+void
+YansWifiChannelMaxRangeTest::Move (Ptr<Node> node, Vector pos)
+{
+  node->GetObject<MobilityModel> ()->SetPosition (pos);
+}
+
+void
+YansWifiChannelMaxRangeTest::RxBegin (std::string context, Ptr<const Packet> packet)
+{
+  m_receptions.insert (std::make_pair (m_sender, (uint32_t) atoi (context.c_str ())));
+}
+
+Ptr<WifiNetDevice>
+YansWifiChannelMaxRangeTest::CreateOne (Vector pos, Ptr<YansWifiChannel> channel, uint32_t index)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<WifiNetDevice> dev = CreateObject<WifiNetDevice> ();
+
+  Ptr<WifiMac> mac = m_mac.Create<WifiMac> ();
+  mac->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<YansWifiPhy> phy = CreateObject<YansWifiPhy> ();
+  Ptr<ErrorRateModel> error = CreateObject<YansErrorRateModel> ();
+  phy->SetErrorRateModel (error);
+  phy->SetChannel (channel);
+  phy->SetDevice (dev);
+  phy->SetMobility (node);
+  phy->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  // Sync to the frames of the attenuated band of the range model too
+  phy->SetEdThreshold (-150.0);
+  Ptr<WifiRemoteStationManager> manager = m_manager.Create<WifiRemoteStationManager> ();
+
+  mobility->SetPosition (pos);
+  node->AggregateObject (mobility);
+  mac->SetAddress (Mac48Address::Allocate ());
+  dev->SetMac (mac);
+  dev->SetPhy (phy);
+  dev->SetRemoteStationManager (manager);
+  node->AddDevice (dev);
+
+  std::ostringstream oss;
+  oss << index;
+  phy->TraceConnect ("PhyRxBegin", oss.str (), MakeCallback (&YansWifiChannelMaxRangeTest::RxBegin, this));
+  return dev;
+}
+
+YansWifiChannelMaxRangeTest::Receptions
+YansWifiChannelMaxRangeTest::RunOne (bool cull)
+{
+  Ptr<RangePropagationLossModel> propLoss = CreateObject<RangePropagationLossModel> ();
+  propLoss->SetFirstRangeDistance (10.0);
+  propLoss->SetSecondRangeDistance (30.0);
+
+  // As the scenario creator does: the channel MaxRange is the cutoff of the range model
+  if (cull)
+    {
+      DoubleValue cutoff;
+      propLoss->GetAttribute ("SecondRangeDistance", cutoff);
+      Config::SetDefault ("ns3::YansWifiChannel::MaxRange", cutoff);
+    }
+  Ptr<YansWifiChannel> channel = CreateObject<YansWifiChannel> ();
+  Config::SetDefault ("ns3::YansWifiChannel::MaxRange", DoubleValue (0.0));
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  channel->SetPropagationLossModel (propLoss);
+
+  // Receivers within the first range, within the second one, just beyond it and far away, on both sides of the cell borders
+  Vector positions[] = {Vector (0.0, 0.0, 0.0), Vector (8.0, 0.0, 0.0), Vector (25.0, 0.0, 0.0),
+                        Vector (29.0, 5.0, 0.0), Vector (31.0, 0.0, 0.0), Vector (-20.0, -20.0, 0.0),
+                        Vector (0.0, 29.9, 0.0), Vector (45.0, 10.0, 0.0), Vector (61.0, 59.0, 0.0),
+                        Vector (-29.5, 0.0, 0.0)};
+  uint32_t nNodes = sizeof (positions) / sizeof (positions[0]);
+  std::vector<Ptr<WifiNetDevice> > devices;
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      devices.push_back (CreateOne (positions[i], channel, i));
+    }
+
+  // Every node transmits once, then two of them move across cells and every node transmits again
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      Simulator::Schedule (Seconds (1.0 + i), &YansWifiChannelMaxRangeTest::SendOnePacket, this, devices[i], i);
+      Simulator::Schedule (Seconds (1.0 + nNodes + 1.0 + i), &YansWifiChannelMaxRangeTest::SendOnePacket, this,
+                           devices[i], nNodes + i);
+    }
+  Simulator::Schedule (Seconds (1.0 + nNodes + 0.5), &YansWifiChannelMaxRangeTest::Move, this,
+                       devices[8]->GetNode (), Vector (5.0, 5.0, 0.0));
+  Simulator::Schedule (Seconds (1.0 + nNodes + 0.5), &YansWifiChannelMaxRangeTest::Move, this,
+                       devices[1]->GetNode (), Vector (80.0, 0.0, 0.0));
+
+  m_receptions.clear ();
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return m_receptions;
+}
+
+void
+YansWifiChannelMaxRangeTest::DoRun (void)
+{
+  m_mac.SetTypeId ("ns3::AdhocWifiMac");
+  m_manager.SetTypeId ("ns3::ConstantRateWifiManager");
+
+  Receptions all = RunOne (false);
+  Receptions culled = RunOne (true);
+
+  // The first transmission of node 0 reaches node 1 (first range) and nodes 2, 3, 5, 6 and 9 (second range)
+  NS_TEST_ASSERT_MSG_EQ (all.count (std::make_pair (0u, 1u)), 1, "Node 1 lies within the first range of node 0");
+  NS_TEST_ASSERT_MSG_EQ (all.count (std::make_pair (0u, 2u)), 1, "Node 2 lies within the second range of node 0");
+  NS_TEST_ASSERT_MSG_EQ (all.count (std::make_pair (0u, 4u)), 0, "Node 4 lies beyond the range of node 0");
+  NS_TEST_ASSERT_MSG_EQ (all.count (std::make_pair (10u, 8u)), 1, "Node 8 has moved next to node 0");
+  NS_TEST_ASSERT_MSG_EQ (all.count (std::make_pair (10u, 1u)), 0, "Node 1 has moved away from node 0");
+
+  NS_TEST_ASSERT_MSG_EQ (culled.size (), all.size (), "The spatial index changes the number of receptions");
+  NS_TEST_ASSERT_MSG_EQ ((culled == all), true, "The spatial index changes the receivers of some frame");
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Loss model which counts, per receiver node, the frames it is asked the power of, as
+ * received frames and as interference
+ */
+class CountingPropagationLossModel : public PropagationLossModel
+{
+public:
+  std::map<uint32_t, uint32_t> m_nFrames;
+  std::map<uint32_t, uint32_t> m_nInterference;
+private:
+  virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    const_cast<CountingPropagationLossModel *> (this)->m_nFrames[b->GetObject<Node> ()->GetId ()]++;
+    return txPowerDbm - 50.0;
+  }
+  virtual double DoCalcInterferenceRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    const_cast<CountingPropagationLossModel *> (this)->m_nInterference[b->GetObject<Node> ()->GetId ()]++;
+    return txPowerDbm - 50.0;
+  }
+};
+
+class YansWifiChannelAdjacentTest : public TestCase
+{
+public:
+  YansWifiChannelAdjacentTest ();
+
+  virtual void DoRun (void);
+private:
+  Ptr<WifiNetDevice> CreateOne (Vector pos, Ptr<YansWifiChannel> channel);
+  void SendOnePacket (Ptr<WifiNetDevice> dev);
+  void SwitchCh (Ptr<WifiNetDevice> dev, uint16_t channelNumber);
+  void RxBegin (std::string context, Ptr<const Packet> packet);
+
+  ObjectFactory m_manager;
+  ObjectFactory m_mac;
+  std::map<uint32_t, uint32_t> m_nRxBegin;
+};
+
+YansWifiChannelAdjacentTest::YansWifiChannelAdjacentTest ()
+  : TestCase ("YansWifiChannel moves the PHYs between channel buckets and only asks the interference power of adjacent channels")
+{
+}
+
+void
+YansWifiChannelAdjacentTest::SendOnePacket (Ptr<WifiNetDevice> dev)
+{
+  Ptr<Packet> p = Create<Packet> (100);
+  dev->Send (p, dev->GetBroadcast (), 1);
+}
+
+void
+YansWifiChannelAdjacentTest::SwitchCh (Ptr<WifiNetDevice> dev, uint16_t channelNumber)
+{
+  dev->GetPhy ()->SetChannelNumber (channelNumber);
+}
+
+void
+YansWifiChannelAdjacentTest::RxBegin (std::string context, Ptr<const Packet> packet)
+{
+  m_nRxBegin[atoi (context.c_str ())]++;
+}
+
+Ptr<WifiNetDevice>
+YansWifiChannelAdjacentTest::CreateOne (Vector pos, Ptr<YansWifiChannel> channel)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<WifiNetDevice> dev = CreateObject<WifiNetDevice> ();
+
+  Ptr<WifiMac> mac = m_mac.Create<WifiMac> ();
+  mac->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<YansWifiPhy> phy = CreateObject<YansWifiPhy> ();
+  Ptr<ErrorRateModel> error = CreateObject<YansErrorRateModel> ();
+  phy->SetErrorRateModel (error);
+  phy->SetChannel (channel);
+  phy->SetDevice (dev);
+  phy->SetMobility (node);
+  phy->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  Ptr<WifiRemoteStationManager> manager = m_manager.Create<WifiRemoteStationManager> ();
+
+  mobility->SetPosition (pos);
+  node->AggregateObject (mobility);
+  mac->SetAddress (Mac48Address::Allocate ());
+  dev->SetMac (mac);
+  dev->SetPhy (phy);
+  dev->SetRemoteStationManager (manager);
+  node->AddDevice (dev);
+
+  std::ostringstream oss;
+  oss << node->GetId ();
+  phy->TraceConnect ("PhyRxBegin", oss.str (), MakeCallback (&YansWifiChannelAdjacentTest::RxBegin, this));
+  return dev;
+}
+
+void
+YansWifiChannelAdjacentTest::DoRun (void)
+{
+  m_mac.SetTypeId ("ns3::AdhocWifiMac");
+  m_manager.SetTypeId ("ns3::ConstantRateWifiManager");
+
+  Ptr<YansWifiChannel> channel = CreateObject<YansWifiChannel> ();
+  Ptr<CountingPropagationLossModel> propLoss = CreateObject<CountingPropagationLossModel> ();
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  channel->SetPropagationLossModel (propLoss);
+  channel->SetAttribute ("AdjacentChannels", UintegerValue (1));
+
+  Ptr<WifiNetDevice> sender = CreateOne (Vector (0.0, 0.0, 0.0), channel);
+  Ptr<WifiNetDevice> a = CreateOne (Vector (5.0, 0.0, 0.0), channel);
+  Ptr<WifiNetDevice> b = CreateOne (Vector (-5.0, 0.0, 0.0), channel);
+  uint32_t idA = a->GetNode ()->GetId ();
+  uint32_t idB = b->GetNode ()->GetId ();
+
+  // First frame: a shares the sender channel, b is on the adjacent one
+  b->GetPhy ()->SetChannelNumber (2);
+  Simulator::Schedule (Seconds (1.0), &YansWifiChannelAdjacentTest::SendOnePacket, this, sender);
+  // Second frame: once the index is built, b moves to the sender channel and a two channels away
+  Simulator::Schedule (Seconds (1.5), &YansWifiChannelAdjacentTest::SwitchCh, this, b, 1);
+  Simulator::Schedule (Seconds (1.5), &YansWifiChannelAdjacentTest::SwitchCh, this, a, 3);
+  Simulator::Schedule (Seconds (2.0), &YansWifiChannelAdjacentTest::SendOnePacket, this, sender);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_nRxBegin[idA], 1, "a should only receive the first frame");
+  NS_TEST_ASSERT_MSG_EQ (m_nRxBegin[idB], 1, "b should only receive the second frame");
+  NS_TEST_ASSERT_MSG_EQ (propLoss->m_nFrames[idA], 1, "The received power of a is only needed for the first frame");
+  NS_TEST_ASSERT_MSG_EQ (propLoss->m_nInterference[idA], 0, "a is not adjacent to the sender on the second frame");
+  NS_TEST_ASSERT_MSG_EQ (propLoss->m_nFrames[idB], 1, "The received power of b is only needed for the second frame");
+  NS_TEST_ASSERT_MSG_EQ (propLoss->m_nInterference[idB], 1, "The first frame is only interference for b");
+}
+
+//-----------------------------------------------------------------------------
+
 class WifiTestSuite : public TestSuite
 {
 public:
@@ -298,6 +831,10 @@ WifiTestSuite::WifiTestSuite ()
   AddTestCase (new WifiTest);
   AddTestCase (new QosUtilsIsOldPacketTest);
   AddTestCase (new InterferenceHelperSequenceTest); // Bug 991
+  AddTestCase (new WifiMacQueueTest);
+  AddTestCase (new WifiMacHeaderViewTest);
+  AddTestCase (new YansWifiChannelMaxRangeTest);
+  AddTestCase (new YansWifiChannelAdjacentTest);
 }
 
 static WifiTestSuite g_wifiTestSuite;